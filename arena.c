@@ -0,0 +1,168 @@
+/**
+ * @file arena.c
+ * @brief Data structures and algorithms for arena memory allocation.
+ */
+
+#include "arena.h"
+#include "profile.h"
+
+/*
+	Rounds a size up to a whole number of alignment units. The size of a
+	block header is rounded in the same way, so that the usable memory
+	after it is aligned too.
+*/
+#define UCPCAL_ARENA_ROUND(size) \
+	(((size) + sizeof(ucpcal_arena_align) - 1) / \
+	sizeof(ucpcal_arena_align) * sizeof(ucpcal_arena_align))
+
+/* The first block is small, so that empty lists stay cheap. */
+#define UCPCAL_ARENA_MIN_BLOCK 4096
+
+/* Blocks stop doubling at this size, to bound the waste per block. */
+#define UCPCAL_ARENA_MAX_BLOCK 8388608
+
+ucpcal_arena *ucpcal_arena_new(void) {
+	ucpcal_arena *arena = (ucpcal_arena *) malloc(sizeof(ucpcal_arena));
+	int i;
+	arena->blocks = NULL;
+	arena->block_size = UCPCAL_ARENA_MIN_BLOCK;
+	for (i = 0; i < UCPCAL_ARENA_CLASSES; i++)
+		arena->free[i] = NULL;
+	arena->allocations = 0;
+	return arena;
+}
+
+void ucpcal_arena_free(ucpcal_arena *arena) {
+	if (arena) {
+		ucpcal_arena_empty(arena);
+		free(arena);
+	}
+}
+
+void *ucpcal_arena_alloc(ucpcal_arena *arena, size_t size) {
+	size_t rounded = UCPCAL_ARENA_ROUND(size ? size : 1);
+	size_t units = rounded / sizeof(ucpcal_arena_align);
+	size_t header = UCPCAL_ARENA_ROUND(sizeof(ucpcal_arena_block));
+	ucpcal_arena_block *block = arena->blocks;
+	void *result = NULL;
+	/*
+		Counted in the arena rather than the profile, as arenas are
+		filled by many threads at once while loading in parallel.
+	*/
+	arena->allocations++;
+	if (units <= UCPCAL_ARENA_CLASSES && arena->free[units - 1]) {
+		/* Reuse a recycled object of the same size class. */
+		result = arena->free[units - 1];
+		arena->free[units - 1] = *(void **) result;
+	} else if (block && block->size - block->used >= rounded) {
+		/* Bump the cursor of the current block. */
+		result = (char *) block + header + block->used;
+		block->used += rounded;
+	} else if (rounded > arena->block_size / 4) {
+		/*
+			A large object gets a block to itself, placed behind
+			the current block so that its free space is not lost.
+		*/
+		block = (ucpcal_arena_block *) malloc(header + rounded);
+		block->size = rounded;
+		block->used = rounded;
+		if (arena->blocks) {
+			block->next = arena->blocks->next;
+			arena->blocks->next = block;
+		} else {
+			block->next = NULL;
+			arena->blocks = block;
+		}
+		result = (char *) block + header;
+	} else {
+		/* Start a new current block, bigger than the last. */
+		block = (ucpcal_arena_block *) malloc(
+			header + arena->block_size
+		);
+		block->size = arena->block_size;
+		block->used = rounded;
+		block->next = arena->blocks;
+		arena->blocks = block;
+		if (arena->block_size < UCPCAL_ARENA_MAX_BLOCK)
+			arena->block_size *= 2;
+		result = (char *) block + header;
+	}
+	return result;
+}
+
+void ucpcal_arena_recycle(ucpcal_arena *arena, void *ptr, size_t size) {
+	size_t units = UCPCAL_ARENA_ROUND(size ? size : 1) /
+		sizeof(ucpcal_arena_align);
+	/*
+		Every size class is at least as big as a pointer, so the link
+		to the next free object fits in the object itself. Objects
+		too big for a free list stay put until the arena is emptied.
+	*/
+	if (ptr && units <= UCPCAL_ARENA_CLASSES) {
+		*(void **) ptr = arena->free[units - 1];
+		arena->free[units - 1] = ptr;
+	}
+}
+
+void ucpcal_arena_adopt(ucpcal_arena *arena, ucpcal_arena *other) {
+	ucpcal_arena_block *last = other->blocks;
+	void **tail;
+	int i;
+	if (last) {
+		/*
+			Like a large object, the adopted blocks go behind the
+			current block, which keeps handing out its free space.
+		*/
+		while (last->next)
+			last = last->next;
+		if (arena->blocks) {
+			last->next = arena->blocks->next;
+			arena->blocks->next = other->blocks;
+		} else {
+			arena->blocks = other->blocks;
+		}
+	}
+	arena->allocations += other->allocations;
+	other->allocations = 0;
+	for (i = 0; i < UCPCAL_ARENA_CLASSES; i++) {
+		if (other->free[i]) {
+			tail = (void **) other->free[i];
+			while (*tail)
+				tail = (void **) *tail;
+			*tail = arena->free[i];
+			arena->free[i] = other->free[i];
+			other->free[i] = NULL;
+		}
+	}
+	if (other->block_size > arena->block_size)
+		arena->block_size = other->block_size;
+	other->blocks = NULL;
+	other->block_size = UCPCAL_ARENA_MIN_BLOCK;
+}
+
+char *ucpcal_arena_string(
+	ucpcal_arena *arena,
+	const char *string,
+	size_t length
+) {
+	char *result = (char *) ucpcal_arena_alloc(arena, length + 1);
+	memcpy(result, string, length);
+	result[length] = 0;
+	return result;
+}
+
+void ucpcal_arena_empty(ucpcal_arena *arena) {
+	ucpcal_arena_block *cur = arena->blocks, *next;
+	int i;
+	while (cur) {
+		next = cur->next;
+		free(cur);
+		cur = next;
+	}
+	arena->blocks = NULL;
+	arena->block_size = UCPCAL_ARENA_MIN_BLOCK;
+	for (i = 0; i < UCPCAL_ARENA_CLASSES; i++)
+		arena->free[i] = NULL;
+	UCPCAL_PROFILE_COUNT(UCPCAL_PROFILE_ALLOCATIONS, arena->allocations);
+	arena->allocations = 0;
+}
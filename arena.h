@@ -0,0 +1,151 @@
+/**
+ * @file arena.h
+ * @brief Data structures and algorithms for arena memory allocation.
+ */
+
+#ifndef UCPCAL_ARENA_H
+#define UCPCAL_ARENA_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @brief The number of size classes with their own free list in an arena.
+ * Allocations up to this many alignment units can be recycled; larger ones
+ * are only reclaimed when the whole arena is emptied.
+ */
+
+#define UCPCAL_ARENA_CLASSES 32
+
+/**
+ * @brief A data structure with the strictest alignment of common types.
+ * Every allocation from an arena is rounded up to a multiple of its size.
+ */
+
+typedef union ucpcal_arena_align {
+	long l;
+	double d;
+	void *p;
+} ucpcal_arena_align;
+
+/**
+ * @brief A data structure representing a block of memory in an arena.
+ * The usable memory follows the structure itself, after padding to the
+ * size of ucpcal_arena_align.
+ */
+
+typedef struct ucpcal_arena_block {
+	struct ucpcal_arena_block *next;
+	/**
+	 * The number of usable bytes in the block.
+	 */
+	size_t size;
+	/**
+	 * The number of usable bytes already handed out.
+	 */
+	size_t used;
+} ucpcal_arena_block;
+
+/**
+ * @brief A data structure representing an arena allocator.
+ * Memory is handed out from large blocks by bumping a cursor, so that many
+ * small objects cost few calls to malloc(), and emptying the arena releases
+ * every object at once by freeing the blocks. Objects released individually
+ * with ucpcal_arena_recycle() go on a free list for their size class, to be
+ * handed out again before any new memory.
+ */
+
+typedef struct ucpcal_arena {
+	/**
+	 * The blocks of the arena, with the one currently being used for
+	 * new allocations first.
+	 */
+	ucpcal_arena_block *blocks;
+	/**
+	 * The size of the next block to be allocated, which doubles each
+	 * time up to a limit.
+	 */
+	size_t block_size;
+	/**
+	 * The free lists, indexed by the number of alignment units less one.
+	 * Each free object stores a pointer to the next in its first bytes.
+	 */
+	void *free[UCPCAL_ARENA_CLASSES];
+	/**
+	 * The number of objects handed out since the arena was last emptied,
+	 * added to the profile's count when it is emptied.
+	 */
+	unsigned long allocations;
+} ucpcal_arena;
+
+/**
+ * @brief Creates a new, empty arena on the heap.
+ * Be sure to use ucpcal_arena_free() when finished.
+ * @return pointer to new ucpcal_arena struct
+ */
+
+ucpcal_arena *ucpcal_arena_new(void);
+
+/**
+ * @brief Frees an arena and all memory allocated from it.
+ * @param arena the arena to be freed
+ */
+
+void ucpcal_arena_free(ucpcal_arena *arena);
+
+/**
+ * @brief Allocates memory from an arena.
+ * The memory is suitably aligned for any common type, but is not cleared.
+ * @param arena the arena to allocate from
+ * @param size the number of bytes required
+ * @return pointer to the allocated memory
+ */
+
+void *ucpcal_arena_alloc(ucpcal_arena *arena, size_t size);
+
+/**
+ * @brief Returns memory to an arena for reuse by later allocations.
+ * @param arena the arena the memory was allocated from
+ * @param ptr the memory to recycle, or NULL to do nothing
+ * @param size the number of bytes requested when it was allocated
+ */
+
+void ucpcal_arena_recycle(ucpcal_arena *arena, void *ptr, size_t size);
+
+/**
+ * @brief Moves all memory from one arena into another.
+ * Objects allocated from the source arena stay where they are but belong to
+ * the destination from then on, to be recycled into it and released when it
+ * is emptied, and the source is left empty. This lets separate threads each
+ * allocate from an arena of their own and then hand the results over.
+ * @param arena the arena to move the memory into
+ * @param other the arena to move the memory out of
+ */
+
+void ucpcal_arena_adopt(ucpcal_arena *arena, ucpcal_arena *other);
+
+/**
+ * @brief Copies a string into memory allocated from an arena.
+ * @param arena the arena to allocate from
+ * @param string the string to copy, which need not be null terminated
+ * @param length the number of bytes to copy
+ * @return the null terminated copy
+ */
+
+char *ucpcal_arena_string(
+	ucpcal_arena *arena,
+	const char *string,
+	size_t length
+);
+
+/**
+ * @brief Releases all memory allocated from an arena.
+ * Only one call to free() is needed per block, no matter how many objects
+ * were allocated. The arena remains usable afterwards.
+ * @param arena the arena to empty
+ */
+
+void ucpcal_arena_empty(ucpcal_arena *arena);
+
+#endif
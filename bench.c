@@ -0,0 +1,156 @@
+/**
+ * @file bench.c
+ * @brief The calendar benchmark program source file.
+ */
+
+#include "bench.h"
+
+int main(int argc, char **argv) {
+	int return_value = 1;
+	unsigned long count;
+	char *end;
+	if (argc == 2 || argc == 3) {
+		count = strtoul(argv[1], &end, 10);
+		if (*argv[1] && !*end)
+			return_value = ucpcal_bench_run(
+				count,
+				argc == 3 ? argv[2] : "ucpcal-bench.txt"
+			);
+	}
+	if (return_value)
+		fprintf(stderr, "Usage: %s events [scratch file]\n", argv[0]);
+	return return_value;
+}
+
+int ucpcal_bench_run(unsigned long count, const char *filename) {
+	/* Common words, a common location and rare names, by turns. */
+	static const char *searches[] = {
+		"review", "room 4", "strategy 4242", "udit 99"
+	};
+	ucpcal_generator generator;
+	ucpcal_list *list;
+	ucpcal_event **events;
+	ucpcal_node *cur;
+	char **names, *output, *saved;
+	/* Generated events start in 2013, so this takes in all of them. */
+	ucpcal_date from = { 1, 2000, 1, 1, 0, 0 };
+	ucpcal_date to = { 1, 2100, 1, 1, 0, 0 };
+	unsigned long i, found = 0;
+	size_t matches, length;
+	double start;
+	int return_value = 1;
+	saved = (char *) malloc(strlen(filename) + strlen(".out") + 1);
+	strcpy(saved, filename);
+	strcat(saved, ".out");
+	ucpcal_generator_init(&generator, 1);
+	start = ucpcal_bench_now();
+	if (!ucpcal_generate_file(&generator, filename, count)) {
+		ucpcal_bench_report("generate", count, start);
+		list = ucpcal_list_new();
+		start = ucpcal_bench_now();
+		ucpcal_load(list, filename, NULL);
+		ucpcal_bench_report("load", count, start);
+		start = ucpcal_bench_now();
+		return_value = ucpcal_save(list, saved) != 0;
+		ucpcal_bench_report("save", count, start);
+		start = ucpcal_bench_now();
+		for (cur = list->head; cur; cur = cur->next)
+			if (ucpcal_list_find(list, cur->event->name))
+				found++;
+		ucpcal_bench_report("find", found, start);
+		/* The first search builds the trigram index. */
+		start = ucpcal_bench_now();
+		free(ucpcal_list_search(list, "review", &matches));
+		ucpcal_bench_report("index", count, start);
+		start = ucpcal_bench_now();
+		for (i = 0; i < 100; i++) {
+			events = ucpcal_list_search(
+				list,
+				searches[i % 4],
+				&matches
+			);
+			free(events);
+		}
+		ucpcal_bench_report("search", 100, start);
+		start = ucpcal_bench_now();
+		ucpcal_list_columns(list);
+		ucpcal_bench_report("columns", count, start);
+		start = ucpcal_bench_now();
+		for (i = 0; i < 100; i++)
+			ucpcal_list_total(list, from, to);
+		ucpcal_bench_report("total", 100, start);
+		start = ucpcal_bench_now();
+		output = ucpcal_render_list(list);
+		ucpcal_bench_report("render", count, start);
+		free(output);
+		start = ucpcal_bench_now();
+		output = ucpcal_render_parallel(list, 0);
+		ucpcal_bench_report("render_parallel", count, start);
+		free(output);
+		/* The names go with the events, so delete by copies. */
+		names = (char **) malloc((count + 1) * sizeof(char *));
+		for (cur = list->head, i = 0; cur; cur = cur->next, i++) {
+			length = ucpcal_string_length(cur->event->name);
+			names[i] = (char *) malloc(length + 1);
+			memcpy(names[i], cur->event->name, length);
+			names[i][length] = 0;
+		}
+		start = ucpcal_bench_now();
+		for (i = 0; i < found; i++)
+			ucpcal_list_delete(list, names[i]);
+		ucpcal_bench_report("delete", found, start);
+		for (i = 0; i < found; i++)
+			free(names[i]);
+		free(names);
+		ucpcal_list_free(list);
+		/* Events are made up front so that only appending is timed. */
+		events = ucpcal_generate_events(&generator, 0, count);
+		list = ucpcal_list_new();
+		start = ucpcal_bench_now();
+		for (i = 0; i < count; i++)
+			ucpcal_list_append(list, events[i]);
+		ucpcal_bench_report("append", count, start);
+		free(events);
+		ucpcal_list_free(list);
+		ucpcal_bench_report_memory(count);
+	}
+	remove(filename);
+	remove(saved);
+	free(saved);
+	return return_value;
+}
+
+double ucpcal_bench_now(void) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+void ucpcal_bench_report(
+	const char *operation,
+	unsigned long count,
+	double start
+) {
+	double seconds = ucpcal_bench_now() - start;
+	printf(
+		"{\"operation\": \"%s\", \"events\": %lu, \"seconds\": %.6f, "
+		"\"per_second\": %.0f}\n",
+		operation,
+		count,
+		seconds,
+		seconds > 0 ? count / seconds : 0.0
+	);
+	fflush(stdout);
+}
+
+void ucpcal_bench_report_memory(unsigned long count) {
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	printf(
+		"{\"events\": %lu, \"peak_rss_kb\": %ld}\n",
+		count,
+		/* Linux reports this in kilobytes. */
+		(long) usage.ru_maxrss
+	);
+	fflush(stdout);
+}
@@ -0,0 +1,77 @@
+/**
+ * @file bench.h
+ * @brief The calendar benchmark program source file.
+ */
+
+#ifndef UCPCAL_BENCH_H
+#define UCPCAL_BENCH_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/resource.h>
+#include "date.h"
+#include "event.h"
+#include "list.h"
+#include "file.h"
+#include "generate.h"
+#include "render.h"
+
+/**
+ * @brief The main entry point for the calendar benchmark program.
+ * Times the core calendar operations on a synthetic calendar of a given
+ * number of events, and prints one JSON object per operation on its own
+ * line, giving the operation, the number of events, the time taken in
+ * seconds and the throughput in events per second. A last line gives the
+ * peak resident set size of the whole run in kilobytes; the peak only ever
+ * grows, so it would say little about any one operation.
+ * @param argc the number of command line arguments
+ * @param argv the command line argument vector: the number of events, and
+ * optionally the scratch file to generate the calendar in
+ * @return 1 where an error has occurred, 0 otherwise
+ */
+
+int main(int argc, char **argv);
+
+/**
+ * @brief Runs every benchmark on a calendar of a given size.
+ * The scratch file, and the file it is saved to, are removed afterwards.
+ * @param count the number of events
+ * @param filename the scratch file to generate the calendar in
+ * @return 1 where an error has occurred, 0 otherwise
+ */
+
+int ucpcal_bench_run(unsigned long count, const char *filename);
+
+/**
+ * @brief Reads the monotonic clock.
+ * @return the time in seconds since some fixed point
+ */
+
+double ucpcal_bench_now(void);
+
+/**
+ * @brief Prints the result of a benchmark as a line of JSON.
+ * Call this as soon as the operation is finished, as the time taken is
+ * measured up to the call.
+ * @param operation the name of the operation timed
+ * @param count the number of events the operation covered
+ * @param start the time the operation started, from ucpcal_bench_now()
+ */
+
+void ucpcal_bench_report(
+	const char *operation,
+	unsigned long count,
+	double start
+);
+
+/**
+ * @brief Prints the peak resident set size of the process as a line of
+ * JSON.
+ * @param count the number of events the benchmarks covered
+ */
+
+void ucpcal_bench_report_memory(unsigned long count);
+
+#endif
@@ -0,0 +1,434 @@
+/**
+ * @file binary.c
+ * @brief Data structures and algorithms for binary calendar files.
+ */
+
+#include "binary.h"
+
+ucpcal_binary *ucpcal_binary_open(const char *filename) {
+	ucpcal_binary *binary = NULL;
+	ucpcal_map *map = ucpcal_map_view(filename);
+	const char *error;
+	if (map) {
+		ucpcal_binary_check(map, &error);
+		if (error) {
+			fprintf(stderr, "%s: %s\n", filename, error);
+			ucpcal_map_free(map);
+		} else {
+			binary = (ucpcal_binary *) malloc(
+				sizeof(ucpcal_binary)
+			);
+			binary->map = map;
+			binary->header =
+				(const ucpcal_binary_header *) map->data;
+			binary->records = (const ucpcal_binary_record *) (
+				map->data + sizeof(ucpcal_binary_header)
+			);
+			binary->strings = (const char *) (
+				binary->records + binary->header->count
+			);
+		}
+	}
+	return binary;
+}
+
+void ucpcal_binary_close(ucpcal_binary *binary) {
+	if (binary) {
+		ucpcal_map_free(binary->map);
+		free(binary);
+	}
+}
+
+void ucpcal_binary_check(const ucpcal_map *map, const char **error) {
+	const ucpcal_binary_header *header =
+		(const ucpcal_binary_header *) map->data;
+	const ucpcal_binary_record *records;
+	const char *strings, *rule;
+	ucpcal_date first = { 1, UCPCAL_YEAR_MIN, 1, 1, 0, 0 };
+	ucpcal_date last = { 1, UCPCAL_YEAR_MAX, 12, 31, 23, 59 };
+	ucpcal_time earliest, latest;
+	unsigned long i, length;
+	*error = NULL;
+	if (
+		map->length < sizeof(ucpcal_binary_header) ||
+		memcmp(header->magic, UCPCAL_BINARY_MAGIC, 8)
+	) {
+		*error = "not a binary calendar file";
+	} else if (header->version != UCPCAL_BINARY_VERSION) {
+		*error = "unsupported binary calendar format version";
+	} else if (
+		header->byte_order != UCPCAL_BINARY_BYTE_ORDER ||
+		header->long_size != sizeof(long) ||
+		header->int_size != sizeof(int) ||
+		header->record_size != sizeof(ucpcal_binary_record)
+	) {
+		*error = "file was written on an incompatible machine";
+	} else {
+		/* Divide rather than multiply, which could overflow. */
+		length = map->length - sizeof(ucpcal_binary_header);
+		if (
+			header->count > length / header->record_size ||
+			header->strings_length !=
+				length - header->count * header->record_size
+		)
+			*error = "file size does not match its header";
+		else if (
+			header->strings_length &&
+			map->data[map->length - 1]
+		)
+			*error = "string table is not null terminated";
+	}
+	if (!*error) {
+		records = (const ucpcal_binary_record *) (
+			map->data + sizeof(ucpcal_binary_header)
+		);
+		strings = (const char *) (records + header->count);
+		earliest = ucpcal_time_from_date(first);
+		latest = ucpcal_time_from_date(last);
+		for (i = 0; i < header->count && !*error; i++) {
+			if (records[i].name >= header->strings_length)
+				*error = "name is outside the string table";
+			else if (
+				records[i].location != UCPCAL_BINARY_NONE &&
+				records[i].location >= header->strings_length
+			)
+				*error =
+					"location is outside the string table";
+			else if (
+				records[i].rule != UCPCAL_BINARY_NONE &&
+				records[i].rule >= header->strings_length
+			)
+				*error = "rule is outside the string table";
+			else if (
+				records[i].rule != UCPCAL_BINARY_NONE && (
+					rule = strings + records[i].rule,
+					!ucpcal_rule_scan(
+						rule,
+						rule + strlen(rule),
+						NULL
+					)
+				)
+			)
+				*error = "rule is malformed";
+			else if (
+				records[i].start < earliest ||
+				records[i].start > latest
+			)
+				*error = "start time is out of range";
+			else if (
+				i > 0 &&
+				records[i].start < records[i - 1].start
+			)
+				*error = "records are out of order";
+		}
+	}
+}
+
+const char *ucpcal_binary_name(
+	const ucpcal_binary *binary,
+	const ucpcal_binary_record *record
+) {
+	return binary->strings + record->name;
+}
+
+const char *ucpcal_binary_location(
+	const ucpcal_binary *binary,
+	const ucpcal_binary_record *record
+) {
+	return record->location == UCPCAL_BINARY_NONE ?
+		NULL : binary->strings + record->location;
+}
+
+unsigned long ucpcal_binary_lower_bound(
+	const ucpcal_binary *binary,
+	ucpcal_time start
+) {
+	unsigned long low = 0, high = binary->header->count, middle;
+	while (low < high) {
+		middle = low + (high - low) / 2;
+		if (binary->records[middle].start < start)
+			low = middle + 1;
+		else
+			high = middle;
+	}
+	return low;
+}
+
+void ucpcal_binary_event(
+	const ucpcal_binary *binary,
+	const ucpcal_binary_record *record,
+	ucpcal_event *event
+) {
+	const char *rule;
+	event->date = ucpcal_time_to_date(record->start);
+	event->duration = record->duration;
+	/* The strings stay in place in the read only mapping. */
+	event->name = (char *) ucpcal_binary_name(binary, record);
+	event->location = (char *) ucpcal_binary_location(binary, record);
+	event->rule = NULL;
+	if (record->rule != UCPCAL_BINARY_NONE) {
+		rule = binary->strings + record->rule;
+		event->rule = ucpcal_rule_parse(
+			NULL,
+			rule,
+			rule + strlen(rule)
+		);
+	}
+	event->arena = NULL;
+	event->borrowed = 1;
+}
+
+int ucpcal_binary_detect(const char *filename) {
+	char magic[8];
+	int result = -1;
+	FILE *f = fopen(filename, "rb");
+	if (f) {
+		result = fread(magic, 1, sizeof(magic), f) == sizeof(magic) &&
+			!memcmp(magic, UCPCAL_BINARY_MAGIC, sizeof(magic));
+		fclose(f);
+	}
+	return result;
+}
+
+int ucpcal_binary_load(ucpcal_list *list, const char *filename) {
+	ucpcal_map *map = ucpcal_map_view(filename);
+	const ucpcal_binary_header *header;
+	const ucpcal_binary_record *records;
+	char *strings;
+	const char *rule;
+	ucpcal_batch batch;
+	ucpcal_event *event;
+	ucpcal_node *node;
+	const char *error;
+	unsigned long i;
+	int result = 1;
+	if (map) {
+		ucpcal_binary_check(map, &error);
+		if (error) {
+			fprintf(stderr, "%s: %s\n", filename, error);
+			ucpcal_map_free(map);
+		} else {
+			result = 0;
+			ucpcal_list_empty(list);
+			/* The list releases the mapping when next emptied. */
+			map->next = list->maps;
+			list->maps = map;
+			header = (const ucpcal_binary_header *) map->data;
+			records = (const ucpcal_binary_record *) (
+				map->data + sizeof(ucpcal_binary_header)
+			);
+			strings = (char *) (records + header->count);
+			/*
+				The records are already parsed, so the whole
+				file makes one batch, merged as if a thread had
+				parsed it from text.
+			*/
+			batch.text = NULL;
+			batch.end = NULL;
+			batch.arena = ucpcal_arena_new();
+			batch.nodes = NULL;
+			batch.sorted = NULL;
+			batch.count = 0;
+			batch.capacity = 0;
+			batch.error = NULL;
+			batch.error_position = NULL;
+			batch.skipped = 0;
+			for (i = 0; i < header->count; i++) {
+				event = ucpcal_event_alloc(batch.arena);
+				event->date = ucpcal_time_to_date(
+					records[i].start
+				);
+				event->duration = records[i].duration;
+				event->borrowed = 1;
+				event->name = strings + records[i].name;
+				if (
+					records[i].location !=
+						UCPCAL_BINARY_NONE
+				)
+					event->location =
+						strings + records[i].location;
+				if (records[i].rule != UCPCAL_BINARY_NONE) {
+					rule = strings + records[i].rule;
+					event->rule = ucpcal_rule_parse(
+						batch.arena,
+						rule,
+						rule + strlen(rule)
+					);
+				}
+				node = ucpcal_node_new(batch.arena);
+				node->event = event;
+				node->when.start = records[i].start;
+				node->when.seq = batch.count;
+				ucpcal_batch_add(&batch, node);
+			}
+			ucpcal_batch_sort(&batch);
+			ucpcal_batch_merge(list, &batch, 1);
+		}
+	}
+	return result;
+}
+
+int ucpcal_binary_save(ucpcal_list *list, const char *filename) {
+	ucpcal_binary_header header;
+	ucpcal_binary_record *records;
+	ucpcal_binary_strings *strings = ucpcal_binary_strings_new();
+	ucpcal_node *cur;
+	unsigned long count = 0, i = 0;
+	ucpcal_writer *writer;
+	char *rule;
+	int result = -1;
+	for (cur = list->head; cur; cur = cur->next)
+		count++;
+	records = (ucpcal_binary_record *) malloc(
+		(count ? count : 1) * sizeof(ucpcal_binary_record)
+	);
+	/* Records go in order of start time, to be searched in place. */
+	for (
+		cur = ucpcal_tree_first(list->times);
+		cur;
+		cur = ucpcal_tree_next(cur)
+	) {
+		records[i].start = cur->when.start;
+		records[i].name = ucpcal_binary_strings_add(
+			strings,
+			cur->event->name
+		);
+		records[i].location = cur->event->location ?
+			ucpcal_binary_strings_add(
+				strings,
+				cur->event->location
+			) : UCPCAL_BINARY_NONE;
+		records[i].duration = cur->event->duration;
+		records[i].rule = UCPCAL_BINARY_NONE;
+		if (cur->event->rule) {
+			rule = (char *) malloc(
+				ucpcal_rule_format_size(cur->event->rule)
+			);
+			ucpcal_rule_format(rule, cur->event->rule);
+			records[i].rule = ucpcal_binary_strings_add(
+				strings,
+				rule
+			);
+			free(rule);
+		}
+		i++;
+	}
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, UCPCAL_BINARY_MAGIC, sizeof(header.magic));
+	header.version = UCPCAL_BINARY_VERSION;
+	header.byte_order = UCPCAL_BINARY_BYTE_ORDER;
+	header.long_size = sizeof(long);
+	header.int_size = sizeof(int);
+	header.record_size = sizeof(ucpcal_binary_record);
+	header.count = count;
+	header.strings_length = strings->length;
+	/* Every offset must fit in a record, short of UCPCAL_BINARY_NONE. */
+	writer = strings->length <= UCPCAL_BINARY_NONE ?
+		ucpcal_writer_new(filename) : NULL;
+	if (writer) {
+		/* The records and strings are big enough to skip the buffer. */
+		ucpcal_writer_write(
+			writer,
+			(const char *) &header,
+			sizeof(header)
+		);
+		ucpcal_writer_write(
+			writer,
+			(const char *) records,
+			count * sizeof(ucpcal_binary_record)
+		);
+		ucpcal_writer_write(writer, strings->data, strings->length);
+		if (writer->failed)
+			ucpcal_writer_abort(writer);
+		else
+			result = ucpcal_writer_commit(writer);
+	}
+	free(records);
+	ucpcal_binary_strings_free(strings);
+	return result;
+}
+
+ucpcal_binary_strings *ucpcal_binary_strings_new(void) {
+	ucpcal_binary_strings *strings = (ucpcal_binary_strings *) malloc(
+		sizeof(ucpcal_binary_strings)
+	);
+	strings->data = NULL;
+	strings->length = 0;
+	strings->capacity = 0;
+	strings->slot_count = 1024;
+	strings->slots = (unsigned long *) calloc(
+		strings->slot_count,
+		sizeof(unsigned long)
+	);
+	strings->used = 0;
+	return strings;
+}
+
+void ucpcal_binary_strings_free(ucpcal_binary_strings *strings) {
+	if (strings) {
+		free(strings->data);
+		free(strings->slots);
+		free(strings);
+	}
+}
+
+unsigned long ucpcal_binary_strings_add(
+	ucpcal_binary_strings *strings,
+	const char *string
+) {
+	unsigned long result = UCPCAL_BINARY_NONE;
+	size_t length = ucpcal_string_length(string), mask, i;
+	/* Keep the table at most half full, so probe runs stay short. */
+	if ((strings->used + 1) * 2 > strings->slot_count)
+		ucpcal_binary_strings_grow(strings);
+	mask = strings->slot_count - 1;
+	i = ucpcal_hash_string(string) & mask;
+	while (result == UCPCAL_BINARY_NONE && strings->slots[i]) {
+		if (!ucpcal_string_compare(
+			strings->data + strings->slots[i] - 1,
+			string
+		))
+			result = strings->slots[i] - 1;
+		else
+			i = (i + 1) & mask;
+	}
+	if (result == UCPCAL_BINARY_NONE) {
+		if (strings->length + length + 1 > strings->capacity) {
+			if (!strings->capacity)
+				strings->capacity = 65536;
+			while (strings->length + length + 1 > strings->capacity)
+				strings->capacity *= 2;
+			strings->data = (char *) realloc(
+				strings->data,
+				strings->capacity
+			);
+		}
+		memcpy(strings->data + strings->length, string, length);
+		strings->data[strings->length + length] = 0;
+		result = strings->length;
+		strings->length += length + 1;
+		strings->slots[i] = result + 1;
+		strings->used++;
+	}
+	return result;
+}
+
+void ucpcal_binary_strings_grow(ucpcal_binary_strings *strings) {
+	unsigned long *old = strings->slots;
+	size_t old_count = strings->slot_count, mask, i, j;
+	strings->slot_count *= 2;
+	strings->slots = (unsigned long *) calloc(
+		strings->slot_count,
+		sizeof(unsigned long)
+	);
+	mask = strings->slot_count - 1;
+	for (i = 0; i < old_count; i++) {
+		if (old[i]) {
+			j = ucpcal_hash_string(strings->data + old[i] - 1) & mask;
+			while (strings->slots[j])
+				j = (j + 1) & mask;
+			strings->slots[j] = old[i];
+		}
+	}
+	free(old);
+}
@@ -0,0 +1,299 @@
+/**
+ * @file binary.h
+ * @brief Data structures and algorithms for binary calendar files.
+ */
+
+#ifndef UCPCAL_BINARY_H
+#define UCPCAL_BINARY_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "date.h"
+#include "event.h"
+#include "list.h"
+#include "hash.h"
+#include "arena.h"
+#include "map.h"
+#include "file.h"
+
+/**
+ * @brief The bytes every binary calendar file starts with.
+ */
+
+#define UCPCAL_BINARY_MAGIC "UCPCALB"
+
+/**
+ * @brief The version of the binary format written by ucpcal_binary_save().
+ * Bump this whenever the layout of the header or records changes.
+ */
+
+#define UCPCAL_BINARY_VERSION 1UL
+
+/**
+ * @brief A value whose bytes come out in a different order on machines of
+ * different byte order, to tell whether a file was written on one of them.
+ */
+
+#define UCPCAL_BINARY_BYTE_ORDER 0x01020304UL
+
+/**
+ * @brief The location or rule offset of a record without one.
+ */
+
+#define UCPCAL_BINARY_NONE ((unsigned int) -1)
+
+/**
+ * @brief A data structure representing the start of a binary calendar file.
+ * The file is written in the native layout of the machine, so that it can
+ * be used in place once mapped; the byte order and sizes recorded here let
+ * files from an incompatible machine be rejected rather than misread. The
+ * header is followed by the records, then the string table.
+ */
+
+typedef struct ucpcal_binary_header {
+	/**
+	 * UCPCAL_BINARY_MAGIC, including its null terminator.
+	 */
+	char magic[8];
+	unsigned long version;
+	/**
+	 * UCPCAL_BINARY_BYTE_ORDER, in the byte order of the writer.
+	 */
+	unsigned long byte_order;
+	/**
+	 * The size of a long, and so of every field after the magic and of
+	 * the start time of each record.
+	 */
+	unsigned long long_size;
+	/**
+	 * The size of an int, and so of every other field of a record.
+	 */
+	unsigned long int_size;
+	/**
+	 * The size of each record.
+	 */
+	unsigned long record_size;
+	/**
+	 * The number of records.
+	 */
+	unsigned long count;
+	/**
+	 * The number of bytes in the string table.
+	 */
+	unsigned long strings_length;
+} ucpcal_binary_header;
+
+/**
+ * @brief A data structure representing one event in a binary calendar file.
+ * Records are in order of start time, as in the list's index of start times,
+ * so the records in a range of times can be found by binary search.
+ * Offsets and durations are ints rather than longs, which keeps records to
+ * 24 bytes and limits the string table to 4 GB.
+ */
+
+typedef struct ucpcal_binary_record {
+	ucpcal_time start;
+	/**
+	 * The offset of the null terminated name in the string table.
+	 */
+	unsigned int name;
+	/**
+	 * The offset of the null terminated location in the string table, or
+	 * UCPCAL_BINARY_NONE if the event has no location.
+	 */
+	unsigned int location;
+	unsigned int duration;
+	/**
+	 * The offset of the null terminated rule in the string table, written
+	 * as in a calendar file, or UCPCAL_BINARY_NONE if the event does not
+	 * recur.
+	 */
+	unsigned int rule;
+} ucpcal_binary_record;
+
+/**
+ * @brief A data structure representing a binary calendar file open in place.
+ */
+
+typedef struct ucpcal_binary {
+	ucpcal_map *map;
+	const ucpcal_binary_header *header;
+	const ucpcal_binary_record *records;
+	const char *strings;
+} ucpcal_binary;
+
+/**
+ * @brief A data structure representing a string table being built.
+ * Each distinct string is stored once, found again through a hash table of
+ * offsets with linear probing.
+ */
+
+typedef struct ucpcal_binary_strings {
+	char *data;
+	size_t length;
+	size_t capacity;
+	/**
+	 * The slots of the hash table, each holding the offset of a string
+	 * plus one, or zero if empty. The number of slots is a power of two.
+	 */
+	unsigned long *slots;
+	size_t slot_count;
+	size_t used;
+} ucpcal_binary_strings;
+
+/**
+ * @brief Opens a binary calendar file for use in place.
+ * The file is mapped rather than read and is checked but not copied, so
+ * even a file of millions of events opens in milliseconds. Its pages are
+ * read as they are first touched, so the file must not be truncated while it
+ * is open. Problems are reported on stderr.
+ * Be sure to use ucpcal_binary_close() when finished.
+ * @param filename the file to open
+ * @return pointer to new ucpcal_binary struct, or NULL if the file could not
+ * be opened or is not a valid binary calendar file
+ */
+
+ucpcal_binary *ucpcal_binary_open(const char *filename);
+
+/**
+ * @brief Closes a binary calendar file opened with ucpcal_binary_open().
+ * @param binary the file to close, or NULL to do nothing
+ */
+
+void ucpcal_binary_close(ucpcal_binary *binary);
+
+/**
+ * @brief Checks that a mapped file is a valid binary calendar file.
+ * Every offset is checked against the string table, which must end with a
+ * null terminator, so that every string in the file can be used as is.
+ * @param map the mapped file
+ * @param error where to store a description of the problem on failure, or
+ * NULL on success
+ */
+
+void ucpcal_binary_check(const ucpcal_map *map, const char **error);
+
+/**
+ * @brief Gets the name of a record in a binary calendar file.
+ * @param binary the open file
+ * @param record the record
+ * @return the null terminated name, in place in the file
+ */
+
+const char *ucpcal_binary_name(
+	const ucpcal_binary *binary,
+	const ucpcal_binary_record *record
+);
+
+/**
+ * @brief Gets the location of a record in a binary calendar file.
+ * @param binary the open file
+ * @param record the record
+ * @return the null terminated location, in place in the file, or NULL if
+ * the record has none
+ */
+
+const char *ucpcal_binary_location(
+	const ucpcal_binary *binary,
+	const ucpcal_binary_record *record
+);
+
+/**
+ * @brief Finds the first record in a binary calendar file that starts at or
+ * after a time, by binary search.
+ * @param binary the open file
+ * @param start the time, in minutes since the Unix epoch
+ * @return the index of the record, or the number of records if there is none
+ */
+
+unsigned long ucpcal_binary_lower_bound(
+	const ucpcal_binary *binary,
+	ucpcal_time start
+);
+
+/**
+ * @brief Fills in an event from a record in a binary calendar file.
+ * The event borrows its name and location from the file, so it is only
+ * valid while the file is open. Its rule, if any, is parsed onto the heap.
+ * Be sure to use ucpcal_rule_free() on the rule when finished.
+ * @param binary the open file
+ * @param record the record
+ * @param event where to store the event
+ */
+
+void ucpcal_binary_event(
+	const ucpcal_binary *binary,
+	const ucpcal_binary_record *record,
+	ucpcal_event *event
+);
+
+/**
+ * @brief Checks whether a file starts like a binary calendar file.
+ * @param filename the file to check
+ * @return 1 if the file starts with UCPCAL_BINARY_MAGIC, 0 if it does not,
+ * or -1 if it could not be opened
+ */
+
+int ucpcal_binary_detect(const char *filename);
+
+/**
+ * @brief Loads a binary calendar file into a linked list of events.
+ * Events borrow their names and locations from a mapping of the file, as
+ * with ucpcal_load_mapped(), and their start times go straight into the
+ * tree without being worked out again. Problems are reported on stderr, and
+ * the list is left untouched if the file is not valid.
+ * @param list the linked list of calendar events
+ * @param filename the filename to look for input data in
+ * @return 0 if the file was loaded, or 1 if it could not be opened or is
+ * not valid
+ */
+
+int ucpcal_binary_load(ucpcal_list *list, const char *filename);
+
+/**
+ * @brief Saves a linked list of events to a binary calendar file.
+ * The file is replaced atomically, as with ucpcal_save().
+ * @param list the linked list of calendar events
+ * @param filename the filename to output calendar data to
+ * @return 0 on success, or -1 if the file could not be written or its
+ * strings would take more than 4 GB
+ */
+
+int ucpcal_binary_save(ucpcal_list *list, const char *filename);
+
+/**
+ * @brief Creates a new, empty string table on the heap.
+ * Be sure to use ucpcal_binary_strings_free() when finished.
+ * @return pointer to new ucpcal_binary_strings struct
+ */
+
+ucpcal_binary_strings *ucpcal_binary_strings_new(void);
+
+/**
+ * @brief Frees the memory used for a string table.
+ * @param strings the string table to be freed, or NULL to do nothing
+ */
+
+void ucpcal_binary_strings_free(ucpcal_binary_strings *strings);
+
+/**
+ * @brief Adds a string to a string table, unless it is already there.
+ * @param strings the string table
+ * @param string the null terminated string to add
+ * @return the offset of the string in the table
+ */
+
+unsigned long ucpcal_binary_strings_add(
+	ucpcal_binary_strings *strings,
+	const char *string
+);
+
+/**
+ * @brief Rebuilds the hash table of a string table with twice the slots.
+ * @param strings the string table
+ */
+
+void ucpcal_binary_strings_grow(ucpcal_binary_strings *strings);
+
+#endif
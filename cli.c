@@ -0,0 +1,11 @@
+/**
+ * @file cli.c
+ * @brief The headless calendar program source file.
+ */
+
+#include "cli.h"
+
+int main(int argc, char **argv) {
+	ucpcal_profile_init();
+	return ucpcal_command_main(argc, argv);
+}
@@ -0,0 +1,23 @@
+/**
+ * @file cli.h
+ * @brief The headless calendar program source file.
+ */
+
+#ifndef UCPCAL_CLI_H
+#define UCPCAL_CLI_H
+
+#include "command.h"
+
+/**
+ * @brief The main entry point for the headless calendar program.
+ * Nothing here depends on GTK+, so this program can be built and run on
+ * machines without a display or the GTK+ libraries; see
+ * ucpcal_command_main() for the subcommands it understands.
+ * @param argc the number of command line arguments
+ * @param argv the command line argument vector
+ * @return 1 where an error has occurred, 0 otherwise
+ */
+
+int main(int argc, char **argv);
+
+#endif
@@ -0,0 +1,313 @@
+/**
+ * @file columns.c
+ * @brief Data structures and algorithms for columnar stores of list nodes.
+ */
+
+#include "columns.h"
+#include "list.h"
+
+ucpcal_columns *ucpcal_columns_new(void) {
+	ucpcal_columns *columns = (ucpcal_columns *) malloc(
+		sizeof(ucpcal_columns)
+	);
+	columns->starts = NULL;
+	columns->durations = NULL;
+	columns->names = NULL;
+	columns->locations = NULL;
+	columns->handles = NULL;
+	columns->count = 0;
+	columns->capacity = 0;
+	columns->sorted = 0;
+	columns->removed = 0;
+	columns->positions = NULL;
+	columns->nodes = NULL;
+	columns->handle_count = 0;
+	columns->handle_capacity = 0;
+	columns->free_handle = UCPCAL_COLUMNS_NONE;
+	return columns;
+}
+
+void ucpcal_columns_free(ucpcal_columns *columns) {
+	if (columns) {
+		free(columns->starts);
+		free(columns->durations);
+		free(columns->names);
+		free(columns->locations);
+		free(columns->handles);
+		free(columns->positions);
+		free(columns->nodes);
+		free(columns);
+	}
+}
+
+void ucpcal_columns_insert(ucpcal_columns *columns, ucpcal_node *node) {
+	ucpcal_time start = ucpcal_time_from_date(node->event->date);
+	size_t position = columns->count++;
+	unsigned int handle = columns->free_handle;
+	if (position == columns->capacity)
+		ucpcal_columns_resize(
+			columns,
+			columns->capacity ? columns->capacity * 2 : 1024
+		);
+	if (handle != UCPCAL_COLUMNS_NONE) {
+		columns->free_handle = columns->positions[handle];
+	} else {
+		if (columns->handle_count == columns->handle_capacity) {
+			columns->handle_capacity = columns->handle_capacity ?
+				columns->handle_capacity * 2 : 1024;
+			columns->positions = (size_t *) realloc(
+				columns->positions,
+				columns->handle_capacity * sizeof(size_t)
+			);
+			columns->nodes = (ucpcal_node **) realloc(
+				columns->nodes,
+				columns->handle_capacity * sizeof(ucpcal_node *)
+			);
+		}
+		handle = columns->handle_count++;
+	}
+	/* A node starting no earlier than the last keeps the store sorted. */
+	if (
+		columns->sorted == position &&
+		(!position || columns->starts[position - 1] <= start)
+	)
+		columns->sorted++;
+	columns->starts[position] = start;
+	columns->durations[position] = node->event->duration;
+	columns->names[position] = node->event->name;
+	columns->locations[position] = node->event->location;
+	columns->handles[position] = handle;
+	columns->positions[handle] = position;
+	columns->nodes[handle] = node;
+	node->column = handle;
+}
+
+void ucpcal_columns_remove(ucpcal_columns *columns, ucpcal_node *node) {
+	unsigned int handle = node->column;
+	size_t position = columns->positions[handle];
+	/* Gaps add nothing to totals, and are skipped by sweeps. */
+	columns->durations[position] = 0;
+	columns->names[position] = NULL;
+	columns->locations[position] = NULL;
+	columns->handles[position] = UCPCAL_COLUMNS_NONE;
+	columns->removed++;
+	columns->nodes[handle] = NULL;
+	columns->positions[handle] = columns->free_handle;
+	columns->free_handle = handle;
+}
+
+void ucpcal_columns_resize(ucpcal_columns *columns, size_t capacity) {
+	columns->capacity = capacity;
+	columns->starts = (ucpcal_time *) realloc(
+		columns->starts,
+		capacity * sizeof(ucpcal_time)
+	);
+	columns->durations = (unsigned int *) realloc(
+		columns->durations,
+		capacity * sizeof(unsigned int)
+	);
+	columns->names = (const char **) realloc(
+		columns->names,
+		capacity * sizeof(const char *)
+	);
+	columns->locations = (const char **) realloc(
+		columns->locations,
+		capacity * sizeof(const char *)
+	);
+	columns->handles = (unsigned int *) realloc(
+		columns->handles,
+		capacity * sizeof(unsigned int)
+	);
+}
+
+void ucpcal_columns_tidy(ucpcal_columns *columns) {
+	ucpcal_columns *appended;
+	ucpcal_node **nodes;
+	size_t count = 0, kept = 0, i, j;
+	if (columns->sorted < columns->count || columns->removed) {
+		/* Sort the nodes appended since, as the tree orders them. */
+		nodes = (ucpcal_node **) malloc(
+			(columns->count - columns->sorted + 1) *
+			sizeof(ucpcal_node *)
+		);
+		for (i = columns->sorted; i < columns->count; i++)
+			if (columns->handles[i] != UCPCAL_COLUMNS_NONE)
+				nodes[count++] =
+					columns->nodes[columns->handles[i]];
+		qsort(nodes, count, sizeof(ucpcal_node *), ucpcal_tree_compare);
+		appended = ucpcal_columns_new();
+		ucpcal_columns_resize(appended, count + 1);
+		for (i = 0; i < count; i++)
+			ucpcal_columns_copy(
+				appended,
+				i,
+				columns,
+				columns->positions[nodes[i]->column]
+			);
+		/* Close up the gaps in the rest, keeping them in order. */
+		for (i = 0; i < columns->sorted; i++)
+			if (columns->handles[i] != UCPCAL_COLUMNS_NONE)
+				ucpcal_columns_copy(
+					columns,
+					kept++,
+					columns,
+					i
+				);
+		/*
+			Merge from the back, so that nothing is overwritten
+			before it moves. The rest were all inserted earlier,
+			so they go first among events with the same start.
+		*/
+		columns->count = kept + count;
+		i = kept;
+		j = count;
+		while (j) {
+			if (
+				i &&
+				columns->starts[i - 1] > appended->starts[j - 1]
+			) {
+				i--;
+				ucpcal_columns_copy(columns, i + j, columns, i);
+			} else {
+				j--;
+				ucpcal_columns_copy(
+					columns,
+					i + j,
+					appended,
+					j
+				);
+			}
+		}
+		for (i = 0; i < columns->count; i++)
+			columns->positions[columns->handles[i]] = i;
+		columns->sorted = columns->count;
+		columns->removed = 0;
+		ucpcal_columns_free(appended);
+		free(nodes);
+	}
+}
+
+void ucpcal_columns_copy(
+	ucpcal_columns *to,
+	size_t to_position,
+	const ucpcal_columns *from,
+	size_t from_position
+) {
+	to->starts[to_position] = from->starts[from_position];
+	to->durations[to_position] = from->durations[from_position];
+	to->names[to_position] = from->names[from_position];
+	to->locations[to_position] = from->locations[from_position];
+	to->handles[to_position] = from->handles[from_position];
+}
+
+size_t ucpcal_columns_lower_bound(
+	ucpcal_columns *columns,
+	ucpcal_time time
+) {
+	size_t low = 0, high = columns->count, middle;
+	while (low < high) {
+		middle = low + (high - low) / 2;
+		if (columns->starts[middle] < time)
+			low = middle + 1;
+		else
+			high = middle;
+	}
+	return low;
+}
+
+unsigned long ucpcal_columns_total(
+	ucpcal_columns *columns,
+	size_t first,
+	size_t last
+) {
+	unsigned long total = 0;
+	size_t i;
+	for (i = first; i < last; i++)
+		total += columns->durations[i];
+	return total;
+}
+
+unsigned int *ucpcal_columns_conflicts(
+	ucpcal_columns *columns,
+	size_t *count
+) {
+	/* The pairs found so far, two handles per pair. */
+	size_t used = 0, capacity = 16;
+	unsigned int *result = (unsigned int *) malloc(
+		capacity * sizeof(unsigned int)
+	);
+	/* A binary min-heap of the positions that have not yet ended. */
+	size_t active = 0, active_capacity = 16;
+	size_t *heap = (size_t *) malloc(active_capacity * sizeof(size_t));
+	/* Work out every end time up front, in one pass. */
+	ucpcal_time *ends = (ucpcal_time *) malloc(
+		(columns->count ? columns->count : 1) * sizeof(ucpcal_time)
+	);
+	size_t cur, i, child, swap;
+	int done;
+	for (cur = 0; cur < columns->count; cur++)
+		ends[cur] = ucpcal_time_end(
+			columns->starts[cur],
+			columns->durations[cur]
+		);
+	for (cur = 0; cur < columns->count; cur++) {
+		/* Retire every event that ended by the time this one starts. */
+		while (active && ends[heap[0]] <= columns->starts[cur]) {
+			/* Sift the last event down from the top of the heap. */
+			heap[0] = heap[--active];
+			i = 0;
+			done = 0;
+			while (!done && (child = i * 2 + 1) < active) {
+				if (
+					child + 1 < active &&
+					ends[heap[child + 1]] <
+					ends[heap[child]]
+				)
+					child++;
+				if (ends[heap[i]] > ends[heap[child]]) {
+					swap = heap[i];
+					heap[i] = heap[child];
+					heap[child] = swap;
+					i = child;
+				} else {
+					done = 1;
+				}
+			}
+		}
+		/* Events with no duration overlap nothing. */
+		if (ends[cur] > columns->starts[cur]) {
+			/* Every event still active overlaps this one. */
+			for (i = 0; i < active; i++) {
+				if (used + 2 > capacity) {
+					capacity *= 2;
+					result = (unsigned int *) realloc(
+						result,
+						capacity * sizeof(unsigned int)
+					);
+				}
+				result[used++] = columns->handles[heap[i]];
+				result[used++] = columns->handles[cur];
+			}
+			if (active == active_capacity) {
+				active_capacity *= 2;
+				heap = (size_t *) realloc(
+					heap,
+					active_capacity * sizeof(size_t)
+				);
+			}
+			/* Sift the new event up to its place in the heap. */
+			i = active++;
+			heap[i] = cur;
+			while (i && ends[heap[(i - 1) / 2]] > ends[heap[i]]) {
+				swap = heap[i];
+				heap[i] = heap[(i - 1) / 2];
+				heap[(i - 1) / 2] = swap;
+				i = (i - 1) / 2;
+			}
+		}
+	}
+	free(ends);
+	free(heap);
+	*count = used / 2;
+	return result;
+}
@@ -0,0 +1,214 @@
+/**
+ * @file columns.h
+ * @brief Data structures and algorithms for columnar stores of list nodes.
+ */
+
+#ifndef UCPCAL_COLUMNS_H
+#define UCPCAL_COLUMNS_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "event.h"
+
+/*
+	As with trigram.h, list.h embeds a store in each list, so the node
+	structure can only be declared incompletely here.
+*/
+struct ucpcal_node;
+
+/**
+ * @brief The handle given to no node, ending the list of free handles.
+ */
+
+#define UCPCAL_COLUMNS_NONE ((unsigned int) -1)
+
+/**
+ * @brief A data structure holding the fields of list nodes' events in
+ * separate, dense arrays, one element per event, in order of start time.
+ * Scans over many events, such as totalling durations or sweeping for
+ * conflicts, then read memory in order instead of following a pointer to
+ * each node and another to its event.
+ * Each node is given a handle when inserted, which stays the same until the
+ * node is removed, however the node's position in the arrays changes.
+ * Inserting a node appends it and removing one leaves a gap, both in O(1)
+ * time, so the store must be tidied by ucpcal_columns_tidy() before it is
+ * scanned.
+ */
+
+typedef struct ucpcal_columns {
+	/**
+	 * The start time of each event, in minutes since the Unix epoch.
+	 */
+	ucpcal_time *starts;
+	/**
+	 * The duration of each event, in minutes.
+	 */
+	unsigned int *durations;
+	/**
+	 * The name and location of each event, shared with the event itself,
+	 * where the location may be NULL.
+	 */
+	const char **names;
+	const char **locations;
+	/**
+	 * The handle of the node at each position, or UCPCAL_COLUMNS_NONE for
+	 * a gap left by a removed node, whose duration is zero and whose name
+	 * and location are NULL.
+	 */
+	unsigned int *handles;
+	/**
+	 * The number of positions used, including gaps, and the room for them
+	 * in each array above.
+	 */
+	size_t count;
+	size_t capacity;
+	/**
+	 * The number of positions, from the first, that are in order. Those
+	 * after them have been appended since the store was last tidied.
+	 */
+	size_t sorted;
+	/**
+	 * The number of gaps.
+	 */
+	size_t removed;
+	/**
+	 * The position of the node given each handle. For a free handle, the
+	 * next free handle instead, or UCPCAL_COLUMNS_NONE.
+	 */
+	size_t *positions;
+	/**
+	 * The node given each handle, or NULL where the handle is free.
+	 */
+	struct ucpcal_node **nodes;
+	/**
+	 * The number of handles ever given out, and the room for them.
+	 */
+	size_t handle_count;
+	size_t handle_capacity;
+	/**
+	 * The most recently freed handle, which is given out next, or
+	 * UCPCAL_COLUMNS_NONE.
+	 */
+	unsigned int free_handle;
+} ucpcal_columns;
+
+/**
+ * @brief Creates a new, empty columnar store on the heap.
+ * Be sure to use ucpcal_columns_free() when finished.
+ * @return pointer to new ucpcal_columns struct
+ */
+
+ucpcal_columns *ucpcal_columns_new(void);
+
+/**
+ * @brief Frees the memory used for a columnar store.
+ * The nodes and strings referred to by the store are not freed.
+ * @param columns the columnar store to be freed, or NULL
+ */
+
+void ucpcal_columns_free(ucpcal_columns *columns);
+
+/**
+ * @brief Inserts a node into a columnar store, giving it a handle.
+ * The node is appended, so it stays in order only if it starts no earlier
+ * than the last node, as when inserting nodes in the order of a list's index
+ * of start times.
+ * @param columns the columnar store
+ * @param node the node, whose event's fields are stored
+ */
+
+void ucpcal_columns_insert(ucpcal_columns *columns, struct ucpcal_node *node);
+
+/**
+ * @brief Removes a node from a columnar store, freeing its handle.
+ * The node's position is left as a gap until the store is next tidied.
+ * @param columns the columnar store
+ * @param node the node to remove
+ */
+
+void ucpcal_columns_remove(ucpcal_columns *columns, struct ucpcal_node *node);
+
+/**
+ * @brief Changes the room for events in each of a columnar store's arrays.
+ * @param columns the columnar store
+ * @param capacity the new number of positions, which must be at least the
+ * number used
+ */
+
+void ucpcal_columns_resize(ucpcal_columns *columns, size_t capacity);
+
+/**
+ * @brief Puts a columnar store back in order of start time, without gaps.
+ * Nodes appended since the store was last tidied are sorted by their order
+ * in the list's index of start times, then merged with the rest, so this
+ * takes O(n + m log m) time for m nodes appended, or none if nothing has
+ * changed.
+ * @param columns the columnar store
+ */
+
+void ucpcal_columns_tidy(ucpcal_columns *columns);
+
+/**
+ * @brief Copies the fields of the event at one position in a columnar store
+ * to a position in another, or the same, store.
+ * Only the arrays of fields are touched, so the positions of handles must
+ * then be brought up to date by the caller.
+ * @param to the columnar store to copy to
+ * @param to_position the position to copy to
+ * @param from the columnar store to copy from
+ * @param from_position the position to copy from
+ */
+
+void ucpcal_columns_copy(
+	ucpcal_columns *to,
+	size_t to_position,
+	const ucpcal_columns *from,
+	size_t from_position
+);
+
+/**
+ * @brief Finds the position of the first event starting at or after a time.
+ * The store must be tidy.
+ * @param columns the columnar store
+ * @param time the time, in minutes since the Unix epoch
+ * @return the position, which is the number of events if there is none
+ */
+
+size_t ucpcal_columns_lower_bound(
+	ucpcal_columns *columns,
+	ucpcal_time time
+);
+
+/**
+ * @brief Adds up the durations of the events in a range of positions.
+ * @param columns the columnar store
+ * @param first the position of the first event, inclusive
+ * @param last the position of the last event, exclusive
+ * @return the total duration, in minutes
+ */
+
+unsigned long ucpcal_columns_total(
+	ucpcal_columns *columns,
+	size_t first,
+	size_t last
+);
+
+/**
+ * @brief Finds every pair of overlapping events in a columnar store.
+ * Events overlap as for ucpcal_list_overlaps(). The store must be tidy.
+ * Runs in O(n log n + k) time for k pairs, sweeping the events in order of
+ * start time while keeping a binary min-heap of the events that have not
+ * yet ended. Be sure to use free() on the result when finished.
+ * @param columns the columnar store
+ * @param count where to store the number of pairs found
+ * @return a heap allocated array of the handles of each pair's events, two
+ * per pair, in order of the start time of the second event of each pair
+ */
+
+unsigned int *ucpcal_columns_conflicts(
+	ucpcal_columns *columns,
+	size_t *count
+);
+
+#endif
@@ -0,0 +1,492 @@
+/**
+ * @file command.c
+ * @brief Algorithms for working on calendar files from the command line.
+ */
+
+#include "command.h"
+
+int ucpcal_command_main(int argc, char **argv) {
+	const ucpcal_command *command = ucpcal_command_table();
+	int mode = UCPCAL_LOAD_BUFFERED, option = 0, return_value = 1;
+	if (argc > 1 && !strcmp(argv[1], "-m"))
+		mode = UCPCAL_LOAD_MAPPED;
+	else if (argc > 1 && !strcmp(argv[1], "-p"))
+		mode = UCPCAL_LOAD_PARALLEL;
+	option = mode != UCPCAL_LOAD_BUFFERED;
+	if (argc > 1 + option)
+		while (
+			command->name &&
+			strcmp(command->name, argv[1 + option])
+		)
+			command++;
+	if (argc > 1 + option && command->name)
+		return_value = command->run(
+			argc - 2 - option,
+			argv + 2 + option,
+			mode
+		);
+	else
+		ucpcal_command_usage(argv[0]);
+	return return_value;
+}
+
+const ucpcal_command *ucpcal_command_table(void) {
+	static const ucpcal_command commands[] = {
+		{ "load", "file", &ucpcal_command_load },
+		{ "query", "file [-a date] [-b date] [-n name] [-l location]",
+			&ucpcal_command_query },
+		{ "add", "file date duration name [location]",
+			&ucpcal_command_add },
+		{ "delete", "file name", &ucpcal_command_delete },
+		{ "convert", "from to", &ucpcal_command_convert },
+		{ "stats", "file", &ucpcal_command_stats },
+		{ "save", "file [to]", &ucpcal_command_save },
+		{ "filter", "from to [-a date] [-b date] [-n name] "
+			"[-l location]", &ucpcal_command_filter },
+		{ "generate", "file events [-s seed] [-w name words] "
+			"[-l location percent] [-u locations] "
+			"[-d max duration]", &ucpcal_command_generate },
+		{ NULL, NULL, NULL }
+	};
+	return commands;
+}
+
+void ucpcal_command_usage(const char *program) {
+	const ucpcal_command *command = ucpcal_command_table();
+	fprintf(stderr, "Usage:\n");
+	for (; command->name; command++)
+		fprintf(stderr,
+			"  %s [-m|-p] %s %s\n",
+			program,
+			command->name,
+			command->usage
+		);
+	fprintf(stderr, "Dates are one argument, \"YYYY-MM-DD HH:MM\".\n");
+}
+
+int ucpcal_command_open(ucpcal_list *list, const char *filename, int mode) {
+	int result = 0;
+	if (ucpcal_binary_detect(filename) < 0) {
+		fprintf(stderr, "%s: cannot open file\n", filename);
+		result = 1;
+	} else {
+		ucpcal_profile_start(UCPCAL_PROFILE_LOAD);
+		result = ucpcal_load_mode(list, filename, mode, NULL);
+		ucpcal_journal_replay(list, filename);
+		ucpcal_profile_stop(UCPCAL_PROFILE_LOAD);
+	}
+	return result;
+}
+
+int ucpcal_command_load(int argc, char **argv, int mode) {
+	ucpcal_list *list = ucpcal_list_new();
+	unsigned long count = 0;
+	ucpcal_node *cur;
+	int return_value = 1;
+	if (argc != 1)
+		fprintf(stderr, "Usage: load file\n");
+	else if (!ucpcal_command_open(list, argv[0], mode))
+		return_value = 0;
+	if (!return_value) {
+		for (cur = list->head; cur; cur = cur->next)
+			count++;
+		printf("%lu events\n", count);
+	}
+	ucpcal_list_free(list);
+	return return_value;
+}
+
+int ucpcal_command_query(int argc, char **argv, int mode) {
+	ucpcal_filter filter = ucpcal_filter_all();
+	ucpcal_list *list = ucpcal_list_new();
+	ucpcal_writer *writer;
+	ucpcal_node *cur;
+	int return_value = 1, binary = 0;
+	if (argc < 1) {
+		fprintf(stderr, "Usage: query file [-a date] [-b date] "
+			"[-n name] [-l location]\n");
+	} else if (!ucpcal_command_parse_filter(argc - 1, argv + 1, &filter)) {
+		/* Changes waiting in a journal need the whole file loaded. */
+		binary = ucpcal_binary_detect(argv[0]) > 0 &&
+			!ucpcal_journal_pending(argv[0]);
+		if (binary)
+			return_value = ucpcal_command_query_binary(
+				argv[0],
+				&filter
+			);
+		else
+			return_value =
+				ucpcal_command_open(list, argv[0], mode) != 0;
+	}
+	if (!return_value && !binary) {
+		/*
+			The index finds the start of the range, and the events
+			after it come in order of start time, so the walk stops
+			at the end of the range rather than the end of the list.
+		*/
+		cur = filter.has_from ?
+			ucpcal_tree_lower_bound(list->times, filter.from) :
+			ucpcal_tree_first(list->times);
+		writer = ucpcal_writer_new_fd(1);
+		while (
+			cur &&
+			(!filter.has_to || cur->when.start < filter.to)
+		) {
+			if (ucpcal_filter_match(&filter, cur->event))
+				ucpcal_save_event(writer, cur->event);
+			cur = ucpcal_tree_next(cur);
+		}
+		return_value = ucpcal_writer_commit(writer) != 0;
+	}
+	ucpcal_list_free(list);
+	return return_value;
+}
+
+int ucpcal_command_query_binary(
+	const char *filename,
+	const ucpcal_filter *filter
+) {
+	ucpcal_binary *binary;
+	ucpcal_writer *writer;
+	ucpcal_event event;
+	unsigned long i;
+	int return_value = 1;
+	ucpcal_profile_start(UCPCAL_PROFILE_LOAD);
+	binary = ucpcal_binary_open(filename);
+	ucpcal_profile_stop(UCPCAL_PROFILE_LOAD);
+	if (binary) {
+		/* Records are in order, so the range is searched for. */
+		i = filter->has_from ?
+			ucpcal_binary_lower_bound(binary, filter->from) : 0;
+		writer = ucpcal_writer_new_fd(1);
+		while (
+			i < binary->header->count && (
+				!filter->has_to ||
+				binary->records[i].start < filter->to
+			)
+		) {
+			ucpcal_binary_event(
+				binary,
+				&binary->records[i],
+				&event
+			);
+			if (ucpcal_filter_match(filter, &event))
+				ucpcal_save_event(writer, &event);
+			ucpcal_rule_free(event.rule);
+			i++;
+		}
+		return_value = ucpcal_writer_commit(writer) != 0;
+		ucpcal_binary_close(binary);
+	}
+	return return_value;
+}
+
+int ucpcal_command_add(int argc, char **argv, int mode) {
+	ucpcal_list *list = ucpcal_list_new();
+	ucpcal_journal *journal;
+	ucpcal_event *event;
+	ucpcal_time start;
+	unsigned int duration;
+	const char *error;
+	int return_value = 1;
+	if (argc != 4 && argc != 5)
+		fprintf(stderr,
+			"Usage: add file date duration name [location]\n");
+	else if (
+		argc == 5 &&
+		ucpcal_rule_line(argv[4], argv[4] + strlen(argv[4]), &error)
+	)
+		fprintf(stderr,
+			"%s: a location cannot start with \""
+			UCPCAL_RULE_PREFIX "\"\n",
+			argv[4]);
+	else if (
+		!ucpcal_parse_time_argument(argv[1], &start) &&
+		!ucpcal_parse_duration_argument(argv[2], &duration) &&
+		!ucpcal_command_open(list, argv[0], mode)
+	)
+		return_value = 0;
+	if (!return_value) {
+		event = ucpcal_event_new();
+		event->date = ucpcal_time_to_date(start);
+		event->duration = duration;
+		event->name = ucpcal_journal_string(argv[3], strlen(argv[3]));
+		if (argc == 5 && *argv[4])
+			event->location = ucpcal_journal_string(
+				argv[4],
+				strlen(argv[4])
+			);
+		/* The list copies the event into its arena. */
+		event = ucpcal_list_append(list, event);
+		if (!event) {
+			fprintf(stderr,
+				"%s: already in %s\n",
+				argv[3],
+				argv[0]
+			);
+			return_value = 1;
+		} else {
+			journal = ucpcal_journal_new(argv[0]);
+			ucpcal_journal_add(journal, event);
+			return_value = ucpcal_journal_flush(journal) != 0;
+			ucpcal_journal_free(journal);
+		}
+	}
+	ucpcal_list_free(list);
+	return return_value;
+}
+
+int ucpcal_command_delete(int argc, char **argv, int mode) {
+	ucpcal_list *list = ucpcal_list_new();
+	ucpcal_journal *journal;
+	int return_value = 1;
+	if (argc != 2)
+		fprintf(stderr, "Usage: delete file name\n");
+	else if (!ucpcal_command_open(list, argv[0], mode))
+		return_value = 0;
+	if (!return_value) {
+		if (!ucpcal_list_find(list, argv[1])) {
+			fprintf(stderr, "%s: not in %s\n", argv[1], argv[0]);
+			return_value = 1;
+		} else {
+			journal = ucpcal_journal_new(argv[0]);
+			ucpcal_journal_delete(journal, argv[1]);
+			return_value = ucpcal_journal_flush(journal) != 0;
+			ucpcal_journal_free(journal);
+		}
+	}
+	ucpcal_list_free(list);
+	return return_value;
+}
+
+int ucpcal_command_convert(int argc, char **argv, int mode) {
+	ucpcal_list *list = ucpcal_list_new();
+	int return_value = 1;
+	if (argc != 2)
+		fprintf(stderr, "Usage: convert from to\n");
+	else if (!ucpcal_command_open(list, argv[0], mode))
+		return_value = 0;
+	if (!return_value) {
+		/* The journal is replayed into the list, so it is converted. */
+		ucpcal_profile_start(UCPCAL_PROFILE_SAVE);
+		if (ucpcal_binary_detect(argv[0]) > 0)
+			return_value = ucpcal_save(list, argv[1]) != 0;
+		else
+			return_value = ucpcal_binary_save(list, argv[1]) != 0;
+		ucpcal_profile_stop(UCPCAL_PROFILE_SAVE);
+		if (return_value)
+			fprintf(stderr, "%s: cannot write file\n", argv[1]);
+	}
+	ucpcal_list_free(list);
+	return return_value;
+}
+
+int ucpcal_command_stats(int argc, char **argv, int mode) {
+	ucpcal_list *list = ucpcal_list_new();
+	unsigned long count = 0, located = 0;
+	/* Summed in a long, as many durations can overflow an int. */
+	unsigned long total = 0;
+	ucpcal_columns *columns;
+	ucpcal_conflict *conflicts;
+	size_t pairs, i;
+	int return_value = 1;
+	if (argc != 1)
+		fprintf(stderr, "Usage: stats file\n");
+	else if (!ucpcal_command_open(list, argv[0], mode))
+		return_value = 0;
+	if (!return_value) {
+		/* Every figure comes from streaming through the columns. */
+		columns = ucpcal_list_columns(list);
+		count = columns->count;
+		for (i = 0; i < columns->count; i++)
+			if (columns->locations[i])
+				located++;
+		total = ucpcal_columns_total(columns, 0, columns->count);
+		conflicts = ucpcal_list_conflicts(list, &pairs);
+		free(conflicts);
+		printf("events: %lu\n", count);
+		printf("with location: %lu\n", located);
+		if (count) {
+			printf("first start: ");
+			ucpcal_command_print_time(columns->starts[0]);
+			printf("\nlast start: ");
+			ucpcal_command_print_time(columns->starts[count - 1]);
+			printf("\n");
+		}
+		printf("total duration: %lu minutes\n", total);
+		printf("overlapping pairs: %lu\n", (unsigned long) pairs);
+	}
+	ucpcal_list_free(list);
+	return return_value;
+}
+
+int ucpcal_command_save(int argc, char **argv, int mode) {
+	ucpcal_list *list = ucpcal_list_new();
+	ucpcal_journal *journal;
+	const char *to = argc == 2 ? argv[1] : argv[0];
+	int return_value = 1;
+	if (argc != 1 && argc != 2)
+		fprintf(stderr, "Usage: save file [to]\n");
+	else if (!ucpcal_command_open(list, argv[0], mode))
+		return_value = 0;
+	if (!return_value) {
+		journal = ucpcal_journal_new(to);
+		ucpcal_profile_start(UCPCAL_PROFILE_SAVE);
+		if (argc == 1) {
+			return_value = ucpcal_journal_compact(journal, list);
+		} else {
+			/* Keep the calendar in whichever format it was in. */
+			if (ucpcal_binary_detect(argv[0]) > 0)
+				return_value = ucpcal_binary_save(list, to);
+			else
+				return_value = ucpcal_save(list, to);
+			/* Nothing is left to replay into the new file. */
+			if (!return_value)
+				ucpcal_journal_discard(journal);
+		}
+		ucpcal_profile_stop(UCPCAL_PROFILE_SAVE);
+		ucpcal_journal_free(journal);
+		if (return_value) {
+			fprintf(stderr, "%s: cannot write file\n", to);
+			return_value = 1;
+		}
+	}
+	ucpcal_list_free(list);
+	return return_value;
+}
+
+int ucpcal_command_filter(int argc, char **argv, int mode) {
+	ucpcal_filter filter = ucpcal_filter_all();
+	int return_value = 1;
+	(void) mode;
+	if (argc < 2)
+		fprintf(stderr, "Usage: filter from to [-a date] [-b date] "
+			"[-n name] [-l location]\n");
+	else if (ucpcal_journal_pending(argv[0]))
+		/* Streaming the file alone would miss the journal's changes. */
+		fprintf(stderr,
+			"%s: has unsaved changes in its journal; "
+				"use save first, or query\n",
+			argv[0]
+		);
+	else if (!ucpcal_command_parse_filter(argc - 2, argv + 2, &filter))
+		return_value = ucpcal_filter_file(&filter, argv[0], argv[1]);
+	return return_value;
+}
+
+int ucpcal_command_generate(int argc, char **argv, int mode) {
+	ucpcal_generator generator;
+	unsigned long count = 0, value = 0;
+	int return_value = 1, i;
+	char *end;
+	(void) mode;
+	ucpcal_generator_init(&generator, 1);
+	if (argc >= 2 && argc % 2 == 0) {
+		count = strtoul(argv[1], &end, 10);
+		return_value = !*argv[1] || *end;
+	}
+	for (i = 2; i < argc && !return_value; i += 2) {
+		value = strtoul(argv[i + 1], &end, 10);
+		if (!*argv[i + 1] || *end)
+			return_value = 1;
+		else if (!strcmp(argv[i], "-s"))
+			ucpcal_generator_seed(&generator, value);
+		else if (!strcmp(argv[i], "-w") && value <= 20)
+			generator.name_words = value;
+		else if (!strcmp(argv[i], "-l") && value <= 100)
+			generator.location_percent = value;
+		else if (!strcmp(argv[i], "-u") && value > 0)
+			generator.locations = value;
+		else if (!strcmp(argv[i], "-d") && value < 1000000000)
+			generator.max_duration = value;
+		else
+			return_value = 1;
+	}
+	if (return_value)
+		fprintf(stderr, "Usage: generate file events [-s seed] "
+			"[-w name words] [-l location percent] "
+			"[-u locations] [-d max duration]\n");
+	else if (ucpcal_generate_file(&generator, argv[0], count)) {
+		fprintf(stderr, "%s: cannot write file\n", argv[0]);
+		return_value = 1;
+	}
+	return return_value;
+}
+
+int ucpcal_command_parse_filter(
+	int argc,
+	char **argv,
+	ucpcal_filter *filter
+) {
+	int return_value = 0, i;
+	for (i = 0; i < argc && !return_value; i += 2) {
+		if (i + 1 == argc) {
+			fprintf(stderr, "%s: expected a value\n", argv[i]);
+			return_value = 1;
+		} else if (!strcmp(argv[i], "-a")) {
+			filter->has_from = 1;
+			return_value = ucpcal_parse_time_argument(
+				argv[i + 1],
+				&filter->from
+			);
+		} else if (!strcmp(argv[i], "-b")) {
+			filter->has_to = 1;
+			return_value = ucpcal_parse_time_argument(
+				argv[i + 1],
+				&filter->to
+			);
+		} else if (!strcmp(argv[i], "-n")) {
+			filter->name = argv[i + 1];
+		} else if (!strcmp(argv[i], "-l")) {
+			filter->location = argv[i + 1];
+		} else {
+			fprintf(stderr, "%s: unknown option\n", argv[i]);
+			return_value = 1;
+		}
+	}
+	return return_value;
+}
+
+int ucpcal_parse_time_argument(const char *text, ucpcal_time *time) {
+	const char *end = text + strlen(text), *error, *cur;
+	ucpcal_date date;
+	cur = ucpcal_date_parse(text, end, &date, &error);
+	if (!error && cur != end)
+		error = "unexpected text after the date";
+	if (error)
+		fprintf(stderr,
+			"%s:%lu: %s\n",
+			text,
+			(unsigned long) (cur - text) + 1,
+			error
+		);
+	else
+		*time = ucpcal_time_from_date(date);
+	return error != NULL;
+}
+
+int ucpcal_parse_duration_argument(const char *text, unsigned int *duration) {
+	const char *end = text + strlen(text);
+	int value;
+	int result = ucpcal_date_parse_number(text, end, 9, &value) != end;
+	if (result)
+		fprintf(stderr,
+			"%s: expected a duration of up to 9 digits\n",
+			text
+		);
+	else
+		*duration = value;
+	return result;
+}
+
+void ucpcal_command_print_time(ucpcal_time time) {
+	ucpcal_date date = ucpcal_time_to_date(time);
+	printf(
+		"%04d-%02d-%02d %02d:%02d",
+		date.year,
+		date.month,
+		date.day,
+		date.hour,
+		date.minute
+	);
+}
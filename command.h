@@ -0,0 +1,267 @@
+/**
+ * @file command.h
+ * @brief Algorithms for working on calendar files from the command line.
+ */
+
+#ifndef UCPCAL_COMMAND_H
+#define UCPCAL_COMMAND_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "date.h"
+#include "event.h"
+#include "list.h"
+#include "file.h"
+#include "binary.h"
+#include "journal.h"
+#include "stream.h"
+#include "writer.h"
+#include "generate.h"
+#include "profile.h"
+
+/**
+ * @brief A data structure describing one command line subcommand.
+ * Each subcommand is given the arguments following its name, and the mode
+ * to load calendar files in, as passed to ucpcal_load_mode().
+ */
+
+typedef struct ucpcal_command {
+	const char *name;
+	/**
+	 * The arguments the subcommand takes, for usage messages.
+	 */
+	const char *usage;
+	int (*run)(int argc, char **argv, int mode);
+} ucpcal_command;
+
+/**
+ * @brief Runs a subcommand named on the command line, without the GUI.
+ * The arguments are an optional -m or -p, which select the load mode as
+ * for the GUI, then the name of the subcommand and its arguments. A
+ * usage message listing every subcommand is printed if none matches.
+ * @param argc the number of arguments
+ * @param argv the arguments, starting after the program name
+ * @return 1 where an error has occurred, 0 otherwise
+ */
+
+int ucpcal_command_main(int argc, char **argv);
+
+/**
+ * @brief Lists every subcommand.
+ * @return an array of subcommands, ending with one whose name is NULL
+ */
+
+const ucpcal_command *ucpcal_command_table(void);
+
+/**
+ * @brief Prints a usage message listing every subcommand to stderr.
+ * @param program the name the program was run as
+ */
+
+void ucpcal_command_usage(const char *program);
+
+/**
+ * @brief Loads a calendar file and replays its journal, for a subcommand.
+ * Unlike the GUI, which starts with an empty calendar, a file that cannot
+ * be opened is reported on stderr as an error, and so is a file only part
+ * of which could be loaded, so that no subcommand carries on with events
+ * missing.
+ * @param list the empty linked list to load into
+ * @param filename the calendar file to load
+ * @param mode how the file should be loaded
+ * @return 0 on success, or 1 if the file could not be opened or any of it
+ * could not be loaded
+ */
+
+int ucpcal_command_open(ucpcal_list *list, const char *filename, int mode);
+
+/**
+ * @brief The load subcommand, which loads a calendar file and prints the
+ * number of events in it.
+ * @param argc the number of arguments
+ * @param argv the arguments: the calendar file
+ * @param mode how the file should be loaded
+ * @return 1 where an error has occurred, 0 otherwise
+ */
+
+int ucpcal_command_load(int argc, char **argv, int mode);
+
+/**
+ * @brief The query subcommand, which prints the events in a calendar file
+ * that match some conditions to standard output, in calendar format and in
+ * order of start time.
+ * The conditions are as for ucpcal_command_filter(), but the whole file is
+ * loaded, so a range of times is found through the list's index rather than
+ * by checking every event. A binary calendar file with no journal to replay
+ * is queried in place with ucpcal_command_query_binary() instead.
+ * @param argc the number of arguments
+ * @param argv the arguments: the calendar file, then any conditions
+ * @param mode how the file should be loaded
+ * @return 1 where an error has occurred, 0 otherwise
+ */
+
+int ucpcal_command_query(int argc, char **argv, int mode);
+
+/**
+ * @brief Prints the events in a binary calendar file that match some
+ * conditions, as the query subcommand does, without loading the file.
+ * The file is opened in place with ucpcal_binary_open(), the start of any
+ * range of times is found by binary search of its records, and only the
+ * records from there on are read, so the time taken depends on the number of
+ * events printed rather than the size of the file.
+ * @param filename the binary calendar file
+ * @param filter the conditions
+ * @return 1 where an error has occurred, 0 otherwise
+ */
+
+int ucpcal_command_query_binary(
+	const char *filename,
+	const ucpcal_filter *filter
+);
+
+/**
+ * @brief The add subcommand, which adds an event to a calendar file.
+ * The change is appended to the file's journal, as in the GUI, so adding
+ * costs the same however big the calendar is.
+ * @param argc the number of arguments
+ * @param argv the arguments: the calendar file, the start date and time as
+ * a single argument, the duration in minutes, the name and, optionally, the
+ * location, which may not start with UCPCAL_RULE_PREFIX
+ * @param mode how the file should be loaded
+ * @return 1 where an error has occurred, including when there is already an
+ * event with the name, 0 otherwise
+ */
+
+int ucpcal_command_add(int argc, char **argv, int mode);
+
+/**
+ * @brief The delete subcommand, which deletes an event from a calendar file.
+ * The change is appended to the file's journal, as in the GUI.
+ * @param argc the number of arguments
+ * @param argv the arguments: the calendar file and the name of the event
+ * @param mode how the file should be loaded
+ * @return 1 where an error has occurred, including when there is no event
+ * with the name, 0 otherwise
+ */
+
+int ucpcal_command_delete(int argc, char **argv, int mode);
+
+/**
+ * @brief The convert subcommand, which converts a calendar file between the
+ * text and binary formats: binary files to text and text files to binary.
+ * The file's journal is replayed first, so that the converted calendar
+ * includes the changes not yet saved, and nothing is written if any of the
+ * file could not be loaded.
+ * @param argc the number of arguments
+ * @param argv the arguments: the input and output files
+ * @param mode how the file should be loaded
+ * @return 1 where an error has occurred, 0 otherwise
+ */
+
+int ucpcal_command_convert(int argc, char **argv, int mode);
+
+/**
+ * @brief The stats subcommand, which prints a summary of a calendar file.
+ * The summary gives the number of events and of events with a location,
+ * the first and last start times, the total duration and the number of
+ * overlapping pairs of events.
+ * @param argc the number of arguments
+ * @param argv the arguments: the calendar file
+ * @param mode how the file should be loaded
+ * @return 1 where an error has occurred, 0 otherwise
+ */
+
+int ucpcal_command_stats(int argc, char **argv, int mode);
+
+/**
+ * @brief The save subcommand, which writes a calendar file out in full.
+ * With one file, its journal is compacted into it. With two, the first is
+ * loaded along with its journal and saved to the second in the same format,
+ * leaving the first as it was.
+ * @param argc the number of arguments
+ * @param argv the arguments: the calendar file and, optionally, the file to
+ * save it to
+ * @param mode how the file should be loaded
+ * @return 1 where an error has occurred, 0 otherwise
+ */
+
+int ucpcal_command_save(int argc, char **argv, int mode);
+
+/**
+ * @brief The filter subcommand, which filters a calendar file by streaming
+ * it, without loading it.
+ * The arguments are the input and output files, followed by any of -a DATE
+ * for events starting at or after a date, -b DATE for events starting
+ * before a date, -n TEXT for names containing some text and -l TEXT for
+ * locations containing some text. Dates are in the format
+ * "YYYY-MM-DD HH:MM", as a single argument. A file whose journal has
+ * changes not yet saved is refused, as streaming cannot apply them; save
+ * it first, or use the query subcommand, which loads the file.
+ * @param argc the number of arguments
+ * @param argv the arguments, starting with the input file
+ * @param mode unused, as the file is streamed rather than loaded
+ * @return 1 where an error has occurred, 0 otherwise
+ */
+
+int ucpcal_command_filter(int argc, char **argv, int mode);
+
+/**
+ * @brief The generate subcommand, which writes a synthetic calendar file.
+ * The arguments are the file and the number of events, followed by any of
+ * -s SEED for the pseudorandom seed, -w WORDS for the number of words in
+ * each name, up to 20, -l PERCENT for the percentage of events with a
+ * location, -u LOCATIONS for the number of distinct locations and -d
+ * MINUTES for the longest duration, as described for ucpcal_generator.
+ * @param argc the number of arguments
+ * @param argv the arguments, starting with the file to write
+ * @param mode unused, as nothing is loaded
+ * @return 1 where an error has occurred, 0 otherwise
+ */
+
+int ucpcal_command_generate(int argc, char **argv, int mode);
+
+/**
+ * @brief Reads the conditions of a filter from command line arguments.
+ * @param argc the number of arguments
+ * @param argv the arguments, as pairs of an option and its value
+ * @param filter where to store the conditions, which should start out
+ * matching everything
+ * @return 0 on success, or 1 if an argument was not understood, after
+ * reporting the problem on stderr
+ */
+
+int ucpcal_command_parse_filter(
+	int argc,
+	char **argv,
+	ucpcal_filter *filter
+);
+
+/**
+ * @brief Parses a date and time given as a command line argument.
+ * @param text the argument, in the format "YYYY-MM-DD HH:MM"
+ * @param time where to store the time on success
+ * @return 0 on success, or 1 if the argument is malformed, after reporting
+ * the problem and where it is on stderr
+ */
+
+int ucpcal_parse_time_argument(const char *text, ucpcal_time *time);
+
+/**
+ * @brief Parses a duration in minutes given as a command line argument.
+ * @param text the argument
+ * @param duration where to store the duration on success
+ * @return 0 on success, or 1 if the argument is malformed, after reporting
+ * the problem on stderr
+ */
+
+int ucpcal_parse_duration_argument(const char *text, unsigned int *duration);
+
+/**
+ * @brief Prints a time to standard output in the format "YYYY-MM-DD HH:MM".
+ * @param time the time to print
+ */
+
+void ucpcal_command_print_time(ucpcal_time time);
+
+#endif
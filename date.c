@@ -5,66 +5,252 @@
 
 #include "date.h"
 
-ucpcal_date ucpcal_date_scan(FILE *f) {
+const char *ucpcal_date_parse(
+	const char *text,
+	const char *end,
+	ucpcal_date *date,
+	const char **error
+) {
+	const char *cur = text, *field;
+	int negative = 0;
+	date->good = 0;
+	*error = NULL;
+	if (cur < end && *cur == '-') {
+		negative = 1;
+		cur++;
+	}
 	/*
-		Initialises the struct with all fields set to zero.
-		From ISO 9899:1990, §6.5.7, page 72:
+		Each field is parsed and checked in turn, leaving cur at the
+		start of the first field or separator that is wrong.
+	*/
+	field = cur;
+	if (!(cur = ucpcal_date_parse_number(cur, end, 9, &date->year))) {
+		*error = "expected a year of up to 9 digits";
+		cur = field;
+	} else if (negative && date->year > -UCPCAL_YEAR_MIN) {
+		/* Earlier years are too early to convert to a time. */
+		*error = "year must be from -9999 to 999999999";
+		cur = text;
+	} else if (cur == end || *cur != '-') {
+		*error = "expected '-' after the year";
+	} else if (!(cur = ucpcal_date_parse_number(
+		field = cur + 1, end, 2, &date->month
+	))) {
+		*error = "expected a month of 1 or 2 digits";
+		cur = field;
+	} else if (date->month < 1 || date->month > 12) {
+		*error = "month must be from 1 to 12";
+		cur = field;
+	} else if (cur == end || *cur != '-') {
+		*error = "expected '-' after the month";
+	} else if (!(cur = ucpcal_date_parse_number(
+		field = cur + 1, end, 2, &date->day
+	))) {
+		*error = "expected a day of 1 or 2 digits";
+		cur = field;
+	} else if (
+		date->day < 1 ||
+		date->day > ucpcal_date_days_in_month(
+			negative ? -date->year : date->year,
+			date->month
+		)
+	) {
+		*error = "day is out of range for the month";
+		cur = field;
+	} else if (cur == end || (*cur != ' ' && *cur != '\t')) {
+		*error = "expected a space between the date and time";
+	} else {
+		while (cur < end && (*cur == ' ' || *cur == '\t'))
+			cur++;
+		field = cur;
+		if (!(cur = ucpcal_date_parse_number(
+			cur, end, 2, &date->hour
+		))) {
+			*error = "expected an hour of 1 or 2 digits";
+			cur = field;
+		} else if (date->hour > 23) {
+			*error = "hour must be from 0 to 23";
+			cur = field;
+		} else if (cur == end || *cur != ':') {
+			*error = "expected ':' after the hour";
+		} else if (!(cur = ucpcal_date_parse_number(
+			field = cur + 1, end, 2, &date->minute
+		))) {
+			*error = "expected a minute of 1 or 2 digits";
+			cur = field;
+		} else if (date->minute > 59) {
+			*error = "minute must be from 0 to 59";
+			cur = field;
+		}
+	}
+	if (negative)
+		date->year = -date->year;
+	if (!*error)
+		date->good = 1;
+	return cur;
+}
+
+const char *ucpcal_date_parse_number(
+	const char *text,
+	const char *end,
+	int max_digits,
+	int *value
+) {
+	const char *cur = text;
+	int result = 0, digits = 0;
+	/* ISO C guarantees that the digits are contiguous in order. */
+	while (cur < end && *cur >= '0' && *cur <= '9') {
+		/* Stop accumulating before the value could overflow. */
+		if (digits < max_digits)
+			result = result * 10 + (*cur - '0');
+		digits++;
+		cur++;
+	}
+	*value = result;
+	return digits == 0 || digits > max_digits ? NULL : cur;
+}
+
+int ucpcal_date_days_in_month(int year, int month) {
+	static const int days[] = {
+		0, 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31
+	};
+	int leap = (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+	return days[month] + (month == 2 && leap);
+}
+
+/*
+	The conversions below shift the epoch back by 25 eras of 400 years
+	each, to 10000 years before 0000-03-01, so that every supported time
+	is non-negative. Division then always rounds towards zero, as ISO C90
+	otherwise leaves its rounding of negative operands up to the platform,
+	and no branches are needed to correct for it. As every era has
+	exactly 146097 days, which is divisible by seven, the shift affects
+	neither the calendar nor the day of the week.
+*/
 
-		If there are fewer initializers in a brace-enclosed list than
-		there are members of an aggregate, the remainder of the
-		aggregate shall be initialized implicitly the same as objects
-		that have static storage duration.
+/* 719468 is the number of days from 0000-03-01 to 1970-01-01. */
+#define UCPCAL_TIME_SHIFT_DAYS (719468L + 25L * 146097L)
+
+ucpcal_time ucpcal_time_from_date(ucpcal_date date) {
+	/*
+		Counts days with the era-based algorithm described by Howard
+		Hinnant in "chrono-Compatible Low-Level Date Algorithms". Years
+		are shifted to start in March so that the leap day falls at
+		the end; the comparison yields 0 or 1 rather than branching.
+	*/
+	long month = (date.month + 9) % 12;
+	long year = date.year + 10000L - (date.month <= 2);
+	long era = year / 400;
+	long year_of_era = year % 400;
+	long day_of_year = (153 * month + 2) / 5 + date.day - 1;
+	long day_of_era = year_of_era * 365 + year_of_era / 4 -
+		year_of_era / 100 + day_of_year;
+	long days = era * 146097 + day_of_era - UCPCAL_TIME_SHIFT_DAYS;
+	return (days * 24 + date.hour) * 60 + date.minute;
+}
+
+ucpcal_date ucpcal_time_to_date(ucpcal_time time) {
+	ucpcal_date date;
+	ucpcal_time shifted = time + UCPCAL_TIME_SHIFT_DAYS * 1440;
+	long days = shifted / 1440;
+	long minute_of_day = shifted % 1440;
+	long era = days / 146097;
+	long day_of_era = days % 146097;
+	/*
+		Corrects for the leap days before this day of the era: one
+		every 1461 days, except one every 36524 days, except the very
+		last day of the era.
 	*/
-	ucpcal_date date = {0};
-	if (fscanf(f,
-		"%d-%d-%d %d:%d",
-		&date.year,
-		&date.month,
-		&date.day,
-		&date.hour,
-		&date.minute
-	) == 5)
-		date.good = 1;
+	long year_of_era = (
+		day_of_era -
+		day_of_era / 1460 +
+		day_of_era / 36524 -
+		day_of_era / 146096
+	) / 365;
+	long day_of_year = day_of_era -
+		(365 * year_of_era + year_of_era / 4 - year_of_era / 100);
+	long month = (5 * day_of_year + 2) / 153;
+	date.good = 1;
+	date.day = day_of_year - (153 * month + 2) / 5 + 1;
+	/* Maps March-based months 0 to 11 back onto 3 to 12, 1 and 2. */
+	date.month = (month + 2) % 12 + 1;
+	date.year = year_of_era + era * 400 - 10000 + (date.month <= 2);
+	date.hour = minute_of_day / 60;
+	date.minute = minute_of_day % 60;
 	return date;
 }
 
+int ucpcal_time_compare(ucpcal_time a, ucpcal_time b) {
+	return (a > b) - (a < b);
+}
+
+ucpcal_time ucpcal_time_add(ucpcal_time time, long minutes) {
+	return time + minutes;
+}
+
+ucpcal_time ucpcal_time_end(ucpcal_time start, unsigned int duration) {
+	return start + (long) duration;
+}
+
+int ucpcal_time_weekday(ucpcal_time time) {
+	/*
+		1970-01-01 was a Thursday, day 4 of the week, and its shifted
+		day number is 1 modulo 7, so shifted day z is weekday z + 3.
+	*/
+	return (int) (((time + UCPCAL_TIME_SHIFT_DAYS * 1440) / 1440 + 3) % 7);
+}
+
 const char *ucpcal_duration_friendly(unsigned int minutes) {
-	static char result[64] = "";
-	int output_hours = minutes / 60;
-	int output_minutes = minutes % 60;
-	if (output_hours != 0 && output_minutes != 0)
-		sprintf(
-			result,
-			"%u hour%s, %u minute%s",
-			output_hours,
-			output_hours == 1 ? "" : "s",
-			output_minutes,
-			output_minutes == 1 ? "" : "s"
-		);
-	else if (output_hours != 0)
-		sprintf(
-			result,
-			"%u hour%s",
-			output_hours,
-			output_hours == 1 ? "" : "s"
+	static char result[UCPCAL_FRIENDLY_SIZE] = "";
+	ucpcal_duration_format(result, minutes);
+	return result;
+}
+
+const char *ucpcal_date_friendly(ucpcal_date date) {
+	static char result[UCPCAL_FRIENDLY_SIZE] = "";
+	ucpcal_date_format(result, date);
+	return result;
+}
+
+size_t ucpcal_duration_format(char *buffer, unsigned int minutes) {
+	unsigned int output_hours = minutes / 60;
+	unsigned int output_minutes = minutes % 60;
+	size_t length = 0;
+	if (output_hours != 0) {
+		length = ucpcal_format_number(buffer, output_hours, 1) - buffer;
+		length += ucpcal_text_format(
+			buffer + length,
+			output_hours == 1 ? " hour" : " hours"
 		);
-	else
-		sprintf(
-			result,
-			"%u minute%s",
+	}
+	if (output_hours != 0 && output_minutes != 0)
+		length += ucpcal_text_format(buffer + length, ", ");
+	if (output_hours == 0 || output_minutes != 0) {
+		length = ucpcal_format_number(
+			buffer + length,
 			output_minutes,
-			output_minutes == 1 ? "" : "s"
+			1
+		) - buffer;
+		length += ucpcal_text_format(
+			buffer + length,
+			output_minutes == 1 ? " minute" : " minutes"
 		);
-	return result;
+	}
+	buffer[length] = 0;
+	return length;
 }
 
-const char *ucpcal_date_friendly(ucpcal_date date) {
-	static char result[64] = "";
+size_t ucpcal_date_format(char *buffer, ucpcal_date date) {
 	static const char *months[] = {
 		NULL, "January", "February", "March", "April",
 		"May", "June", "July", "August",
 		"September", "October", "November", "December"
 	};
+	static const size_t month_lengths[] = {
+		0, 7, 8, 5, 5, 3, 4, 4, 6, 9, 7, 8, 8
+	};
+	size_t length = 0;
+	int hour;
 	if (
 		date.year >= 0 &&
 		date.month >= 1 && date.month <= 12 &&
@@ -73,32 +259,52 @@ const char *ucpcal_date_friendly(ucpcal_date date) {
 		date.minute >= 0 && date.minute <= 59 &&
 		date.good
 	) {
-		int hour = date.hour % 12;
+		hour = date.hour % 12;
 		if (hour == 0)
 			hour = 12;
-		if (date.minute)
-			sprintf(
-				result,
-				"%d %s %d, %d:%02d %cm",
-				date.day,
-				months[date.month],
-				date.year,
-				hour,
+		length = ucpcal_format_number(buffer, date.day, 1) - buffer;
+		buffer[length++] = ' ';
+		memcpy(
+			buffer + length,
+			months[date.month],
+			month_lengths[date.month]
+		);
+		length += month_lengths[date.month];
+		buffer[length++] = ' ';
+		length = ucpcal_format_number(
+			buffer + length,
+			date.year,
+			1
+		) - buffer;
+		length += ucpcal_text_format(buffer + length, ", ");
+		length = ucpcal_format_number(
+			buffer + length,
+			hour,
+			1
+		) - buffer;
+		if (date.minute) {
+			buffer[length++] = ':';
+			length = ucpcal_format_number(
+				buffer + length,
 				date.minute,
-				date.hour > 11 ? 'p' : 'a'
-			);
-		else
-			sprintf(
-				result,
-				"%d %s %d, %d %cm",
-				date.day,
-				months[date.month],
-				date.year,
-				hour,
-				date.hour > 11 ? 'p' : 'a'
-			);
+				2
+			) - buffer;
+		}
+		buffer[length++] = ' ';
+		buffer[length++] = date.hour > 11 ? 'p' : 'a';
+		buffer[length++] = 'm';
 	} else {
-		strcpy(result, "invalid date and/or time");
+		length += ucpcal_text_format(
+			buffer,
+			"invalid date and/or time"
+		);
 	}
-	return result;
+	buffer[length] = 0;
+	return length;
+}
+
+size_t ucpcal_text_format(char *buffer, const char *text) {
+	size_t length = strlen(text);
+	memcpy(buffer, text, length);
+	return length;
 }
@@ -9,6 +9,20 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include "writer.h"
+
+/**
+ * @brief The earliest year a date may have, as the conversions to and from
+ * ucpcal_time only hold from the start of it.
+ */
+
+#define UCPCAL_YEAR_MIN (-9999)
+
+/**
+ * @brief The latest year a date may have, the most that nine digits hold.
+ */
+
+#define UCPCAL_YEAR_MAX 999999999
 
 /**
  * @brief A data structure representing a date and time.
@@ -26,19 +40,137 @@ typedef struct ucpcal_date {
 } ucpcal_date;
 
 /**
- * @brief Reads a date from a file handle in the format "YYYY-MM-DD HH:MM".
- * @param f the file handle to read from
- * @return the struct ucpcal_date value of the input date
+ * @brief Parses a date from a buffer in the format "YYYY-MM-DD HH:MM".
+ * Works without the C library's locale-aware conversions, and checks that
+ * every field is in range, including the day for the given month and year.
+ * The year may be from UCPCAL_YEAR_MIN to UCPCAL_YEAR_MAX, and the other
+ * fields may have one or two digits. One or more spaces or tabs separate
+ * the date and time.
+ * @param text the start of the buffer
+ * @param end the end of the buffer, which need not be null terminated
+ * @param date where to store the parsed date, with good set on success
+ * @param error where to store a description of the problem on failure, or
+ * NULL on success
+ * @return just past the time on success, or the offending position
+ */
+
+const char *ucpcal_date_parse(
+	const char *text,
+	const char *end,
+	ucpcal_date *date,
+	const char **error
+);
+
+/**
+ * @brief Parses an unsigned decimal number of limited length from a buffer.
+ * @param text the start of the buffer
+ * @param end the end of the buffer
+ * @param max_digits the most digits to accept, at most 9 so as to fit in an
+ * int on every platform
+ * @param value where to store the number
+ * @return just past the digits, or NULL if there are none or too many
+ */
+
+const char *ucpcal_date_parse_number(
+	const char *text,
+	const char *end,
+	int max_digits,
+	int *value
+);
+
+/**
+ * @brief Calculates the number of days in a month.
+ * @param year the year, which determines whether February has a leap day
+ * @param month the month, from 1 to 12
+ * @return the number of days in the month
+ */
+
+int ucpcal_date_days_in_month(int year, int month);
+
+/**
+ * @brief A packed representation of a date and time.
+ * Counts the minutes since 1970-01-01 00:00 in the proleptic Gregorian
+ * calendar, so that times can be ordered, compared and offset with plain
+ * integer arithmetic. ISO C90 has no type guaranteed to be 64 bits wide, but
+ * long is on the LP64 Unix platforms this program targets, which is enough
+ * for any year that fits in an int.
+ */
+
+typedef long ucpcal_time;
+
+/**
+ * @brief Packs a date and time into a ucpcal_time.
+ * The conversion has no data dependent branches. Years from UCPCAL_YEAR_MIN
+ * onwards are supported, and the month must be from 1 to 12; days, hours
+ * and minutes outside their usual ranges simply carry into the next larger
+ * unit.
+ * @param date the date and time to convert
+ * @return the number of minutes since 1970-01-01 00:00
+ */
+
+ucpcal_time ucpcal_time_from_date(ucpcal_date date);
+
+/**
+ * @brief Unpacks a ucpcal_time into a date and time.
+ * The conversion has no data dependent branches, and is the inverse of
+ * ucpcal_time_from_date() for valid dates from the year UCPCAL_YEAR_MIN
+ * onwards.
+ * @param time the number of minutes since 1970-01-01 00:00
+ * @return the struct ucpcal_date value of the time, with good set
+ */
+
+ucpcal_date ucpcal_time_to_date(ucpcal_time time);
+
+/**
+ * @brief Compares two times, in the manner of strcmp().
+ * @param a the first time
+ * @param b the second time
+ * @return a negative, zero or positive value where a is earlier than, the
+ * same as or later than b respectively
+ */
+
+int ucpcal_time_compare(ucpcal_time a, ucpcal_time b);
+
+/**
+ * @brief Offsets a time by a number of minutes.
+ * @param time the time to start from
+ * @param minutes the number of minutes to add, which may be negative
+ * @return the offset time
+ */
+
+ucpcal_time ucpcal_time_add(ucpcal_time time, long minutes);
+
+/**
+ * @brief Calculates when something with a given start and duration ends.
+ * @param start the start time
+ * @param duration the duration, in minutes
+ * @return the end time, which is the first minute no longer occupied
+ */
+
+ucpcal_time ucpcal_time_end(ucpcal_time start, unsigned int duration);
+
+/**
+ * @brief Calculates the day of the week of a time.
+ * @param time the time to use
+ * @return the day of the week, from 0 for Sunday to 6 for Saturday
+ */
+
+int ucpcal_time_weekday(ucpcal_time time);
+
+/**
+ * @brief The room needed for a friendly duration or date and time string,
+ * including the null terminator.
+ * 64 bytes is enough, even in the worst case where the platform's unsigned
+ * int type is 64 bits.
  */
 
-ucpcal_date ucpcal_date_scan(FILE *f);
+#define UCPCAL_FRIENDLY_SIZE 64
 
 /**
  * @brief Expresses a duration in minutes as a friendly string.
  * The string contains hours and/or minutes where necessary. Uses a static
  * character array for storage to avoid heap allocation, but beware that this
- * makes the function non-reentrant. 64 bytes for the static buffer is enough,
- * even in the worst case where the platform's unsigned int type is 64 bits.
+ * makes the function non-reentrant; ucpcal_duration_format() is not.
  * @return a const-qualified string representation of the duration.
  */
 
@@ -47,11 +179,42 @@ const char *ucpcal_duration_friendly(unsigned int minutes);
 /**
  * @brief Expresses a date and time structure as a friendly string.
  * Uses a static character array for storage to avoid heap allocation, but
- * beware that this makes the function non-reentrant. 64 bytes should be
- * enough, even in the worst case.
+ * beware that this makes the function non-reentrant; ucpcal_date_format()
+ * is not.
  * @return a const-qualified string representation of the duration.
  */
 
 const char *ucpcal_date_friendly(ucpcal_date date);
 
+/**
+ * @brief Writes a duration in minutes as a friendly string, like
+ * ucpcal_duration_friendly(), into a buffer owned by the caller.
+ * Safe to call from any number of threads at once, and free of printf().
+ * @param buffer where to write, with room for UCPCAL_FRIENDLY_SIZE bytes
+ * @param minutes the duration
+ * @return the number of bytes written, excluding the null terminator
+ */
+
+size_t ucpcal_duration_format(char *buffer, unsigned int minutes);
+
+/**
+ * @brief Writes a date and time as a friendly string, like
+ * ucpcal_date_friendly(), into a buffer owned by the caller.
+ * Safe to call from any number of threads at once, and free of printf().
+ * @param buffer where to write, with room for UCPCAL_FRIENDLY_SIZE bytes
+ * @param date the date and time
+ * @return the number of bytes written, excluding the null terminator
+ */
+
+size_t ucpcal_date_format(char *buffer, ucpcal_date date);
+
+/**
+ * @brief Writes some text, without a null terminator.
+ * @param buffer where to write, with room for the text
+ * @param text the text
+ * @return the number of bytes written
+ */
+
+size_t ucpcal_text_format(char *buffer, const char *text);
+
 #endif
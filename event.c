@@ -4,6 +4,7 @@
  */
 
 #include "event.h"
+#include "recur.h"
 
 ucpcal_event *ucpcal_event_new(void) {
 	ucpcal_event *event = (ucpcal_event *) calloc(sizeof(ucpcal_event), 1);
@@ -14,6 +15,26 @@ ucpcal_event *ucpcal_event_new(void) {
 	*/
 	event->name = NULL;
 	event->location = NULL;
+	event->rule = NULL;
+	event->arena = NULL;
+	event->borrowed = 0;
+	return event;
+}
+
+ucpcal_event *ucpcal_event_alloc(ucpcal_arena *arena) {
+	ucpcal_event *event = (ucpcal_event *) ucpcal_arena_alloc(
+		arena,
+		sizeof(ucpcal_event)
+	);
+	/* Arena memory is not cleared, unlike that from calloc(). */
+	ucpcal_date date = {0};
+	event->date = date;
+	event->duration = 0;
+	event->name = NULL;
+	event->location = NULL;
+	event->rule = NULL;
+	event->arena = arena;
+	event->borrowed = 0;
 	return event;
 }
 
@@ -27,9 +48,50 @@ void ucpcal_event_free(ucpcal_event *event) {
 		If ptr is a null pointer, no action occurs.
 
 	*/
-	if (event) {
+	if (event)
+		ucpcal_rule_free(event->rule);
+	if (event && event->arena) {
+		/* The string sizes are needed to find their size classes. */
+		if (event->name && !event->borrowed)
+			ucpcal_arena_recycle(
+				event->arena,
+				event->name,
+				strlen(event->name) + 1
+			);
+		if (event->location && !event->borrowed)
+			ucpcal_arena_recycle(
+				event->arena,
+				event->location,
+				strlen(event->location) + 1
+			);
+		ucpcal_arena_recycle(event->arena, event, sizeof(ucpcal_event));
+	} else if (event) {
 		free(event->name);
 		free(event->location);
 		free(event);
 	}
 }
+
+size_t ucpcal_string_length(const char *string) {
+	return strcspn(string, "\n");
+}
+
+int ucpcal_string_compare(const char *a, const char *b) {
+	const unsigned char *x = (const unsigned char *) a;
+	const unsigned char *y = (const unsigned char *) b;
+	/* A newline ends a string just as a null byte does. */
+	while (*x && *x != '\n' && *x == *y) {
+		x++;
+		y++;
+	}
+	return (*x == '\n' ? 0 : *x) - (*y == '\n' ? 0 : *y);
+}
+
+int ucpcal_string_contains(const char *string, const char *text) {
+	size_t length = ucpcal_string_length(string), size = strlen(text);
+	size_t i;
+	int result = size == 0;
+	for (i = 0; !result && i + size <= length; i++)
+		result = !memcmp(string + i, text, size);
+	return result;
+}
@@ -10,11 +10,27 @@
 #include <stdlib.h>
 #include <string.h>
 #include "date.h"
+#include "arena.h"
+
+/*
+	recur.h works on events, so the rule structure can only be declared
+	incompletely here.
+*/
+struct ucpcal_rule;
 
 /**
  * @brief A data structure representing a calendar event.
- * Always use heap allocated strings for name and location, because
- * ucpcal_event_free() will attempt to free() them.
+ * The strings for name and location must be allocated the same way as the
+ * event itself, because ucpcal_event_free() will release them: from the
+ * heap for events made by ucpcal_event_new(), or from the event's arena for
+ * events made by ucpcal_event_alloc(). The exception is an event marked as
+ * borrowed, whose strings are owned by something else. The same goes for
+ * the rule, which is never borrowed.
+ *
+ * Strings borrowed from a text file are read in place, so they end at the
+ * newline ending their line rather than at a null byte. Use
+ * ucpcal_string_length() and ucpcal_string_compare() rather than the
+ * standard string functions to read the strings of any event.
  */
 
 typedef struct ucpcal_event {
@@ -27,13 +43,28 @@ typedef struct ucpcal_event {
 	 */
 	unsigned int duration;
 	/**
-	 * The name of the event. Only use heap allocated strings here!
+	 * The name of the event. Allocate it the same way as the event!
 	 */
 	char *name;
 	/**
-	 * Location (optional). Only use heap allocated strings here!
+	 * Location (optional). Allocate it the same way as the event!
 	 */
 	char *location;
+	/**
+	 * The rule by which the event recurs, or NULL if it happens only
+	 * once. Allocate it the same way as the event!
+	 */
+	struct ucpcal_rule *rule;
+	/**
+	 * The arena the event was allocated from, or NULL for the heap.
+	 */
+	ucpcal_arena *arena;
+	/**
+	 * Non-zero if name and location are owned by something else, such
+	 * as a memory mapped file, and must not be released with the event.
+	 * Only events from an arena may borrow their strings.
+	 */
+	int borrowed;
 } ucpcal_event;
 
 /**
@@ -44,12 +75,53 @@ typedef struct ucpcal_event {
 
 ucpcal_event *ucpcal_event_new(void);
 
+/**
+ * @brief Creates a new event struct in an arena.
+ * The name and location should be allocated from the same arena, and the
+ * event is released along with everything else when the arena is emptied.
+ * ucpcal_event_free() may be used to recycle it sooner.
+ * @param arena the arena to allocate from
+ * @return pointer to new event struct
+ */
+
+ucpcal_event *ucpcal_event_alloc(ucpcal_arena *arena);
+
 /**
  * @brief Frees the memory used for an event struct.
- * Frees the memory pointed to by name and location, if they are not NULL.
+ * Frees the memory pointed to by name and location, if they are not NULL
+ * and not borrowed, and the rule, if there is one. Events from an arena are
+ * recycled into it rather than freed.
  * @param event the event to be freed
  */
 
 void ucpcal_event_free(ucpcal_event *event);
 
+/**
+ * @brief Finds the length of an event's name or location.
+ * @param string the string, ended by a null byte or a newline
+ * @return the number of bytes before the end of the string
+ */
+
+size_t ucpcal_string_length(const char *string);
+
+/**
+ * @brief Compares two strings as strcmp() does, for event names and
+ * locations.
+ * @param a a string ended by a null byte or a newline
+ * @param b another string ended by a null byte or a newline
+ * @return less than, equal to or greater than zero if a sorts before, the
+ * same as or after b
+ */
+
+int ucpcal_string_compare(const char *a, const char *b);
+
+/**
+ * @brief Checks whether an event's name or location contains some text.
+ * @param string the string to search, ended by a null byte or a newline
+ * @param text the null terminated text to search for
+ * @return non-zero if the text appears in the string
+ */
+
+int ucpcal_string_contains(const char *string, const char *text);
+
 #endif
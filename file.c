@@ -0,0 +1,811 @@
+/**
+ * @file file.c
+ * @brief Algorithms for loading and saving calendar files.
+ */
+
+#include "file.h"
+#include "binary.h"
+
+void ucpcal_progress_init(ucpcal_progress *progress) {
+	pthread_mutex_init(&progress->lock, NULL);
+	progress->done = 0;
+	progress->total = 0;
+	progress->cancelled = 0;
+}
+
+void ucpcal_progress_destroy(ucpcal_progress *progress) {
+	pthread_mutex_destroy(&progress->lock);
+}
+
+int ucpcal_progress_report(
+	ucpcal_progress *progress,
+	size_t done,
+	size_t total
+) {
+	int result = 0;
+	if (progress) {
+		pthread_mutex_lock(&progress->lock);
+		progress->done = done;
+		progress->total = total;
+		result = progress->cancelled;
+		pthread_mutex_unlock(&progress->lock);
+	}
+	return result;
+}
+
+void ucpcal_progress_cancel(ucpcal_progress *progress) {
+	pthread_mutex_lock(&progress->lock);
+	progress->cancelled = 1;
+	pthread_mutex_unlock(&progress->lock);
+}
+
+int ucpcal_progress_cancelled(ucpcal_progress *progress) {
+	int result;
+	pthread_mutex_lock(&progress->lock);
+	result = progress->cancelled;
+	pthread_mutex_unlock(&progress->lock);
+	return result;
+}
+
+int ucpcal_progress_percent(ucpcal_progress *progress) {
+	int result = 0;
+	pthread_mutex_lock(&progress->lock);
+	if (progress->total)
+		result = (int) (progress->done / (progress->total / 100.0));
+	pthread_mutex_unlock(&progress->lock);
+	return result > 100 ? 100 : result;
+}
+
+unsigned long ucpcal_load(
+	ucpcal_list *list,
+	const char *filename,
+	ucpcal_progress *progress
+) {
+	/*
+		Postel's law: be conservative in what you do, be liberal in
+		what you accept from others.
+
+		Binary mode is OFF here so that files with CR+LF line endings
+		can be read properly, at least on Windows, though hopefully
+		users of other platforms won't use CR+LF delimited input.
+	*/
+	FILE *f = fopen(filename, "r");
+	ucpcal_reader *reader;
+	struct stat info;
+	size_t total = 0;
+	unsigned long records = 0, skipped = 0;
+	int done = 0;
+	if (f) {
+		reader = ucpcal_reader_new(f);
+		ucpcal_list_empty(list);
+		if (progress && !fstat(fileno(f), &info))
+			total = info.st_size;
+		do {
+			unsigned int duration;
+			char *line;
+			size_t length;
+			const char *name, *error, *rule;
+			ucpcal_event *event;
+			ucpcal_date date;
+			event = NULL;
+			/* Skip any blank lines before the record. */
+			line = ucpcal_reader_line(reader, &length);
+			while (line && ucpcal_is_blank(line, line + length))
+				line = ucpcal_reader_line(reader, &length);
+			if (line)
+				name = ucpcal_parse_header(
+					line,
+					line + length,
+					&date,
+					&duration,
+					&error
+				);
+			if (!line) {
+				/* The file ended after the last record. */
+				done = 1;
+			} else if (!error) {
+				/*
+					Lines are only valid until the next is
+					read, so copy the name straight into
+					the list's arena, which also saves the
+					event being copied on append.
+				*/
+				event = ucpcal_event_alloc(list->arena);
+				event->date = date;
+				event->duration = duration;
+				event->name = ucpcal_arena_string(
+					list->arena,
+					name,
+					line + length - name
+				);
+				line = ucpcal_reader_line(reader, &length);
+				/* A recurring event's rule comes first. */
+				rule = line ? ucpcal_rule_line(
+					line,
+					line + length,
+					&error
+				) : NULL;
+				if (error) {
+					/* Report the column of the rule. */
+					name = rule;
+					ucpcal_event_free(event);
+					event = NULL;
+				} else if (rule) {
+					event->rule = ucpcal_rule_parse(
+						list->arena,
+						rule,
+						line + length
+					);
+					line = ucpcal_reader_line(
+						reader,
+						&length
+					);
+				}
+			}
+			if (event) {
+				if (line && length > 0) {
+					event->location = ucpcal_arena_string(
+						list->arena,
+						line,
+						length
+					);
+					/* Discard the following blank line. */
+					ucpcal_reader_line(reader, &length);
+				}
+				ucpcal_list_append(list, event);
+				/* The reader is at most a buffer ahead. */
+				if (++records % UCPCAL_PROGRESS_INTERVAL == 0)
+					done = ucpcal_progress_report(
+						progress,
+						ftell(f),
+						total
+					);
+			} else if (line && error) {
+				fprintf(stderr,
+					"%s:%lu:%lu: %s\n",
+					filename,
+					reader->line,
+					(unsigned long) (name - line) + 1,
+					error
+				);
+				skipped++;
+				/* Skip to the blank line ending the record. */
+				line = ucpcal_reader_line(reader, &length);
+				while (
+					line &&
+					!ucpcal_is_blank(line, line + length)
+				)
+					line = ucpcal_reader_line(
+						reader,
+						&length
+					);
+				done = !line;
+			}
+		} while (!done);
+		ucpcal_progress_report(progress, total, total);
+		ucpcal_reader_free(reader);
+		fclose(f);
+	}
+	return skipped;
+}
+
+unsigned long ucpcal_load_mapped(
+	ucpcal_list *list,
+	const char *filename,
+	ucpcal_progress *progress
+) {
+	ucpcal_map *map = ucpcal_map_view(filename);
+	ucpcal_record record;
+	ucpcal_event *event;
+	unsigned long records = 0, skipped = 0;
+	int cancelled = 0;
+	const char *error;
+	char *cur, *next, *end;
+	if (map) {
+		ucpcal_list_empty(list);
+		/* The list releases the mapping when it is next emptied. */
+		map->next = list->maps;
+		list->maps = map;
+		cur = map->data;
+		end = map->data + map->length;
+		while (cur) {
+			next = ucpcal_record_parse(cur, end, &record, &error);
+			if (error) {
+				/* Count lines only when they are needed. */
+				fprintf(stderr,
+					"%s:%lu:%lu: %s\n",
+					filename,
+					ucpcal_count_lines(map->data, next) + 1,
+					(unsigned long) (next - ucpcal_line_start(
+						map->data,
+						next
+					)) + 1,
+					error
+				);
+				skipped++;
+				next = ucpcal_record_boundary(next, end);
+			} else if (next) {
+				event = ucpcal_event_alloc(list->arena);
+				event->date = record.date;
+				event->duration = record.duration;
+				event->borrowed = 1;
+				event->name = ucpcal_borrow(
+					list->arena,
+					record.name,
+					record.name_length,
+					end
+				);
+				if (record.location)
+					event->location = ucpcal_borrow(
+						list->arena,
+						record.location,
+						record.location_length,
+						end
+					);
+				if (record.rule)
+					event->rule = ucpcal_rule_parse(
+						list->arena,
+						record.rule,
+						record.rule + record.rule_length
+					);
+				ucpcal_list_append(list, event);
+				if (++records % UCPCAL_PROGRESS_INTERVAL == 0)
+					cancelled = ucpcal_progress_report(
+						progress,
+						next - map->data,
+						map->length
+					);
+			}
+			cur = cancelled ? NULL : next;
+		}
+		ucpcal_progress_report(progress, map->length, map->length);
+	}
+	return skipped;
+}
+
+int ucpcal_load_mode(
+	ucpcal_list *list,
+	const char *filename,
+	int mode,
+	ucpcal_progress *progress
+) {
+	int binary = ucpcal_binary_detect(filename) > 0, result;
+	if (binary || mode == UCPCAL_LOAD_PARALLEL) {
+		if (binary)
+			result = ucpcal_binary_load(list, filename);
+		else
+			result = ucpcal_load_parallel(list, filename, 0) != 0;
+		ucpcal_progress_report(progress, 1, 1);
+	} else if (mode == UCPCAL_LOAD_MAPPED) {
+		result = ucpcal_load_mapped(list, filename, progress) != 0;
+	} else {
+		result = ucpcal_load(list, filename, progress) != 0;
+	}
+	return result;
+}
+
+/* Chunks smaller than this are not worth a thread of their own. */
+#define UCPCAL_LOAD_MIN_CHUNK 65536
+
+unsigned long ucpcal_load_parallel(
+	ucpcal_list *list,
+	const char *filename,
+	int threads
+) {
+	ucpcal_map *map = ucpcal_map_view(filename);
+	ucpcal_batch *batches;
+	pthread_t *ids;
+	unsigned long skipped = 0;
+	int *started;
+	char *end, *position;
+	int i;
+	if (map) {
+		ucpcal_list_empty(list);
+		/* The list releases the mapping when it is next emptied. */
+		map->next = list->maps;
+		list->maps = map;
+		end = map->data + map->length;
+		if (threads < 1)
+			threads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+		if (threads < 1)
+			threads = 1;
+		if ((size_t) threads > map->length / UCPCAL_LOAD_MIN_CHUNK + 1)
+			threads = (int) (map->length / UCPCAL_LOAD_MIN_CHUNK) + 1;
+		batches = (ucpcal_batch *) malloc(
+			threads * sizeof(ucpcal_batch)
+		);
+		ids = (pthread_t *) malloc(threads * sizeof(pthread_t));
+		started = (int *) malloc(threads * sizeof(int));
+		for (i = 0; i < threads; i++) {
+			batches[i].text = i ? batches[i - 1].end : map->data;
+			batches[i].end = i < threads - 1 ?
+				ucpcal_record_boundary(
+					map->data + map->length / threads *
+						(i + 1),
+					end
+				) : end;
+			/* Chunks may be empty, but never overlap. */
+			if (batches[i].end < batches[i].text)
+				batches[i].end = batches[i].text;
+			batches[i].arena = ucpcal_arena_new();
+			batches[i].nodes = NULL;
+			batches[i].sorted = NULL;
+			batches[i].count = 0;
+			batches[i].capacity = 0;
+			batches[i].error = NULL;
+			batches[i].error_position = NULL;
+			batches[i].skipped = 0;
+		}
+		/*
+			The calling thread takes the first batch itself. If a
+			thread cannot be started, its batch is parsed here too.
+		*/
+		for (i = 1; i < threads; i++)
+			started[i] = !pthread_create(
+				&ids[i],
+				NULL,
+				ucpcal_batch_parse,
+				&batches[i]
+			);
+		ucpcal_batch_parse(&batches[0]);
+		for (i = 1; i < threads; i++) {
+			if (started[i])
+				pthread_join(ids[i], NULL);
+			else
+				ucpcal_batch_parse(&batches[i]);
+		}
+		/* Each batch keeps the first of the records it skipped. */
+		for (i = 0; i < threads; i++) {
+			position = batches[i].error_position;
+			if (batches[i].error)
+				fprintf(stderr,
+					"%s:%lu:%lu: %s\n",
+					filename,
+					ucpcal_count_lines(
+						map->data,
+						position
+					) + 1,
+					(unsigned long) (
+						position - ucpcal_line_start(
+							map->data,
+							position
+						)
+					) + 1,
+					batches[i].error
+				);
+			if (batches[i].skipped > 1)
+				fprintf(stderr,
+					"%s: malformed records skipped "
+						"after that: %lu\n",
+					filename,
+					batches[i].skipped - 1
+				);
+			skipped += batches[i].skipped;
+		}
+		ucpcal_batch_merge(list, batches, threads);
+		free(started);
+		free(ids);
+		free(batches);
+	}
+	return skipped;
+}
+
+void *ucpcal_batch_parse(void *data) {
+	ucpcal_batch *batch = (ucpcal_batch *) data;
+	ucpcal_record record;
+	ucpcal_event *event;
+	ucpcal_node *node;
+	const char *error;
+	char *cur = batch->text, *next;
+	while (cur) {
+		next = ucpcal_record_parse(cur, batch->end, &record, &error);
+		if (error) {
+			if (!batch->skipped++) {
+				batch->error = error;
+				batch->error_position = next;
+			}
+			next = ucpcal_record_boundary(next, batch->end);
+		} else if (next) {
+			event = ucpcal_event_alloc(batch->arena);
+			event->date = record.date;
+			event->duration = record.duration;
+			event->borrowed = 1;
+			event->name = ucpcal_borrow(
+				batch->arena,
+				record.name,
+				record.name_length,
+				batch->end
+			);
+			if (record.location)
+				event->location = ucpcal_borrow(
+					batch->arena,
+					record.location,
+					record.location_length,
+					batch->end
+				);
+			if (record.rule)
+				event->rule = ucpcal_rule_parse(
+					batch->arena,
+					record.rule,
+					record.rule + record.rule_length
+				);
+			node = ucpcal_node_new(batch->arena);
+			node->event = event;
+			/*
+				The sequence number is only the position in
+				the batch for now, to keep the sort stable.
+			*/
+			node->when.start = ucpcal_time_from_date(record.date);
+			node->when.seq = batch->count;
+			ucpcal_batch_add(batch, node);
+		}
+		cur = next;
+	}
+	ucpcal_batch_sort(batch);
+	return NULL;
+}
+
+void ucpcal_batch_sort(ucpcal_batch *batch) {
+	if (batch->count) {
+		batch->sorted = (ucpcal_node **) malloc(
+			batch->count * sizeof(ucpcal_node *)
+		);
+		memcpy(
+			batch->sorted,
+			batch->nodes,
+			batch->count * sizeof(ucpcal_node *)
+		);
+		qsort(
+			batch->sorted,
+			batch->count,
+			sizeof(ucpcal_node *),
+			ucpcal_tree_compare
+		);
+	}
+}
+
+void ucpcal_batch_add(ucpcal_batch *batch, ucpcal_node *node) {
+	if (batch->count == batch->capacity) {
+		batch->capacity = batch->capacity ? batch->capacity * 2 : 1024;
+		batch->nodes = (ucpcal_node **) realloc(
+			batch->nodes,
+			batch->capacity * sizeof(ucpcal_node *)
+		);
+	}
+	batch->nodes[batch->count++] = node;
+}
+
+void ucpcal_batch_merge(ucpcal_list *list, ucpcal_batch *batches, int count) {
+	ucpcal_node **sorted, *node, *best;
+	size_t total = 0, kept = 0, capacity = list->names->capacity, i;
+	size_t *heads;
+	int b, winner;
+	for (b = 0; b < count; b++)
+		total += batches[b].count;
+	/* Size the names up front rather than growing them repeatedly. */
+	while (total * 2 > capacity)
+		capacity *= 2;
+	if (capacity > list->names->capacity)
+		ucpcal_hash_resize(list->names, capacity);
+	for (b = 0; b < count; b++) {
+		for (i = 0; i < batches[b].count; i++) {
+			node = batches[b].nodes[i];
+			node->event->arena = list->arena;
+			if (node->event->rule)
+				node->event->rule->arena = list->arena;
+			if (ucpcal_list_find(list, node->event->name)) {
+				/*
+					A height of zero marks a node that
+					never makes it into the tree.
+				*/
+				node->when.height = 0;
+			} else {
+				node->when.height = 1;
+				/*
+					Renumbering in file order keeps each
+					batch's sorted run in order.
+				*/
+				node->when.seq = kept++;
+				node->prev = list->tail;
+				if (list->tail)
+					list->tail->next = node;
+				else
+					list->head = node;
+				list->tail = node;
+				ucpcal_hash_insert(list->names, node);
+			}
+		}
+		ucpcal_arena_adopt(list->arena, batches[b].arena);
+	}
+	/* Merge the sorted runs of the nodes kept into one. */
+	sorted = (ucpcal_node **) malloc(
+		(kept ? kept : 1) * sizeof(ucpcal_node *)
+	);
+	heads = (size_t *) calloc(count ? count : 1, sizeof(size_t));
+	for (i = 0; i < kept; i++) {
+		best = NULL;
+		winner = 0;
+		for (b = 0; b < count; b++) {
+			while (
+				heads[b] < batches[b].count &&
+				!batches[b].sorted[heads[b]]->when.height
+			)
+				heads[b]++;
+			if (
+				heads[b] < batches[b].count && (
+					!best ||
+					ucpcal_tree_compare(
+						&batches[b].sorted[heads[b]],
+						&best
+					) < 0
+				)
+			) {
+				best = batches[b].sorted[heads[b]];
+				winner = b;
+			}
+		}
+		sorted[i] = best;
+		heads[winner]++;
+	}
+	ucpcal_tree_build(list->times, sorted, kept);
+	for (b = 0; b < count; b++) {
+		for (i = 0; i < batches[b].count; i++)
+			if (!batches[b].nodes[i]->when.height)
+				ucpcal_node_free(
+					batches[b].nodes[i],
+					list->arena
+				);
+		ucpcal_arena_free(batches[b].arena);
+		free(batches[b].nodes);
+		free(batches[b].sorted);
+	}
+	free(heads);
+	free(sorted);
+}
+
+char *ucpcal_record_boundary(char *text, char *end) {
+	char *cur = text;
+	int done = 0;
+	while (!done) {
+		cur = cur < end ? (char *) memchr(cur, '\n', end - cur) : NULL;
+		if (!cur || cur + 1 >= end) {
+			cur = end;
+			done = 1;
+		} else if (cur[1] == '\n') {
+			cur += 2;
+			done = 1;
+		} else {
+			cur++;
+		}
+	}
+	return cur;
+}
+
+char *ucpcal_record_parse(
+	char *text,
+	char *end,
+	ucpcal_record *record,
+	const char **error
+) {
+	char *cur = text, *line_end, *result = NULL;
+	int done = 0;
+	*error = NULL;
+	/* Skip any blank lines before the record. */
+	while (cur < end && !done) {
+		line_end = (char *) memchr(cur, '\n', end - cur);
+		if (!line_end)
+			line_end = end;
+		if (ucpcal_is_blank(cur, line_end))
+			cur = line_end < end ? line_end + 1 : end;
+		else
+			done = 1;
+	}
+	if (cur < end) {
+		result = (char *) ucpcal_parse_header(
+			cur,
+			line_end,
+			&record->date,
+			&record->duration,
+			error
+		);
+		if (!*error) {
+			record->name = result;
+			record->name_length = line_end - result;
+			record->location = NULL;
+			record->location_length = 0;
+			record->rule = NULL;
+			record->rule_length = 0;
+			/* Move on to the location line, if there is one. */
+			cur = line_end < end ? line_end + 1 : end;
+			line_end = (char *) memchr(cur, '\n', end - cur);
+			if (!line_end)
+				line_end = end;
+			/* A recurring event's rule comes first. */
+			record->rule = (char *) ucpcal_rule_line(
+				cur,
+				line_end,
+				error
+			);
+			if (*error) {
+				/* Report the position of the rule. */
+				result = record->rule;
+			} else if (record->rule) {
+				record->rule_length = line_end - record->rule;
+				cur = line_end < end ? line_end + 1 : end;
+				line_end = (char *) memchr(
+					cur,
+					'\n',
+					end - cur
+				);
+				if (!line_end)
+					line_end = end;
+			}
+			if (!*error && line_end > cur) {
+				record->location = cur;
+				record->location_length = line_end - cur;
+				/* Discard the following blank line. */
+				cur = line_end < end ? line_end + 1 : end;
+				line_end = (char *) memchr(cur, '\n', end - cur);
+				if (!line_end)
+					line_end = end;
+			}
+			if (!*error)
+				result = line_end < end ? line_end + 1 : end;
+		}
+	}
+	return result;
+}
+
+char *ucpcal_borrow(
+	ucpcal_arena *arena,
+	char *string,
+	size_t length,
+	const char *end
+) {
+	/*
+		A string is followed by its newline unless it runs to the end
+		of the buffer, where nothing ends it.
+	*/
+	if (string + length >= end)
+		string = ucpcal_arena_string(arena, string, length);
+	return string;
+}
+
+unsigned long ucpcal_count_lines(const char *text, const char *end) {
+	unsigned long result = 0;
+	while (text < end) {
+		if (*text == '\n')
+			result++;
+		text++;
+	}
+	return result;
+}
+
+const char *ucpcal_line_start(const char *text, const char *position) {
+	while (position > text && position[-1] != '\n')
+		position--;
+	return position;
+}
+
+int ucpcal_is_blank(const char *text, const char *end) {
+	while (
+		text < end &&
+		(*text == ' ' || *text == '\t' || *text == '\r')
+	)
+		text++;
+	return text == end;
+}
+
+const char *ucpcal_parse_header(
+	const char *text,
+	const char *end,
+	ucpcal_date *date,
+	unsigned int *duration,
+	const char **error
+) {
+	const char *cur = ucpcal_date_parse(text, end, date, error);
+	const char *field;
+	*duration = 0;
+	if (!*error) {
+		while (cur < end && (*cur == ' ' || *cur == '\t'))
+			cur++;
+		field = cur;
+		/*
+			Like the fscanf() this replaces, an overlong duration
+			wraps around rather than being rejected; unsigned
+			arithmetic wraps by definition, so this is well defined.
+		*/
+		while (cur < end && *cur >= '0' && *cur <= '9') {
+			*duration = *duration * 10 + (*cur - '0');
+			cur++;
+		}
+		if (cur == field) {
+			*error = "expected a duration in minutes";
+		} else if (cur < end && *cur != ' ' && *cur != '\t') {
+			*error = "expected a space after the duration";
+		} else {
+			while (cur < end && (*cur == ' ' || *cur == '\t'))
+				cur++;
+		}
+	}
+	return cur;
+}
+
+int ucpcal_save(ucpcal_list *list, const char *filename) {
+	/*
+		Postel's law: be conservative in what you do, be liberal in
+		what you accept from others.
+
+		write() never translates line endings, so that regardless of
+		platform, we standardise on outputting files with LF line
+		endings.
+	*/
+	ucpcal_writer *writer = ucpcal_writer_new(filename);
+	ucpcal_node *cur;
+	int result = -1;
+	if (writer) {
+		/* Once a write has failed, there is no point going on. */
+		for (cur = list->head; cur && !writer->failed; cur = cur->next)
+			ucpcal_save_event(writer, cur->event);
+		if (writer->failed)
+			ucpcal_writer_abort(writer);
+		else
+			result = ucpcal_writer_commit(writer);
+	}
+	return result;
+}
+
+void ucpcal_save_event(ucpcal_writer *writer, const ucpcal_event *event) {
+	char header[UCPCAL_HEADER_SIZE], *rule;
+	ucpcal_writer_write(
+		writer,
+		header,
+		ucpcal_format_header(header, event) - header
+	);
+	ucpcal_writer_write(
+		writer,
+		event->name,
+		ucpcal_string_length(event->name)
+	);
+	if (event->rule) {
+		rule = (char *) malloc(ucpcal_rule_format_size(event->rule));
+		/* The newline takes the place of the null terminator. */
+		ucpcal_writer_write(
+			writer,
+			"\n" UCPCAL_RULE_PREFIX,
+			sizeof(UCPCAL_RULE_PREFIX)
+		);
+		ucpcal_writer_write(
+			writer,
+			rule,
+			ucpcal_rule_format(rule, event->rule)
+		);
+		free(rule);
+	}
+	if (event->location) {
+		ucpcal_writer_write(writer, "\n", 1);
+		ucpcal_writer_write(
+			writer,
+			event->location,
+			ucpcal_string_length(event->location)
+		);
+	}
+	ucpcal_writer_write(writer, "\n\n", 2);
+}
+
+char *ucpcal_format_header(char *buffer, const ucpcal_event *event) {
+	char *cur = buffer;
+	cur = ucpcal_format_number(cur, event->date.year, 1);
+	*cur++ = '-';
+	cur = ucpcal_format_number(cur, event->date.month, 2);
+	*cur++ = '-';
+	cur = ucpcal_format_number(cur, event->date.day, 2);
+	*cur++ = ' ';
+	cur = ucpcal_format_number(cur, event->date.hour, 2);
+	*cur++ = ':';
+	cur = ucpcal_format_number(cur, event->date.minute, 2);
+	*cur++ = ' ';
+	cur = ucpcal_format_number(cur, event->duration, 1);
+	*cur++ = ' ';
+	return cur;
+}
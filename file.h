@@ -0,0 +1,444 @@
+/**
+ * @file file.h
+ * @brief Algorithms for loading and saving calendar files.
+ */
+
+#ifndef UCPCAL_FILE_H
+#define UCPCAL_FILE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "date.h"
+#include "event.h"
+#include "list.h"
+#include "reader.h"
+#include "map.h"
+#include "writer.h"
+
+/**
+ * @brief Load files with ucpcal_load().
+ */
+
+#define UCPCAL_LOAD_BUFFERED 0
+
+/**
+ * @brief Load files with ucpcal_load_mapped().
+ */
+
+#define UCPCAL_LOAD_MAPPED 1
+
+/**
+ * @brief Load files with ucpcal_load_parallel(), using every processor.
+ */
+
+#define UCPCAL_LOAD_PARALLEL 2
+
+/**
+ * @brief How many records are loaded between reports of progress.
+ */
+
+#define UCPCAL_PROGRESS_INTERVAL 4096
+
+/**
+ * @brief Enough room for the start of a header line as written by
+ * ucpcal_format_header(), with a nine digit year and a 64-bit duration.
+ */
+
+#define UCPCAL_HEADER_SIZE 64
+
+/**
+ * @brief A data structure for following a load from another thread.
+ * The loading thread reports how far through the file it is, and any thread
+ * may ask it to stop early, leaving the list partly loaded.
+ */
+
+typedef struct ucpcal_progress {
+	pthread_mutex_t lock;
+	/**
+	 * The number of bytes of the file loaded so far.
+	 */
+	size_t done;
+	/**
+	 * The size of the file in bytes, or 0 until it is known.
+	 */
+	size_t total;
+	/**
+	 * Non-zero once the load has been asked to stop.
+	 */
+	int cancelled;
+} ucpcal_progress;
+
+/**
+ * @brief A data structure representing a record parsed from a buffer.
+ * The name and location point into the buffer and are not null terminated.
+ */
+
+typedef struct ucpcal_record {
+	ucpcal_date date;
+	unsigned int duration;
+	char *name;
+	size_t name_length;
+	/**
+	 * The location, or NULL if the record has none.
+	 */
+	char *location;
+	size_t location_length;
+	/**
+	 * The rule by which the event recurs, following UCPCAL_RULE_PREFIX on
+	 * its line, or NULL if the record has none.
+	 */
+	char *rule;
+	size_t rule_length;
+} ucpcal_record;
+
+/**
+ * @brief Sets up a ucpcal_progress for a new load.
+ * @param progress the ucpcal_progress to set up
+ */
+
+void ucpcal_progress_init(ucpcal_progress *progress);
+
+/**
+ * @brief Cleans up a ucpcal_progress once its load has finished.
+ * @param progress the ucpcal_progress to clean up
+ */
+
+void ucpcal_progress_destroy(ucpcal_progress *progress);
+
+/**
+ * @brief Reports how far a load has got, from the loading thread.
+ * @param progress the ucpcal_progress to report to, or NULL for none
+ * @param done the number of bytes loaded so far
+ * @param total the size of the file in bytes
+ * @return non-zero if the load should stop
+ */
+
+int ucpcal_progress_report(
+	ucpcal_progress *progress,
+	size_t done,
+	size_t total
+);
+
+/**
+ * @brief Asks a load to stop as soon as it next reports its progress.
+ * @param progress the ucpcal_progress of the load
+ */
+
+void ucpcal_progress_cancel(ucpcal_progress *progress);
+
+/**
+ * @brief Checks whether a load has been asked to stop, from any thread.
+ * @param progress the ucpcal_progress of the load
+ * @return non-zero if ucpcal_progress_cancel() has been called
+ */
+
+int ucpcal_progress_cancelled(ucpcal_progress *progress);
+
+/**
+ * @brief Finds how far a load has got, from any thread.
+ * @param progress the ucpcal_progress of the load
+ * @return the percentage of the file loaded so far
+ */
+
+int ucpcal_progress_percent(ucpcal_progress *progress);
+
+/**
+ * @brief Loads calendar data from a file into a linked list of events.
+ * A malformed record is reported with where it is on stderr and skipped up
+ * to the blank line that ends it, and loading carries on with the next.
+ * @param list the linked list of calendar events
+ * @param filename the filename to look for input data in
+ * @param progress where to report progress, which may stop the load early,
+ * or NULL for none
+ * @return the number of malformed records skipped
+ */
+
+unsigned long ucpcal_load(
+	ucpcal_list *list,
+	const char *filename,
+	ucpcal_progress *progress
+);
+
+/**
+ * @brief Loads calendar data from a memory mapped file without copying.
+ * Events borrow their names and locations from a read only mapping of the
+ * file, owned by the list until it is emptied, so they end at their
+ * newlines as described for ucpcal_event. Only strings that reach the very
+ * end of a file lacking a final newline have to be copied. Editing an event
+ * with ucpcal_list_edit() gives it its own copies. Malformed records are
+ * skipped, as with ucpcal_load().
+ * @param list the linked list of calendar events
+ * @param filename the filename to look for input data in
+ * @param progress where to report progress, which may stop the load early,
+ * or NULL for none
+ * @return the number of malformed records skipped
+ */
+
+unsigned long ucpcal_load_mapped(
+	ucpcal_list *list,
+	const char *filename,
+	ucpcal_progress *progress
+);
+
+/**
+ * @brief A data structure representing one thread's share of a parallel load.
+ * Everything a batch allocates comes from its own arena, so that threads
+ * never contend for memory, and is handed over to the list when merged.
+ */
+
+typedef struct ucpcal_batch {
+	/**
+	 * The start of the records in the batch, just after an empty line or
+	 * at the start of the file.
+	 */
+	char *text;
+	/**
+	 * The end of the records in the batch.
+	 */
+	char *end;
+	ucpcal_arena *arena;
+	/**
+	 * The nodes parsed, each with its event, in file order.
+	 */
+	ucpcal_node **nodes;
+	/**
+	 * The same nodes, sorted by start time with ties in file order.
+	 */
+	ucpcal_node **sorted;
+	size_t count;
+	size_t capacity;
+	/**
+	 * A description of the first malformed record skipped, or NULL if
+	 * there was none.
+	 */
+	const char *error;
+	/**
+	 * The offending position in that malformed record, if any.
+	 */
+	char *error_position;
+	/**
+	 * The number of malformed records skipped.
+	 */
+	unsigned long skipped;
+} ucpcal_batch;
+
+/**
+ * @brief Loads calendar data from a file in the way given.
+ * Binary calendar files are recognised and loaded with ucpcal_binary_load()
+ * whatever the way given. Binary and parallel loads are quick enough that
+ * they only report progress when they finish, and cannot be stopped early.
+ * @param list the linked list of calendar events
+ * @param filename the filename to look for input data in
+ * @param mode UCPCAL_LOAD_BUFFERED, UCPCAL_LOAD_MAPPED or UCPCAL_LOAD_PARALLEL
+ * @param progress where to report progress, which may stop the load early,
+ * or NULL for none
+ * @return non-zero if any of the file could not be loaded, whether records
+ * were skipped or a binary file was rejected
+ */
+
+int ucpcal_load_mode(
+	ucpcal_list *list,
+	const char *filename,
+	int mode,
+	ucpcal_progress *progress
+);
+
+/**
+ * @brief Loads calendar data from a memory mapped file using many threads.
+ * The file is split into chunks at empty lines, which always end a record,
+ * and each thread parses a chunk into a batch of nodes and sorts them by
+ * time. The batches are then merged in file order, so that the first event
+ * with a given name still wins and the list ends up exactly as it would
+ * with ucpcal_load_mapped(), and the sorted runs are merged to build the
+ * tree of start times in one pass. Malformed records are skipped, as with
+ * ucpcal_load(), and the first in each chunk is reported.
+ * @param list the linked list of calendar events
+ * @param filename the filename to look for input data in
+ * @param threads the number of threads to use, or zero for one per online
+ * processor
+ * @return the number of malformed records skipped
+ */
+
+unsigned long ucpcal_load_parallel(
+	ucpcal_list *list,
+	const char *filename,
+	int threads
+);
+
+/**
+ * @brief Parses the records of a batch and sorts them by start time.
+ * Only touches the batch and its part of the buffer, so batches over
+ * separate chunks can be parsed on separate threads.
+ * @param batch pointer to the ucpcal_batch to parse, as a void pointer for
+ * pthread_create()
+ * @return NULL
+ */
+
+void *ucpcal_batch_parse(void *batch);
+
+/**
+ * @brief Adds a node to a batch, growing its arrays as needed.
+ * @param batch the batch to add to
+ * @param node the node to add
+ */
+
+void ucpcal_batch_add(ucpcal_batch *batch, ucpcal_node *node);
+
+/**
+ * @brief Sorts the nodes of a batch by start time, with ties in file order.
+ * Each node's start time must be in its links, with its position in the
+ * batch as its sequence number.
+ * @param batch the batch to sort
+ */
+
+void ucpcal_batch_sort(ucpcal_batch *batch);
+
+/**
+ * @brief Merges parsed batches into an empty list, in order.
+ * Each batch's arena
+ * is handed over to the list and its arrays are freed.
+ * @param list the linked list of calendar events, which must be empty
+ * @param batches the batches, in file order
+ * @param count the number of batches
+ */
+
+void ucpcal_batch_merge(ucpcal_list *list, ucpcal_batch *batches, int count);
+
+/**
+ * @brief Finds the first record boundary after a position in a buffer.
+ * An empty line always ends a record, whether as the missing location or as
+ * the line after a location, so the line after one starts a fresh record.
+ * @param text the position to search from
+ * @param end the end of the buffer
+ * @return the start of the line after the next empty line, or end
+ */
+
+char *ucpcal_record_boundary(char *text, char *end);
+
+/**
+ * @brief Parses the next calendar record from a buffer.
+ * Blank lines before the record are skipped. A record is a header line as
+ * described for ucpcal_parse_header(), then a rule line as described for
+ * ucpcal_rule_line() if the event recurs, then a location line which may be
+ * blank, and if the location is not blank, one more line which is ignored.
+ * @param text the start of the buffer
+ * @param end the end of the buffer
+ * @param record where to store the record
+ * @param error where to store a description of the problem on failure, or
+ * NULL otherwise
+ * @return just past the record on success, NULL if there are no more
+ * records, or the offending position on failure
+ */
+
+char *ucpcal_record_parse(
+	char *text,
+	char *end,
+	ucpcal_record *record,
+	const char **error
+);
+
+/**
+ * @brief Parses the first line of a calendar record from a buffer.
+ * The line has the format "YYYY-MM-DD HH:MM DURATION NAME", where the date
+ * and time are parsed by ucpcal_date_parse() and the duration is a number of
+ * minutes. Whitespace around the duration is skipped, and the rest of the
+ * line is the name of the event.
+ * @param text the start of the line
+ * @param end the end of the line, which need not be null terminated
+ * @param date where to store the date and time
+ * @param duration where to store the duration
+ * @param error where to store a description of the problem on failure, or
+ * NULL on success
+ * @return the start of the name on success, or the offending position
+ */
+
+const char *ucpcal_parse_header(
+	const char *text,
+	const char *end,
+	ucpcal_date *date,
+	unsigned int *duration,
+	const char **error
+);
+
+/**
+ * @brief Saves calendar data to a file from a linked list of events.
+ * The file is replaced atomically, through a ucpcal_writer, so a crash while
+ * saving leaves the old file intact rather than a truncated one.
+ * @param list the linked list of calendar events
+ * @param filename the filename to output calendar data to
+ * @return 0 on success, or -1 if the file could not be written
+ */
+
+int ucpcal_save(ucpcal_list *list, const char *filename);
+
+/**
+ * @brief Writes one event as a calendar record.
+ * The header line is formatted by ucpcal_format_header() into a small
+ * buffer and written in one go, along with the strings, and the rule, if
+ * any, is formatted by ucpcal_rule_format() on the line after it, following
+ * UCPCAL_RULE_PREFIX.
+ * @param writer the writer to write through
+ * @param event the event to write
+ */
+
+void ucpcal_save_event(ucpcal_writer *writer, const ucpcal_event *event);
+
+/**
+ * @brief Writes the date, time and duration that start an event's header
+ * line, with ucpcal_format_number() rather than printf().
+ * @param buffer where to write, with room for UCPCAL_HEADER_SIZE bytes
+ * @param event the event whose header it is
+ * @return just past the space before the name; nothing is null terminated
+ */
+
+char *ucpcal_format_header(char *buffer, const ucpcal_event *event);
+
+/**
+ * @brief Borrows a string from a buffer for an event, copying it if need be.
+ * @param arena the arena to copy the string into if need be
+ * @param string the start of the string, which ends at a newline
+ * @param length the number of bytes in the string
+ * @param end the end of the buffer; a string reaching it has no newline to
+ * end it, so it is copied and null terminated instead
+ * @return the string, either in place or copied
+ */
+
+char *ucpcal_borrow(
+	ucpcal_arena *arena,
+	char *string,
+	size_t length,
+	const char *end
+);
+
+/**
+ * @brief Counts the newlines in a buffer.
+ * @param text the start of the buffer
+ * @param end the end of the buffer
+ * @return the number of newlines
+ */
+
+unsigned long ucpcal_count_lines(const char *text, const char *end);
+
+/**
+ * @brief Finds the start of the line containing a position in a buffer.
+ * @param text the start of the buffer
+ * @param position the position within the buffer
+ * @return the start of the line
+ */
+
+const char *ucpcal_line_start(const char *text, const char *position);
+
+/**
+ * @brief Checks whether a line contains nothing but whitespace.
+ * @param text the start of the line
+ * @param end the end of the line
+ * @return 1 if the line is blank, 0 otherwise
+ */
+
+int ucpcal_is_blank(const char *text, const char *end);
+
+#endif
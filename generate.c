@@ -0,0 +1,127 @@
+/**
+ * @file generate.c
+ * @brief Data structures and algorithms for generating synthetic calendars.
+ */
+
+#include "generate.h"
+
+void ucpcal_generator_init(ucpcal_generator *generator, unsigned long seed) {
+	ucpcal_date date = { 1, 2013, 1, 1, 0, 0 };
+	ucpcal_generator_seed(generator, seed);
+	generator->start = ucpcal_time_from_date(date);
+	generator->span = 365UL * 1440;
+	generator->max_duration = 480;
+	generator->name_words = 2;
+	generator->location_percent = 67;
+	generator->locations = 1000;
+}
+
+void ucpcal_generator_seed(ucpcal_generator *generator, unsigned long seed) {
+	/* Zero is a fixed point of xorshift, so it cannot be a seed. */
+	generator->state = (seed & 0xffffffffUL) ? seed & 0xffffffffUL : 1;
+}
+
+unsigned long ucpcal_generator_random(ucpcal_generator *generator) {
+	unsigned long x = generator->state;
+	x ^= (x << 13) & 0xffffffffUL;
+	x ^= x >> 17;
+	x ^= (x << 5) & 0xffffffffUL;
+	generator->state = x;
+	return x;
+}
+
+void ucpcal_generator_next(
+	ucpcal_generator *generator,
+	unsigned long index,
+	ucpcal_event *event
+) {
+	static const char *words[] = {
+		"Team", "Project", "Weekly", "Budget", "Design", "Review",
+		"Planning", "Lunch", "Standup", "Client", "Board", "Training",
+		"Interview", "Retro", "Sync", "Demo", "Quarterly", "Hiring",
+		"Security", "Launch", "Support", "Research", "Sales", "Audit",
+		"Coffee", "Strategy", "Ops", "Product", "Finance", "Legal",
+		"Onboarding", "Workshop"
+	};
+	char *cur = generator->name;
+	int i;
+	for (i = 0; i < generator->name_words; i++)
+		cur += sprintf(
+			cur,
+			"%s ",
+			words[ucpcal_generator_random(generator) % 32]
+		);
+	sprintf(cur, "%lu", index);
+	event->date = ucpcal_time_to_date(
+		generator->start +
+		(long) (ucpcal_generator_random(generator) % generator->span)
+	);
+	event->duration = ucpcal_generator_random(generator) %
+		(generator->max_duration + 1UL);
+	event->name = generator->name;
+	event->location = NULL;
+	event->rule = NULL;
+	if (
+		ucpcal_generator_random(generator) % 100 <
+		(unsigned long) generator->location_percent
+	) {
+		sprintf(
+			generator->location,
+			"Room %lu",
+			ucpcal_generator_random(generator) %
+				generator->locations + 1
+		);
+		event->location = generator->location;
+	}
+}
+
+int ucpcal_generate_file(
+	ucpcal_generator *generator,
+	const char *filename,
+	unsigned long count
+) {
+	ucpcal_writer *writer = ucpcal_writer_new(filename);
+	ucpcal_event event;
+	unsigned long i;
+	int result = -1;
+	if (writer) {
+		/* Once a write has failed, there is no point going on. */
+		for (i = 0; i < count && !writer->failed; i++) {
+			ucpcal_generator_next(generator, i, &event);
+			ucpcal_save_event(writer, &event);
+		}
+		if (writer->failed)
+			ucpcal_writer_abort(writer);
+		else
+			result = ucpcal_writer_commit(writer);
+	}
+	return result;
+}
+
+ucpcal_event **ucpcal_generate_events(
+	ucpcal_generator *generator,
+	unsigned long first,
+	unsigned long count
+) {
+	ucpcal_event **events = (ucpcal_event **) malloc(
+		/* One spare, so that no events is not a zero size. */
+		(count + 1) * sizeof(ucpcal_event *)
+	);
+	ucpcal_event generated;
+	unsigned long i;
+	for (i = 0; i < count; i++) {
+		ucpcal_generator_next(generator, first + i, &generated);
+		events[i] = ucpcal_event_new();
+		events[i]->date = generated.date;
+		events[i]->duration = generated.duration;
+		events[i]->name = (char *) malloc(strlen(generated.name) + 1);
+		strcpy(events[i]->name, generated.name);
+		if (generated.location) {
+			events[i]->location = (char *) malloc(
+				strlen(generated.location) + 1
+			);
+			strcpy(events[i]->location, generated.location);
+		}
+	}
+	return events;
+}
@@ -0,0 +1,139 @@
+/**
+ * @file generate.h
+ * @brief Data structures and algorithms for generating synthetic calendars.
+ */
+
+#ifndef UCPCAL_GENERATE_H
+#define UCPCAL_GENERATE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "date.h"
+#include "event.h"
+#include "list.h"
+#include "file.h"
+#include "writer.h"
+
+/**
+ * @brief A data structure describing a synthetic calendar to generate.
+ * Events are generated from a seeded pseudorandom sequence that depends on
+ * nothing but the seed, so the same settings always give the same calendar
+ * on every platform. Every event gets a distinct name.
+ */
+
+typedef struct ucpcal_generator {
+	/**
+	 * The state of the pseudorandom sequence, which must not be zero.
+	 */
+	unsigned long state;
+	/**
+	 * The earliest start time, in minutes since the Unix epoch.
+	 */
+	ucpcal_time start;
+	/**
+	 * The number of minutes after the earliest start time that events
+	 * may start in.
+	 */
+	unsigned long span;
+	/**
+	 * The longest duration to give an event, in minutes.
+	 */
+	unsigned int max_duration;
+	/**
+	 * The number of words to put before the number in each name.
+	 */
+	int name_words;
+	/**
+	 * The percentage of events that have a location.
+	 */
+	int location_percent;
+	/**
+	 * The number of distinct locations to choose from.
+	 */
+	unsigned long locations;
+	/**
+	 * Buffers for the name and location of the latest event.
+	 */
+	char name[256];
+	char location[64];
+} ucpcal_generator;
+
+/**
+ * @brief Sets up a generator with the default settings.
+ * By default, events start in the year from 2013-01-01, last up to eight
+ * hours, have names of two words and a number, and two thirds of them are
+ * at one of a thousand locations.
+ * @param generator the generator to set up
+ * @param seed the seed for the pseudorandom sequence
+ */
+
+void ucpcal_generator_init(ucpcal_generator *generator, unsigned long seed);
+
+/**
+ * @brief Restarts a generator's pseudorandom sequence from a seed.
+ * Only the lowest 32 bits of the seed are used, and zero is treated as one.
+ * @param generator the generator to reseed
+ * @param seed the seed for the pseudorandom sequence
+ */
+
+void ucpcal_generator_seed(ucpcal_generator *generator, unsigned long seed);
+
+/**
+ * @brief Produces the next pseudorandom number from a generator.
+ * A 32-bit xorshift generator, kept to 32 bits even where longs are wider.
+ * @param generator the generator to advance
+ * @return a number from 0 to 4294967295
+ */
+
+unsigned long ucpcal_generator_random(ucpcal_generator *generator);
+
+/**
+ * @brief Generates the next event.
+ * @param generator the generator to use
+ * @param index the number of the event, which makes its name distinct
+ * @param event where to store the event, whose strings are the generator's
+ * buffers and are only valid until the next event is generated
+ */
+
+void ucpcal_generator_next(
+	ucpcal_generator *generator,
+	unsigned long index,
+	ucpcal_event *event
+);
+
+/**
+ * @brief Writes a synthetic calendar file.
+ * Events are written as they are generated, so files of any size can be
+ * generated without holding them in memory.
+ * @param generator the generator to use
+ * @param filename the calendar file to write
+ * @param count the number of events to write
+ * @return 0 on success, or -1 if the file could not be written
+ */
+
+int ucpcal_generate_file(
+	ucpcal_generator *generator,
+	const char *filename,
+	unsigned long count
+);
+
+/**
+ * @brief Generates events into heap allocated events, ready to be added to a
+ * list.
+ * Be sure to use ucpcal_event_free() on each event that is not handed to a
+ * list, and free() on the array, when finished.
+ * @param generator the generator to use
+ * @param first the number of the first event, so that events generated by
+ * separate calls can be kept distinct
+ * @param count the number of events to generate
+ * @return a heap allocated array of pointers to new ucpcal_event structs
+ */
+
+ucpcal_event **ucpcal_generate_events(
+	ucpcal_generator *generator,
+	unsigned long first,
+	unsigned long count
+);
+
+#endif
@@ -31,6 +31,16 @@ typedef struct {
 } Callback;
 
 
+/**
+ * Used internally by the addTimeout function, and the timeoutFired static
+ * function. Like Callback, but the function says whether to keep going.
+ */
+typedef struct {
+    int (*function)(void*);
+    void *data;
+} TimeoutCallback;
+
+
 /**
  * Creates and returns a new GUI window. This window will have space for a set 
  * of buttons on the left, and an area to display text on the right. You must 
@@ -100,6 +110,86 @@ void setText(Window *window, char *newText)
 }
 
 
+/**
+ * Inserts text into the text displayed by the window, leaving the rest as it
+ * is. The offset counts characters (not bytes) from the start of the text.
+ * This is much faster than setText when only a small part of a long text
+ * changes.
+ */
+void insertText(Window *window, long offset, char *text)
+{
+    GtkTextIter iter;
+    
+    assert(window != NULL);
+    assert(text != NULL);
+    gtk_text_buffer_get_iter_at_offset(GTK_TEXT_BUFFER(window->textBuffer),
+                                       &iter, (gint)offset);
+    gtk_text_buffer_insert(GTK_TEXT_BUFFER(window->textBuffer), &iter, text, -1);
+}
+
+
+/**
+ * Deletes a range of the text displayed by the window, leaving the rest as it
+ * is. The offset and length count characters (not bytes).
+ */
+void deleteText(Window *window, long offset, long length)
+{
+    GtkTextIter start, end;
+    
+    assert(window != NULL);
+    assert(offset >= 0 && length >= 0);
+    gtk_text_buffer_get_iter_at_offset(GTK_TEXT_BUFFER(window->textBuffer),
+                                       &start, (gint)offset);
+    gtk_text_buffer_get_iter_at_offset(GTK_TEXT_BUFFER(window->textBuffer),
+                                       &end, (gint)(offset + length));
+    gtk_text_buffer_delete(GTK_TEXT_BUFFER(window->textBuffer), &start, &end);
+}
+
+
+/**
+ * Sets the title of the window, as shown in its title bar.
+ */
+void setTitle(Window *window, char *title)
+{
+    assert(window != NULL);
+    assert(title != NULL);
+    gtk_window_set_title(GTK_WINDOW(window->gtkWindow), title);
+}
+
+
+/**
+ * Not visible outside this file. This is a generic timeout handler, a
+ * go-between like buttonClicked below. Returning FALSE stops the timeout,
+ * after which GTK frees the TimeoutCallback.
+ */
+static gboolean timeoutFired(gpointer data)
+{
+    TimeoutCallback *callback = (TimeoutCallback*)data;
+    return callback->function(callback->data) ? TRUE : FALSE;
+}
+
+
+/**
+ * Calls a function every so many milliseconds, once the GUI is running,
+ * until it returns zero. The function is called on the same thread as the
+ * button callbacks, so it may use the window freely.
+ */
+void addTimeout(Window *window, int milliseconds, int (*callback)(void*), void *data)
+{
+    TimeoutCallback *callbackDetails;
+    
+    assert(window != NULL);
+    assert(callback != NULL);
+    
+    callbackDetails = (TimeoutCallback*)malloc(sizeof(TimeoutCallback));
+    callbackDetails->function = callback;
+    callbackDetails->data = data;
+    
+    g_timeout_add_full(G_PRIORITY_DEFAULT, milliseconds, timeoutFired,
+                       (gpointer)callbackDetails, free);
+}
+
+
 /**
  * Not visible outside this file. This is a generic button-click event handler.
  * It's a go-between, between GTK and your assignment code, so that you don't
@@ -54,6 +54,36 @@ Window *createWindow(char *title);
 void setText(Window *window, char *newText);
 
 
+/**
+ * Inserts text into the text displayed by the window, leaving the rest as it
+ * is. The offset counts characters (not bytes) from the start of the text.
+ * This is much faster than setText when only a small part of a long text
+ * changes.
+ */
+void insertText(Window *window, long offset, char *text);
+
+
+/**
+ * Deletes a range of the text displayed by the window, leaving the rest as it
+ * is. The offset and length count characters (not bytes).
+ */
+void deleteText(Window *window, long offset, long length);
+
+
+/**
+ * Sets the title of the window, as shown in its title bar.
+ */
+void setTitle(Window *window, char *title);
+
+
+/**
+ * Calls a function every so many milliseconds, once the GUI is running,
+ * until it returns zero. The function is called on the same thread as the
+ * button callbacks, so it may use the window freely.
+ */
+void addTimeout(Window *window, int milliseconds, int (*callback)(void*), void *data);
+
+
 /**
  * Adds a button to the window. You must specify:
  * window   -- as returned by createWindow.
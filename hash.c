@@ -0,0 +1,162 @@
+/**
+ * @file hash.c
+ * @brief Data structures and algorithms for hash tables of list nodes.
+ */
+
+#include "hash.h"
+#include "profile.h"
+#include "list.h"
+
+ucpcal_hash *ucpcal_hash_new(void) {
+	ucpcal_hash *hash = (ucpcal_hash *) malloc(sizeof(ucpcal_hash));
+	hash->slots = NULL;
+	hash->capacity = 0;
+	hash->used = 0;
+	hash->deleted = 0;
+	/* A small table suits both the GUI and most calendar files. */
+	ucpcal_hash_resize(hash, 16);
+	return hash;
+}
+
+void ucpcal_hash_free(ucpcal_hash *hash) {
+	if (hash) {
+		free(hash->slots);
+		free(hash);
+	}
+}
+
+unsigned long ucpcal_hash_string(const char *name) {
+	/* FNV-1a, with the offset basis and prime for 32-bit hashes. */
+	unsigned long result = 2166136261UL;
+	const unsigned char *cur = (const unsigned char *) name;
+	/* Names borrowed from a mapped file end at a newline instead. */
+	while (*cur && *cur != '\n') {
+		result ^= *cur;
+		/* unsigned long may be wider than 32 bits; truncate it. */
+		result = (result * 16777619UL) & 0xFFFFFFFFUL;
+		cur++;
+	}
+	/* 0 and 1 mark empty slots and tombstones respectively. */
+	if (result < 2)
+		result += 2;
+	return result;
+}
+
+void ucpcal_hash_insert(ucpcal_hash *hash, ucpcal_node *node) {
+	unsigned long key = ucpcal_hash_string(node->event->name);
+	size_t mask, i;
+	/*
+		Keep at most three quarters of the slots occupied, counting
+		tombstones, so that probe sequences stay short. If the table
+		is mostly tombstones, rebuilding at the same size is enough.
+	*/
+	if ((hash->used + hash->deleted + 1) * 4 > hash->capacity * 3) {
+		if ((hash->used + 1) * 2 > hash->capacity)
+			ucpcal_hash_resize(hash, hash->capacity * 2);
+		else
+			ucpcal_hash_resize(hash, hash->capacity);
+	}
+	mask = hash->capacity - 1;
+	i = key & mask;
+	/* Take the first empty slot or tombstone in the probe sequence. */
+	while (hash->slots[i].node)
+		i = (i + 1) & mask;
+	if (hash->slots[i].hash == 1)
+		hash->deleted--;
+	hash->slots[i].hash = key;
+	hash->slots[i].node = node;
+	hash->used++;
+}
+
+void ucpcal_hash_remove(ucpcal_hash *hash, ucpcal_node *node) {
+	unsigned long key = ucpcal_hash_string(node->event->name);
+	size_t mask = hash->capacity - 1;
+	size_t i = key & mask;
+	int done = 0;
+	while (hash->slots[i].hash && !done) {
+		if (hash->slots[i].node == node) {
+			/* Leave a tombstone so later probes carry on. */
+			hash->slots[i].hash = 1;
+			hash->slots[i].node = NULL;
+			hash->used--;
+			hash->deleted++;
+			done = 1;
+		}
+		i = (i + 1) & mask;
+	}
+}
+
+ucpcal_node *ucpcal_hash_find(ucpcal_hash *hash, const char *name) {
+	unsigned long key = ucpcal_hash_string(name);
+	size_t mask = hash->capacity - 1;
+	size_t i = key & mask;
+	ucpcal_node *result = NULL;
+	/* An empty slot ends the probe sequence; tombstones do not. */
+	while (hash->slots[i].hash && !result) {
+		if (hash->slots[i].hash == key) {
+			UCPCAL_PROFILE_COUNT(UCPCAL_PROFILE_FIND_STRCMP, 1);
+			if (!ucpcal_string_compare(
+				hash->slots[i].node->event->name,
+				name
+			))
+				result = hash->slots[i].node;
+		}
+		i = (i + 1) & mask;
+	}
+	return result;
+}
+
+ucpcal_node *ucpcal_hash_find_event(
+	ucpcal_hash *hash,
+	const ucpcal_event *event
+) {
+	unsigned long key = ucpcal_hash_string(event->name);
+	size_t mask = hash->capacity - 1;
+	size_t i = key & mask;
+	ucpcal_node *result = NULL;
+	while (hash->slots[i].hash && !result) {
+		if (
+			hash->slots[i].node &&
+			hash->slots[i].node->event == event
+		)
+			result = hash->slots[i].node;
+		i = (i + 1) & mask;
+	}
+	return result;
+}
+
+void ucpcal_hash_resize(ucpcal_hash *hash, size_t capacity) {
+	ucpcal_hash_slot *old = hash->slots;
+	size_t old_capacity = hash->capacity;
+	size_t mask = capacity - 1;
+	size_t i, j;
+	/* calloc() leaves every slot empty, as hash is 0. */
+	hash->slots = (ucpcal_hash_slot *) calloc(
+		capacity,
+		sizeof(ucpcal_hash_slot)
+	);
+	for (i = 0; i < capacity; i++)
+		hash->slots[i].node = NULL;
+	hash->capacity = capacity;
+	hash->deleted = 0;
+	/* Reinsert every live node; their hashes are already known. */
+	for (i = 0; i < old_capacity; i++) {
+		if (old[i].node) {
+			j = old[i].hash & mask;
+			while (hash->slots[j].node)
+				j = (j + 1) & mask;
+			hash->slots[j] = old[i];
+		}
+	}
+	free(old);
+}
+
+void ucpcal_hash_empty(ucpcal_hash *hash) {
+	size_t i;
+	for (i = 0; i < hash->capacity; i++) {
+		hash->slots[i].hash = 0;
+		hash->slots[i].node = NULL;
+	}
+	hash->used = 0;
+	hash->deleted = 0;
+}
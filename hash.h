@@ -0,0 +1,143 @@
+/**
+ * @file hash.h
+ * @brief Data structures and algorithms for hash tables of list nodes.
+ */
+
+#ifndef UCPCAL_HASH_H
+#define UCPCAL_HASH_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "event.h"
+
+/*
+	The hash table stores pointers to linked list nodes, but list.h needs
+	to include this header to embed a table in each list, so the node
+	structure can only be declared incompletely here.
+*/
+struct ucpcal_node;
+
+/**
+ * @brief A data structure representing one slot of a hash table.
+ * A slot with a NULL node is either empty (hash is 0) or a tombstone left
+ * behind by a removal (hash is 1). Tombstones keep probe sequences intact
+ * until the table is next rebuilt.
+ */
+
+typedef struct ucpcal_hash_slot {
+	/**
+	 * The full hash of the node's event name, compared before the names
+	 * themselves so that most mismatches avoid a strcmp().
+	 */
+	unsigned long hash;
+	struct ucpcal_node *node;
+} ucpcal_hash_slot;
+
+/**
+ * @brief A data structure representing an open addressing hash table.
+ * Nodes are keyed on the name of their event, and collisions are resolved
+ * with linear probing. The capacity is always a power of two.
+ */
+
+typedef struct ucpcal_hash {
+	ucpcal_hash_slot *slots;
+	/**
+	 * The number of slots, always a power of two.
+	 */
+	size_t capacity;
+	/**
+	 * The number of slots holding a node.
+	 */
+	size_t used;
+	/**
+	 * The number of slots holding a tombstone.
+	 */
+	size_t deleted;
+} ucpcal_hash;
+
+/**
+ * @brief Creates a new, empty hash table on the heap.
+ * Be sure to use ucpcal_hash_free() when finished.
+ * @return pointer to new ucpcal_hash struct
+ */
+
+ucpcal_hash *ucpcal_hash_new(void);
+
+/**
+ * @brief Frees the memory used for a hash table struct.
+ * The nodes referred to by the table are not freed.
+ * @param hash the hash table to be freed
+ */
+
+void ucpcal_hash_free(ucpcal_hash *hash);
+
+/**
+ * @brief Calculates the hash of an event name.
+ * Uses the 32-bit FNV-1a function, which is fast and spreads short, similar
+ * strings well enough for linear probing.
+ * @param name the string to hash, ended by a null byte or a newline
+ * @return the hash value, never 0 or 1 so as not to look like an empty slot
+ */
+
+unsigned long ucpcal_hash_string(const char *name);
+
+/**
+ * @brief Inserts a node into a hash table, keyed on its event's name.
+ * The table does not check for an existing node with the same name; callers
+ * that need names to be unique should use ucpcal_hash_find() first.
+ * @param hash the hash table to insert into
+ * @param node the node to insert
+ */
+
+void ucpcal_hash_insert(ucpcal_hash *hash, struct ucpcal_node *node);
+
+/**
+ * @brief Removes a particular node from a hash table.
+ * The node's event must still have the name it was inserted with.
+ * @param hash the hash table to remove from
+ * @param node the node to remove
+ */
+
+void ucpcal_hash_remove(ucpcal_hash *hash, struct ucpcal_node *node);
+
+/**
+ * @brief Finds a node by its event's name in a hash table.
+ * @param hash the hash table to search through
+ * @param name the name of the event to look for
+ * @return the first matching node, or NULL if there is no such node
+ */
+
+struct ucpcal_node *ucpcal_hash_find(ucpcal_hash *hash, const char *name);
+
+/**
+ * @brief Finds the node wrapping a particular event in a hash table.
+ * @param hash the hash table to search through
+ * @param event the event to look for
+ * @return the node wrapping the event, or NULL if there is no such node
+ */
+
+struct ucpcal_node *ucpcal_hash_find_event(
+	ucpcal_hash *hash,
+	const ucpcal_event *event
+);
+
+/**
+ * @brief Rebuilds a hash table with a new capacity.
+ * All tombstones are discarded in the process.
+ * @param hash the hash table to rebuild
+ * @param capacity the new number of slots, which must be a power of two and
+ * greater than the number of nodes in the table
+ */
+
+void ucpcal_hash_resize(ucpcal_hash *hash, size_t capacity);
+
+/**
+ * @brief Empties a hash table.
+ * The nodes referred to by the table are not freed.
+ * @param hash the hash table to empty
+ */
+
+void ucpcal_hash_empty(ucpcal_hash *hash);
+
+#endif
@@ -0,0 +1,350 @@
+/**
+ * @file journal.c
+ * @brief Data structures and algorithms for journals of calendar changes.
+ */
+
+#include "journal.h"
+#include <fcntl.h>
+
+ucpcal_journal *ucpcal_journal_new(const char *base) {
+	ucpcal_journal *journal = (ucpcal_journal *) malloc(
+		sizeof(ucpcal_journal)
+	);
+	journal->base = (char *) malloc(strlen(base) + 1);
+	strcpy(journal->base, base);
+	journal->filename = (char *) malloc(
+		strlen(base) + strlen(UCPCAL_JOURNAL_SUFFIX) + 1
+	);
+	strcpy(journal->filename, base);
+	strcat(journal->filename, UCPCAL_JOURNAL_SUFFIX);
+	journal->pending = NULL;
+	journal->length = 0;
+	journal->capacity = 0;
+	return journal;
+}
+
+void ucpcal_journal_free(ucpcal_journal *journal) {
+	if (journal) {
+		free(journal->base);
+		free(journal->filename);
+		free(journal->pending);
+		free(journal);
+	}
+}
+
+void ucpcal_journal_add(ucpcal_journal *journal, const ucpcal_event *event) {
+	ucpcal_journal_append(journal, "add\n", 4);
+	ucpcal_journal_append_event(journal, event);
+}
+
+void ucpcal_journal_edit(
+	ucpcal_journal *journal,
+	const char *name,
+	const ucpcal_event *event
+) {
+	ucpcal_journal_append(journal, "edit ", 5);
+	ucpcal_journal_append(journal, name, ucpcal_string_length(name));
+	ucpcal_journal_append(journal, "\n", 1);
+	ucpcal_journal_append_event(journal, event);
+}
+
+void ucpcal_journal_delete(ucpcal_journal *journal, const char *name) {
+	ucpcal_journal_append(journal, "delete ", 7);
+	ucpcal_journal_append(journal, name, ucpcal_string_length(name));
+	ucpcal_journal_append(journal, "\n", 1);
+}
+
+void ucpcal_journal_append_event(
+	ucpcal_journal *journal,
+	const ucpcal_event *event
+) {
+	char header[UCPCAL_HEADER_SIZE], *rule;
+	ucpcal_journal_append(
+		journal,
+		header,
+		ucpcal_format_header(header, event) - header
+	);
+	ucpcal_journal_append(
+		journal,
+		event->name,
+		ucpcal_string_length(event->name)
+	);
+	ucpcal_journal_append(journal, "\n", 1);
+	if (event->rule) {
+		rule = (char *) malloc(ucpcal_rule_format_size(event->rule));
+		ucpcal_journal_append(
+			journal,
+			UCPCAL_RULE_PREFIX,
+			sizeof(UCPCAL_RULE_PREFIX) - 1
+		);
+		ucpcal_journal_append(
+			journal,
+			rule,
+			ucpcal_rule_format(rule, event->rule)
+		);
+		ucpcal_journal_append(journal, "\n", 1);
+		free(rule);
+	}
+	/* An empty line stands for no location, as in a calendar file. */
+	if (event->location)
+		ucpcal_journal_append(
+			journal,
+			event->location,
+			ucpcal_string_length(event->location)
+		);
+	ucpcal_journal_append(journal, "\n", 1);
+}
+
+void ucpcal_journal_append(
+	ucpcal_journal *journal,
+	const char *text,
+	size_t length
+) {
+	if (journal->length + length > journal->capacity) {
+		if (!journal->capacity)
+			journal->capacity = 4096;
+		while (journal->length + length > journal->capacity)
+			journal->capacity *= 2;
+		journal->pending = (char *) realloc(
+			journal->pending,
+			journal->capacity
+		);
+	}
+	memcpy(journal->pending + journal->length, text, length);
+	journal->length += length;
+}
+
+int ucpcal_journal_flush(ucpcal_journal *journal) {
+	ucpcal_writer *writer;
+	int fd, result = 0;
+	if (journal->length) {
+		result = -1;
+		fd = open(
+			journal->filename,
+			O_WRONLY | O_APPEND | O_CREAT,
+			0666
+		);
+		if (fd != -1) {
+			/*
+				Only the new entries are written, however big
+				the calendar is, and syncing makes sure they
+				are on disk rather than in a cache when the
+				save is reported as done. The writer counts
+				the bytes written, as when saving.
+			*/
+			writer = ucpcal_writer_new_fd(fd);
+			ucpcal_writer_write(
+				writer,
+				journal->pending,
+				journal->length
+			);
+			if (!ucpcal_writer_commit(writer) && !fsync(fd))
+				result = 0;
+			if (close(fd))
+				result = -1;
+		}
+		if (!result)
+			journal->length = 0;
+	}
+	return result;
+}
+
+int ucpcal_journal_compact(ucpcal_journal *journal, ucpcal_list *list) {
+	int result;
+	/* Keep the calendar file in whichever format it was in. */
+	if (ucpcal_binary_detect(journal->base) > 0)
+		result = ucpcal_binary_save(list, journal->base);
+	else
+		result = ucpcal_save(list, journal->base);
+	/*
+		The journal goes only once the calendar file has everything
+		in it; if the save failed, the journal still has the changes.
+	*/
+	if (!result)
+		ucpcal_journal_discard(journal);
+	return result;
+}
+
+void ucpcal_journal_discard(ucpcal_journal *journal) {
+	journal->length = 0;
+	remove(journal->filename);
+}
+
+void ucpcal_journal_replay(ucpcal_list *list, const char *base) {
+	ucpcal_journal *journal = ucpcal_journal_new(base);
+	FILE *f = fopen(journal->filename, "r");
+	ucpcal_reader *reader;
+	const char *error;
+	char *line, *name;
+	size_t length;
+	unsigned long column;
+	int done = 0;
+	if (f) {
+		reader = ucpcal_reader_new(f);
+		do {
+			error = NULL;
+			column = 1;
+			line = ucpcal_reader_line(reader, &length);
+			if (!line) {
+				done = 1;
+			} else if (length == 3 && !memcmp(line, "add", 3)) {
+				error = ucpcal_journal_replay_record(
+					list,
+					reader,
+					NULL,
+					&column
+				);
+			} else if (length > 5 && !memcmp(line, "edit ", 5)) {
+				name = ucpcal_journal_string(
+					line + 5,
+					length - 5
+				);
+				error = ucpcal_journal_replay_record(
+					list,
+					reader,
+					name,
+					&column
+				);
+				free(name);
+			} else if (length > 7 && !memcmp(line, "delete ", 7)) {
+				name = ucpcal_journal_string(
+					line + 7,
+					length - 7
+				);
+				ucpcal_list_delete(list, name);
+				free(name);
+			} else {
+				error = "expected add, edit or delete";
+			}
+			if (error) {
+				/* Keep the changes before the bad entry. */
+				fprintf(stderr,
+					"%s:%lu:%lu: %s\n",
+					journal->filename,
+					reader->line,
+					column,
+					error
+				);
+				done = 1;
+			}
+		} while (!done);
+		ucpcal_reader_free(reader);
+		fclose(f);
+	}
+	ucpcal_journal_free(journal);
+}
+
+int ucpcal_journal_pending(const char *base) {
+	ucpcal_journal *journal = ucpcal_journal_new(base);
+	FILE *f = fopen(journal->filename, "r");
+	int result = 0;
+	if (f) {
+		result = fgetc(f) != EOF;
+		fclose(f);
+	}
+	ucpcal_journal_free(journal);
+	return result;
+}
+
+const char *ucpcal_journal_replay_record(
+	ucpcal_list *list,
+	ucpcal_reader *reader,
+	const char *old,
+	unsigned long *column
+) {
+	ucpcal_event *event = NULL, changes;
+	const char *name, *rule, *error = "incomplete journal entry";
+	unsigned int duration;
+	ucpcal_date date;
+	size_t length;
+	char *line = ucpcal_reader_line(reader, &length);
+	if (line) {
+		name = ucpcal_parse_header(
+			line,
+			line + length,
+			&date,
+			&duration,
+			&error
+		);
+		if (error) {
+			*column = (unsigned long) (name - line) + 1;
+		} else {
+			/*
+				Lines are only valid until the next is read, so
+				copy the name before reading the location.
+			*/
+			changes.date = date;
+			changes.duration = duration;
+			changes.name = ucpcal_journal_string(
+				name,
+				line + length - name
+			);
+			changes.location = NULL;
+			changes.rule = NULL;
+			line = ucpcal_reader_line(reader, &length);
+			/* A recurring event's rule comes first. */
+			rule = line ? ucpcal_rule_line(
+				line,
+				line + length,
+				&error
+			) : NULL;
+			if (error) {
+				*column = (unsigned long) (rule - line) + 1;
+			} else if (rule) {
+				changes.rule = ucpcal_rule_parse(
+					NULL,
+					rule,
+					line + length
+				);
+				line = ucpcal_reader_line(reader, &length);
+			}
+			if (!error && !line) {
+				error = "incomplete journal entry";
+			} else if (!error) {
+				if (length > 0)
+					changes.location =
+						ucpcal_journal_string(
+							line,
+							length
+						);
+				if (old) {
+					/*
+						An event that is already gone
+						was deleted before a compaction
+						was interrupted; skip it.
+					*/
+					event = ucpcal_list_find(list, old);
+					if (event)
+						ucpcal_list_edit(
+							list,
+							event,
+							&changes
+						);
+				} else {
+					/* The list copies it into its arena. */
+					event = ucpcal_event_new();
+					event->date = changes.date;
+					event->duration = changes.duration;
+					event->name = changes.name;
+					event->location = changes.location;
+					event->rule = changes.rule;
+					changes.name = NULL;
+					changes.location = NULL;
+					changes.rule = NULL;
+					ucpcal_list_append(list, event);
+				}
+			}
+			free(changes.name);
+			free(changes.location);
+			ucpcal_rule_free(changes.rule);
+		}
+	}
+	return error;
+}
+
+char *ucpcal_journal_string(const char *text, size_t length) {
+	char *result = (char *) malloc(length + 1);
+	memcpy(result, text, length);
+	result[length] = 0;
+	return result;
+}
@@ -0,0 +1,212 @@
+/**
+ * @file journal.h
+ * @brief Data structures and algorithms for journals of calendar changes.
+ */
+
+#ifndef UCPCAL_JOURNAL_H
+#define UCPCAL_JOURNAL_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "date.h"
+#include "event.h"
+#include "list.h"
+#include "file.h"
+#include "binary.h"
+#include "reader.h"
+
+/**
+ * @brief The suffix added to a calendar file's name to name its journal.
+ */
+
+#define UCPCAL_JOURNAL_SUFFIX ".journal"
+
+/**
+ * @brief A data structure representing the journal of a calendar file.
+ * Changes are written ahead of the calendar file itself, by appending them
+ * to the journal, so that saving a change costs the same however big the
+ * calendar is. Each entry is one of the following, where the record lines
+ * are a header, rule and location line as in a calendar file, the rule line
+ * being left out for an event that does not recur:
+ *
+ *     add
+ *     YYYY-MM-DD HH:MM DURATION NAME
+ *     RULE
+ *     LOCATION
+ *
+ *     edit OLD NAME
+ *     YYYY-MM-DD HH:MM DURATION NAME
+ *     RULE
+ *     LOCATION
+ *
+ *     delete NAME
+ *
+ * Entries are collected in memory until flushed, then appended in one go.
+ */
+
+typedef struct ucpcal_journal {
+	/**
+	 * The calendar file the journal belongs to.
+	 */
+	char *base;
+	/**
+	 * The journal file, named after the calendar file.
+	 */
+	char *filename;
+	/**
+	 * The entries not yet appended to the journal file.
+	 */
+	char *pending;
+	size_t length;
+	size_t capacity;
+} ucpcal_journal;
+
+/**
+ * @brief Creates a new journal for a calendar file on the heap.
+ * Nothing is written until ucpcal_journal_flush() is called.
+ * Be sure to use ucpcal_journal_free() when finished.
+ * @param base the calendar file the journal belongs to
+ * @return pointer to new ucpcal_journal struct
+ */
+
+ucpcal_journal *ucpcal_journal_new(const char *base);
+
+/**
+ * @brief Frees the memory used for a journal, dropping pending entries.
+ * @param journal the journal to be freed, or NULL to do nothing
+ */
+
+void ucpcal_journal_free(ucpcal_journal *journal);
+
+/**
+ * @brief Records that an event was added to the calendar.
+ * @param journal the journal to record the change in
+ * @param event the event as added
+ */
+
+void ucpcal_journal_add(ucpcal_journal *journal, const ucpcal_event *event);
+
+/**
+ * @brief Records that an event in the calendar was edited.
+ * @param journal the journal to record the change in
+ * @param name the name of the event before it was edited
+ * @param event the new data for the event
+ */
+
+void ucpcal_journal_edit(
+	ucpcal_journal *journal,
+	const char *name,
+	const ucpcal_event *event
+);
+
+/**
+ * @brief Records that an event was deleted from the calendar.
+ * @param journal the journal to record the change in
+ * @param name the name of the event that was deleted
+ */
+
+void ucpcal_journal_delete(ucpcal_journal *journal, const char *name);
+
+/**
+ * @brief Adds the record lines for an event to the pending entries.
+ * @param journal the journal to add to
+ * @param event the event to describe
+ */
+
+void ucpcal_journal_append_event(
+	ucpcal_journal *journal,
+	const ucpcal_event *event
+);
+
+/**
+ * @brief Adds text to the pending entries of a journal.
+ * @param journal the journal to add to
+ * @param text the text to add, which need not be null terminated
+ * @param length the number of bytes to add
+ */
+
+void ucpcal_journal_append(
+	ucpcal_journal *journal,
+	const char *text,
+	size_t length
+);
+
+/**
+ * @brief Appends the pending entries to the journal file.
+ * The file is synced before returning, so flushed changes survive a crash.
+ * The pending entries are kept if they could not be written.
+ * @param journal the journal to flush
+ * @return 0 on success, or -1 if the journal file could not be written
+ */
+
+int ucpcal_journal_flush(ucpcal_journal *journal);
+
+/**
+ * @brief Folds the journal back into its calendar file.
+ * The whole calendar is saved over the calendar file, in the same format as
+ * before, and the journal file is then removed, along with any entries
+ * still pending, as the calendar file now includes them.
+ * @param journal the journal to compact
+ * @param list the calendar as it stands, with every change applied
+ * @return 0 on success, or -1 if the calendar file could not be written
+ */
+
+int ucpcal_journal_compact(ucpcal_journal *journal, ucpcal_list *list);
+
+/**
+ * @brief Drops the pending entries and removes the journal file.
+ * Used when the calendar file has just been written in full.
+ * @param journal the journal to discard
+ */
+
+void ucpcal_journal_discard(ucpcal_journal *journal);
+
+/**
+ * @brief Applies the changes in a calendar file's journal to a list.
+ * Replaying stops at the first malformed or incomplete entry, such as one
+ * cut short by a crash, after reporting the problem and where it is on
+ * stderr; the entries before it are kept. A missing journal file is not a
+ * problem, as it just means there have been no changes.
+ * @param list the calendar loaded from the calendar file
+ * @param base the calendar file the journal belongs to
+ */
+
+void ucpcal_journal_replay(ucpcal_list *list, const char *base);
+
+/**
+ * @brief Checks whether a calendar file has changes in its journal that
+ * have not been saved into the file itself.
+ * @param base the calendar file the journal belongs to
+ * @return non-zero if the journal has any entries
+ */
+
+int ucpcal_journal_pending(const char *base);
+
+/**
+ * @brief Reads the record of an add or edit entry and applies it to a list.
+ * @param list the calendar to apply the entry to
+ * @param reader the line reader, just past the first line of the entry
+ * @param old the name of the event to edit, or NULL to add a new event
+ * @param column where to store the column of the problem on failure
+ * @return a description of the problem on failure, or NULL on success
+ */
+
+const char *ucpcal_journal_replay_record(
+	ucpcal_list *list,
+	ucpcal_reader *reader,
+	const char *old,
+	unsigned long *column
+);
+
+/**
+ * @brief Copies a line into a null terminated string on the heap.
+ * @param text the start of the line
+ * @param length the number of bytes in the line
+ * @return the new string, to be freed with free()
+ */
+
+char *ucpcal_journal_string(const char *text, size_t length);
+
+#endif
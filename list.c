@@ -4,39 +4,96 @@
  */
 
 #include "list.h"
+#include "profile.h"
 
-ucpcal_node *ucpcal_node_new(void) {
-	ucpcal_node *node = (ucpcal_node *) malloc(sizeof(ucpcal_node));
+ucpcal_node *ucpcal_node_new(ucpcal_arena *arena) {
+	ucpcal_node *node = (ucpcal_node *) ucpcal_arena_alloc(
+		arena,
+		sizeof(ucpcal_node)
+	);
 	node->event = NULL;
+	node->prev = NULL;
 	node->next = NULL;
+	node->text = NULL;
+	node->text_length = 0;
+	node->text_characters = 0;
 	return node;
 }
 
-void ucpcal_node_free(ucpcal_node *node) {
-	/* Free the event pointed to by the node. */
+void ucpcal_node_free(ucpcal_node *node, ucpcal_arena *arena) {
+	/* Free the event pointed to by the node, and its text. */
 	ucpcal_event_free(node->event);
-	/* Free the actual node. */
-	free(node);
+	ucpcal_node_uncache(node, arena);
+	/* Recycle the actual node. */
+	ucpcal_arena_recycle(arena, node, sizeof(ucpcal_node));
+}
+
+void ucpcal_node_uncache(ucpcal_node *node, ucpcal_arena *arena) {
+	if (node->text) {
+		ucpcal_arena_recycle(arena, node->text, node->text_length + 1);
+		node->text = NULL;
+		node->text_length = 0;
+		node->text_characters = 0;
+	}
 }
 
 ucpcal_list *ucpcal_list_new(void) {
 	ucpcal_list *list = (ucpcal_list *) malloc(sizeof(ucpcal_list));
 	list->head = NULL;
 	list->tail = NULL;
+	list->arena = ucpcal_arena_new();
+	list->maps = NULL;
+	list->names = ucpcal_hash_new();
+	list->times = ucpcal_tree_new();
+	list->trigrams = NULL;
+	list->columns = NULL;
+	list->series = NULL;
 	return list;
 }
 
 void ucpcal_list_free(ucpcal_list *list) {
 	ucpcal_list_empty(list);
-	/* Free the list. */
+	/* Free the arena and indexes, then the list. */
+	ucpcal_arena_free(list->arena);
+	ucpcal_hash_free(list->names);
+	ucpcal_tree_free(list->times);
+	ucpcal_trigram_free(list->trigrams);
+	ucpcal_columns_free(list->columns);
+	ucpcal_series_free(list->series);
 	free(list);
 }
 
-void ucpcal_list_append(ucpcal_list *list, ucpcal_event *event) {
+ucpcal_event *ucpcal_list_append(ucpcal_list *list, ucpcal_event *event) {
 	ucpcal_node *node;
-	if (!ucpcal_list_find(list, event->name)) {
-		node = ucpcal_node_new();
+	ucpcal_event *copy;
+	if (ucpcal_list_find(list, event->name)) {
+		/* The list takes ownership even of a rejected event. */
+		ucpcal_event_free(event);
+		event = NULL;
+	} else {
+		if (event->arena != list->arena) {
+			/* Adopt the event into the list's arena. */
+			copy = ucpcal_event_alloc(list->arena);
+			copy->date = event->date;
+			copy->duration = event->duration;
+			copy->name = ucpcal_arena_string(
+				list->arena,
+				event->name,
+				ucpcal_string_length(event->name)
+			);
+			if (event->location)
+				copy->location = ucpcal_arena_string(
+					list->arena,
+					event->location,
+					ucpcal_string_length(event->location)
+				);
+			copy->rule = ucpcal_rule_copy(list->arena, event->rule);
+			ucpcal_event_free(event);
+			event = copy;
+		}
+		node = ucpcal_node_new(list->arena);
 		node->event = event;
+		node->prev = list->tail;
 		if (list->tail)
 			/* If there's a last element, add the node after it. */
 			list->tail->next = node;
@@ -45,77 +102,437 @@ void ucpcal_list_append(ucpcal_list *list, ucpcal_event *event) {
 			list->head = node;
 		/* Regardless, appended node is the new tail. */
 		list->tail = node;
+		ucpcal_hash_insert(list->names, node);
+		ucpcal_tree_insert(list->times, node);
+		if (list->trigrams)
+			ucpcal_trigram_insert(list->trigrams, node);
+		if (list->columns)
+			ucpcal_columns_insert(list->columns, node);
+		if (list->series && event->rule)
+			ucpcal_series_add(list->series, node);
 	}
+	return event;
 }
 
 void ucpcal_list_delete(ucpcal_list *list, const char *name) {
-	ucpcal_node *cur = list->head, *prev = NULL;
-	int done = 0;
-	while (cur && !done) {
-		if (!strcmp(cur->event->name, name)) {
-			if (prev)
-				/* The node to be deleted is not the first. */
-				prev->next = cur->next;
-			else
-				/* The node to be deleted is the first. */
-				list->head = cur->next;
-			if (cur == list->tail)
-				/* The node to be deleted is the last. */
-				list->tail = prev;
-			ucpcal_node_free(cur);
-			done = 1;
-		}
-		if (!done) {
-			prev = cur;
-			cur = cur->next;
-		}
+	ucpcal_node *node = ucpcal_hash_find(list->names, name);
+	if (node) {
+		if (node->prev)
+			/* The node to be deleted is not the first. */
+			node->prev->next = node->next;
+		else
+			/* The node to be deleted is the first. */
+			list->head = node->next;
+		if (node->next)
+			/* The node to be deleted is not the last. */
+			node->next->prev = node->prev;
+		else
+			/* The node to be deleted is the last. */
+			list->tail = node->prev;
+		/* Unindex the node while its event still has a name. */
+		ucpcal_hash_remove(list->names, node);
+		ucpcal_tree_remove(list->times, node);
+		if (list->trigrams)
+			ucpcal_trigram_remove(list->trigrams, node);
+		if (list->columns)
+			ucpcal_columns_remove(list->columns, node);
+		if (list->series && node->event->rule)
+			ucpcal_series_remove(list->series, node);
+		ucpcal_node_free(node, list->arena);
 	}
 }
 
+void ucpcal_list_edit(
+	ucpcal_list *list,
+	ucpcal_event *event,
+	const ucpcal_event *changes
+) {
+	ucpcal_node *node = ucpcal_hash_find_event(list->names, event);
+	char *name, *location = NULL;
+	ucpcal_rule *rule;
+	/* The name and date may change, so unindex the node first. */
+	if (node) {
+		ucpcal_node_uncache(node, list->arena);
+		ucpcal_hash_remove(list->names, node);
+		ucpcal_tree_remove(list->times, node);
+		if (list->trigrams)
+			ucpcal_trigram_remove(list->trigrams, node);
+		if (list->columns)
+			ucpcal_columns_remove(list->columns, node);
+		if (list->series && event->rule)
+			ucpcal_series_remove(list->series, node);
+	}
+	/*
+		Copy the new strings before recycling the old ones, in case the
+		changes were made from a copy of the event itself.
+	*/
+	name = ucpcal_arena_string(
+		list->arena,
+		changes->name,
+		ucpcal_string_length(changes->name)
+	);
+	if (changes->location)
+		location = ucpcal_arena_string(
+			list->arena,
+			changes->location,
+			ucpcal_string_length(changes->location)
+		);
+	rule = ucpcal_rule_copy(list->arena, changes->rule);
+	if (!event->borrowed) {
+		ucpcal_arena_recycle(
+			list->arena,
+			event->name,
+			strlen(event->name) + 1
+		);
+		if (event->location)
+			ucpcal_arena_recycle(
+				list->arena,
+				event->location,
+				strlen(event->location) + 1
+			);
+	}
+	event->date = changes->date;
+	event->duration = changes->duration;
+	event->name = name;
+	event->location = location;
+	ucpcal_rule_free(event->rule);
+	event->rule = rule;
+	event->borrowed = 0;
+	if (node) {
+		ucpcal_hash_insert(list->names, node);
+		ucpcal_tree_insert(list->times, node);
+		if (list->trigrams)
+			ucpcal_trigram_insert(list->trigrams, node);
+		if (list->columns)
+			ucpcal_columns_insert(list->columns, node);
+		if (list->series && event->rule)
+			ucpcal_series_add(list->series, node);
+	}
+}
+
+ucpcal_event **ucpcal_list_search(
+	ucpcal_list *list,
+	const char *text,
+	size_t *count
+) {
+	ucpcal_node **nodes, *cur;
+	ucpcal_event **result;
+	size_t i;
+	if (!list->trigrams) {
+		list->trigrams = ucpcal_trigram_new();
+		for (cur = list->head; cur; cur = cur->next)
+			ucpcal_trigram_insert(list->trigrams, cur);
+	}
+	nodes = ucpcal_trigram_search(list->trigrams, text, count);
+	result = (ucpcal_event **) malloc(
+		(*count ? *count : 1) * sizeof(ucpcal_event *)
+	);
+	for (i = 0; i < *count; i++)
+		result[i] = nodes[i]->event;
+	free(nodes);
+	return result;
+}
+
 ucpcal_event *ucpcal_list_find(ucpcal_list *list, const char *name) {
-	ucpcal_node *cur = list->head;
+	ucpcal_node *node;
+	UCPCAL_PROFILE_COUNT(UCPCAL_PROFILE_FINDS, 1);
+	node = ucpcal_hash_find(list->names, name);
+	return node ? node->event : NULL;
+}
+
+ucpcal_range ucpcal_list_range(
+	ucpcal_list *list,
+	ucpcal_date from,
+	ucpcal_date to
+) {
+	ucpcal_range range;
+	range.next = ucpcal_tree_lower_bound(
+		list->times,
+		ucpcal_time_from_date(from)
+	);
+	range.to = ucpcal_time_from_date(to);
+	return range;
+}
+
+ucpcal_event *ucpcal_range_next(ucpcal_range *range) {
+	ucpcal_event *result = NULL;
+	if (range->next && range->next->when.start < range->to) {
+		result = range->next->event;
+		range->next = ucpcal_tree_next(range->next);
+	} else {
+		/* Stay finished even if called again. */
+		range->next = NULL;
+	}
+	return result;
+}
+
+ucpcal_overlaps ucpcal_list_overlaps(
+	ucpcal_list *list,
+	const ucpcal_event *event
+) {
+	ucpcal_overlaps overlaps;
+	overlaps.event = event;
+	overlaps.start = ucpcal_time_from_date(event->date);
+	overlaps.end = ucpcal_time_end(overlaps.start, event->duration);
+	overlaps.next = NULL;
+	/* An event with no duration overlaps nothing. */
+	if (overlaps.end > overlaps.start)
+		overlaps.next = ucpcal_tree_overlap_first(
+			list->times->root,
+			overlaps.start,
+			overlaps.end
+		);
+	/* The event never overlaps itself. */
+	if (overlaps.next && overlaps.next->event == event)
+		overlaps.next = ucpcal_tree_overlap_next(
+			overlaps.next,
+			overlaps.start,
+			overlaps.end
+		);
+	return overlaps;
+}
+
+ucpcal_event *ucpcal_overlaps_next(ucpcal_overlaps *overlaps) {
 	ucpcal_event *result = NULL;
+	if (overlaps->next) {
+		result = overlaps->next->event;
+		overlaps->next = ucpcal_tree_overlap_next(
+			overlaps->next,
+			overlaps->start,
+			overlaps->end
+		);
+		if (overlaps->next && overlaps->next->event == overlaps->event)
+			overlaps->next = ucpcal_tree_overlap_next(
+				overlaps->next,
+				overlaps->start,
+				overlaps->end
+			);
+	}
+	return result;
+}
+
+ucpcal_columns *ucpcal_list_columns(ucpcal_list *list) {
+	ucpcal_node *cur;
+	if (!list->columns) {
+		list->columns = ucpcal_columns_new();
+		/* In the index's order, each node is simply appended. */
+		for (
+			cur = ucpcal_tree_first(list->times);
+			cur;
+			cur = ucpcal_tree_next(cur)
+		)
+			ucpcal_columns_insert(list->columns, cur);
+	}
+	ucpcal_columns_tidy(list->columns);
+	return list->columns;
+}
+
+unsigned long ucpcal_list_total(
+	ucpcal_list *list,
+	ucpcal_date from,
+	ucpcal_date to
+) {
+	ucpcal_columns *columns = ucpcal_list_columns(list);
+	size_t first = ucpcal_columns_lower_bound(
+		columns,
+		ucpcal_time_from_date(from)
+	);
+	size_t last = ucpcal_columns_lower_bound(
+		columns,
+		ucpcal_time_from_date(to)
+	);
+	return first < last ? ucpcal_columns_total(columns, first, last) : 0;
+}
+
+ucpcal_conflict *ucpcal_list_conflicts(ucpcal_list *list, size_t *count) {
+	ucpcal_columns *columns = ucpcal_list_columns(list);
+	unsigned int *pairs = ucpcal_columns_conflicts(columns, count);
+	ucpcal_conflict *result = (ucpcal_conflict *) malloc(
+		(*count ? *count : 1) * sizeof(ucpcal_conflict)
+	);
+	size_t i;
+	for (i = 0; i < *count; i++) {
+		result[i].first = columns->nodes[pairs[i * 2]]->event;
+		result[i].second = columns->nodes[pairs[i * 2 + 1]]->event;
+	}
+	free(pairs);
+	return result;
+}
+
+ucpcal_series *ucpcal_list_series(ucpcal_list *list) {
+	ucpcal_node *cur;
+	if (!list->series) {
+		list->series = ucpcal_series_new();
+		for (cur = list->head; cur; cur = cur->next)
+			if (cur->event->rule)
+				ucpcal_series_add(list->series, cur);
+	}
+	return list->series;
+}
+
+ucpcal_window ucpcal_list_window(
+	ucpcal_list *list,
+	ucpcal_date from,
+	ucpcal_date to
+) {
+	ucpcal_series *series = ucpcal_list_series(list);
+	ucpcal_window window;
+	ucpcal_time start = ucpcal_time_from_date(from);
+	size_t i;
+	window.to = ucpcal_time_from_date(to);
+	window.next = ucpcal_window_skip(
+		&window,
+		ucpcal_tree_lower_bound(list->times, start)
+	);
+	window.series = (ucpcal_occurrences *) malloc(
+		(series->count ? series->count : 1) *
+		sizeof(ucpcal_occurrences)
+	);
+	window.count = 0;
+	window.node = NULL;
+	/* Recurring events with nothing in the range are left out. */
+	for (i = 0; i < series->count; i++) {
+		window.series[window.count] = ucpcal_event_occurrences(
+			series->nodes[i]->event,
+			start,
+			window.to
+		);
+		if (!window.series[window.count].done)
+			window.count++;
+	}
+	for (i = window.count / 2; i > 0; i--)
+		ucpcal_window_sift(&window, i - 1);
+	return window;
+}
+
+const ucpcal_event *ucpcal_window_next(ucpcal_window *window) {
+	const ucpcal_event *result = NULL;
+	ucpcal_occurrences *top = window->count ? &window->series[0] : NULL;
+	window->node = NULL;
+	if (window->next && (!top || window->next->when.start <= top->start)) {
+		window->node = window->next;
+		result = window->next->event;
+		window->next = ucpcal_window_skip(
+			window,
+			ucpcal_tree_next(window->next)
+		);
+	} else if (top) {
+		/* The iterator may move in the heap, so copy the occurrence. */
+		window->occurrence = *ucpcal_occurrences_next(top);
+		result = &window->occurrence;
+		if (top->done)
+			window->series[0] = window->series[--window->count];
+		ucpcal_window_sift(window, 0);
+	}
+	return result;
+}
+
+void ucpcal_window_free(ucpcal_window *window) {
+	free(window->series);
+	window->series = NULL;
+	window->count = 0;
+	window->next = NULL;
+}
+
+ucpcal_node *ucpcal_window_skip(ucpcal_window *window, ucpcal_node *node) {
+	while (node && node->event->rule && node->when.start < window->to)
+		node = ucpcal_tree_next(node);
+	return node && node->when.start < window->to ? node : NULL;
+}
+
+void ucpcal_window_sift(ucpcal_window *window, size_t i) {
+	ucpcal_occurrences swap;
+	size_t child;
 	int done = 0;
-	while (cur && !done) {
-		if (!strcmp(cur->event->name, name)) {
-			result = cur->event;
+	while (!done && (child = i * 2 + 1) < window->count) {
+		if (
+			child + 1 < window->count &&
+			ucpcal_window_before(
+				&window->series[child + 1],
+				&window->series[child]
+			)
+		)
+			child++;
+		if (
+			ucpcal_window_before(
+				&window->series[child],
+				&window->series[i]
+			)
+		) {
+			swap = window->series[i];
+			window->series[i] = window->series[child];
+			window->series[child] = swap;
+			i = child;
+		} else {
 			done = 1;
 		}
-		cur = cur->next;
 	}
-	return result;
+}
+
+int ucpcal_window_before(
+	const ucpcal_occurrences *a,
+	const ucpcal_occurrences *b
+) {
+	/* Names are unique, so no two occurrences are ever tied. */
+	return a->start < b->start || (
+		a->start == b->start &&
+		ucpcal_string_compare(a->event->name, b->event->name) < 0
+	);
 }
 
 void ucpcal_list_empty(ucpcal_list *list) {
-	ucpcal_node *cur = NULL, *next;
-	if (list)
-		cur = list->head;
-	while (cur) {
-		/* Free each node. */
-		next = cur->next;
-		ucpcal_node_free(cur);
-		cur = next;
-	}
-	/* Tie up loose ends. */
 	if (list) {
+		/*
+			Every node, event and string belongs to the arena, so
+			they can all be released at once without walking the
+			list, and the indexes simply forget about them.
+		*/
+		ucpcal_arena_empty(list->arena);
+		ucpcal_map_free(list->maps);
+		list->maps = NULL;
 		list->head = NULL;
 		list->tail = NULL;
+		ucpcal_hash_empty(list->names);
+		ucpcal_tree_empty(list->times);
+		/*
+			Rebuilding the trigram index, the columnar store and
+			the set of recurring nodes costs no more than keeping
+			them.
+		*/
+		ucpcal_trigram_free(list->trigrams);
+		list->trigrams = NULL;
+		ucpcal_columns_free(list->columns);
+		list->columns = NULL;
+		ucpcal_series_free(list->series);
+		list->series = NULL;
 	}
 }
 
+void ucpcal_list_swap(ucpcal_list *a, ucpcal_list *b) {
+	/* Nothing points back at a list, only at what it owns. */
+	ucpcal_list temp = *a;
+	*a = *b;
+	*b = temp;
+}
+
 void ucpcal_list_print_debug(ucpcal_list *list) {
 	ucpcal_node *cur = list->head;
 	while (cur) {
 		printf(
-			"%04d-%02d-%02dT%02d:%02d|%d|%s|%s\n",
+			"%04d-%02d-%02dT%02d:%02d|%d|%.*s|%.*s\n",
 			cur->event->date.year,
 			cur->event->date.month,
 			cur->event->date.day,
 			cur->event->date.hour,
 			cur->event->date.minute,
 			cur->event->duration,
+			(int) ucpcal_string_length(cur->event->name),
 			cur->event->name,
-			cur->event->location
+			cur->event->location ?
+				(int) ucpcal_string_length(
+					cur->event->location
+				) : 0,
+			cur->event->location ? cur->event->location : ""
 		);
 		cur = cur->next;
 	}
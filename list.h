@@ -10,6 +10,12 @@
 #include <stdlib.h>
 #include <string.h>
 #include "event.h"
+#include "hash.h"
+#include "tree.h"
+#include "map.h"
+#include "trigram.h"
+#include "columns.h"
+#include "recur.h"
 
 /**
  * @brief A data structure representing a linked list node for an event.
@@ -17,7 +23,36 @@
 
 typedef struct ucpcal_node {
 	ucpcal_event *event;
+	/**
+	 * The previous node, so that a node found through the name index can
+	 * be unlinked without walking the list.
+	 */
+	struct ucpcal_node *prev;
 	struct ucpcal_node *next;
+	/**
+	 * The node's links in the list's index of start times.
+	 */
+	ucpcal_tree_link when;
+	/**
+	 * The node's id in the list's trigram index, if the list has one.
+	 */
+	unsigned int trigram_id;
+	/**
+	 * The node's handle in the list's columnar store, if the list has one.
+	 */
+	unsigned int column;
+	/**
+	 * The event's text as rendered for the calendar view, allocated from
+	 * the list's arena, or NULL until the event is next rendered. It is
+	 * forgotten whenever the event changes.
+	 */
+	char *text;
+	/**
+	 * The length of the rendered text in bytes, excluding the null
+	 * terminator, and in characters, if there is any.
+	 */
+	size_t text_length;
+	unsigned long text_characters;
 } ucpcal_node;
 
 /**
@@ -27,23 +62,171 @@ typedef struct ucpcal_node {
 typedef struct ucpcal_list {
 	ucpcal_node *head;
 	ucpcal_node *tail;
+	/**
+	 * The arena owning every node and event in the list, along with
+	 * their strings, so that the list can be emptied all at once.
+	 */
+	ucpcal_arena *arena;
+	/**
+	 * The memory mapped files that events in the list borrow their
+	 * strings from, released when the list is emptied.
+	 */
+	ucpcal_map *maps;
+	/**
+	 * An index of the list's nodes keyed on event name, which must be
+	 * kept in sync whenever a node is added, removed or renamed.
+	 */
+	ucpcal_hash *names;
+	/**
+	 * An index of the list's nodes ordered by start time, which must be
+	 * kept in sync whenever a node is added, removed or rescheduled.
+	 */
+	ucpcal_tree *times;
+	/**
+	 * An index of the list's nodes on the trigrams of their events' names
+	 * and locations, or NULL until the list is first searched. Once built,
+	 * it must be kept in sync whenever a node is added, removed or
+	 * renamed.
+	 */
+	ucpcal_trigram *trigrams;
+	/**
+	 * A copy of the list's events' fields in dense arrays, in order of
+	 * start time, or NULL until a scan over the list first needs it. Once
+	 * built, it must be kept in sync whenever a node is added, removed or
+	 * changed.
+	 */
+	ucpcal_columns *columns;
+	/**
+	 * The set of the list's nodes whose events recur, or NULL until the
+	 * list is first viewed through a window. Once built, it must be kept
+	 * in sync whenever a node is added, removed or given a new rule.
+	 */
+	ucpcal_series *series;
 } ucpcal_list;
 
 /**
- * @brief Creates a new linked list node on the heap.
- * Be sure to use ucpcal_node_free() when finished.
+ * @brief A data structure for iterating over events in a range of times.
+ * Obtained from ucpcal_list_range() and advanced with ucpcal_range_next().
+ * Adding, editing or deleting events in the list invalidates the iterator.
+ */
+
+typedef struct ucpcal_range {
+	/**
+	 * The node to be returned next, or NULL when finished.
+	 */
+	ucpcal_node *next;
+	/**
+	 * The end of the range, in minutes since the Unix epoch.
+	 */
+	ucpcal_time to;
+} ucpcal_range;
+
+/**
+ * @brief A data structure for iterating over events overlapping another.
+ * Obtained from ucpcal_list_overlaps() and advanced with
+ * ucpcal_overlaps_next(). Adding, editing or deleting events in the list
+ * invalidates the iterator.
+ */
+
+typedef struct ucpcal_overlaps {
+	/**
+	 * The node to be returned next, or NULL when finished.
+	 */
+	ucpcal_node *next;
+	/**
+	 * The event being overlapped, which is never produced itself.
+	 */
+	const ucpcal_event *event;
+	/**
+	 * The start of the event being overlapped, in minutes since the Unix
+	 * epoch.
+	 */
+	ucpcal_time start;
+	/**
+	 * The end of the event being overlapped, in minutes since the Unix
+	 * epoch.
+	 */
+	ucpcal_time end;
+} ucpcal_overlaps;
+
+/**
+ * @brief A data structure for iterating over every occurrence of the events
+ * in a range of times, in order of start time.
+ * Obtained from ucpcal_list_window() and advanced with ucpcal_window_next().
+ * Events that do not recur come from the list's index of start times, and
+ * the occurrences of those that do from an iterator over each, kept in a
+ * binary min-heap on their next start times. At the same time, events that
+ * do not recur come first, then occurrences in order of name. Adding,
+ * editing or deleting events in the list invalidates the iterator, which
+ * must be finished with ucpcal_window_free().
+ */
+
+typedef struct ucpcal_window {
+	/**
+	 * The next node in the range whose event does not recur, or NULL.
+	 */
+	ucpcal_node *next;
+	/**
+	 * The end of the range, in minutes since the Unix epoch.
+	 */
+	ucpcal_time to;
+	/**
+	 * The iterators of the recurring events with occurrences still to
+	 * come, as a binary min-heap.
+	 */
+	ucpcal_occurrences *series;
+	size_t count;
+	/**
+	 * The node of the event produced last, or NULL if it was an
+	 * occurrence of a recurring event.
+	 */
+	ucpcal_node *node;
+	/**
+	 * A copy of the occurrence produced last, if any.
+	 */
+	ucpcal_event occurrence;
+} ucpcal_window;
+
+/**
+ * @brief A data structure representing a pair of overlapping events.
+ */
+
+typedef struct ucpcal_conflict {
+	/**
+	 * The event that starts first, or was added first if both events
+	 * start at the same time.
+	 */
+	ucpcal_event *first;
+	ucpcal_event *second;
+} ucpcal_conflict;
+
+/**
+ * @brief Creates a new linked list node in an arena.
+ * Be sure to use ucpcal_node_free() when finished, unless the whole arena
+ * is about to be emptied.
+ * @param arena the arena to allocate from
  * @return pointer to new ucpcal_node struct
  */
 
-ucpcal_node *ucpcal_node_new(void);
+ucpcal_node *ucpcal_node_new(ucpcal_arena *arena);
 
 /**
- * @brief Frees the memory used for a linked list node struct.
- * Also frees the event pointed to by the node.
+ * @brief Recycles the memory used for a linked list node struct.
+ * Also frees the event pointed to by the node, and its rendered text.
  * @param node the node to be freed
+ * @param arena the arena the node was allocated from
  */
 
-void ucpcal_node_free(ucpcal_node *node);
+void ucpcal_node_free(ucpcal_node *node, ucpcal_arena *arena);
+
+/**
+ * @brief Forgets the rendered text of a node's event, if there is any, so
+ * that the event is rendered afresh next time.
+ * @param node the node whose event has changed
+ * @param arena the arena the text was allocated from
+ */
+
+void ucpcal_node_uncache(ucpcal_node *node, ucpcal_arena *arena);
 
 /**
  * @brief Creates a new linked list on the heap.
@@ -64,13 +247,16 @@ void ucpcal_list_free(ucpcal_list *list);
 /**
  * @brief Appends an event to a linked list.
  * A new linked list node is automatically created to wrap the event. The
- * linked list is walked to guarantee that there can only be one event in a
- * list with a particular name.
+ * name index is checked to guarantee that there can only be one event in a
+ * list with a particular name. The list takes ownership of the event: one
+ * that was not allocated from the list's arena is copied into it and freed,
+ * as is one that is rejected because its name is already taken.
  * @param list the linked list to append to
  * @param event the event to append
+ * @return the event as stored in the list, or NULL if it was rejected
  */
 
-void ucpcal_list_append(ucpcal_list *list, ucpcal_event *event);
+ucpcal_event *ucpcal_list_append(ucpcal_list *list, ucpcal_event *event);
 
 /**
  * @brief Deletes an event by name from a linked list.
@@ -80,23 +266,237 @@ void ucpcal_list_append(ucpcal_list *list, ucpcal_event *event);
 
 void ucpcal_list_delete(ucpcal_list *list, const char *name);
 
+/**
+ * @brief Replaces the data of an event in a linked list.
+ * The date, duration, name, location and rule of changes are copied into the
+ * event, recycling its old strings and rule and keeping the list's indexes in
+ * sync.
+ * The strings of changes are copied into the list's arena, so they remain
+ * owned by the caller, and the event no longer borrows its strings. The
+ * event's rendered text is forgotten.
+ * @param list the linked list containing the event
+ * @param event the event to edit
+ * @param changes the new data for the event
+ */
+
+void ucpcal_list_edit(
+	ucpcal_list *list,
+	ucpcal_event *event,
+	const ucpcal_event *changes
+);
+
+/**
+ * @brief Finds the events in a linked list whose name or location contains
+ * some text, ignoring the case of ASCII letters.
+ * The list's trigram index is built the first time it is searched, after
+ * which each search only checks the events sharing every trigram of the
+ * text.
+ * @param list the linked list to search through
+ * @param text the text to look for
+ * @param count where to store the number of events found
+ * @return a heap allocated array of the events found, in the order they were
+ * added or last edited, which must be freed by the caller
+ */
+
+ucpcal_event **ucpcal_list_search(
+	ucpcal_list *list,
+	const char *text,
+	size_t *count
+);
+
 /**
  * @brief Finds an event by name in a linked list.
  * @param list the linked list to search through
- * @param name the name of events that should be deleted
+ * @param name the name of the event to look for
  * @return the matching event, or NULL if there is no such event
  */
 
 ucpcal_event *ucpcal_list_find(ucpcal_list *list, const char *name);
 
+/**
+ * @brief Starts iterating over the events starting in a range of times.
+ * Events are produced in order of start time, and events with the same start
+ * time are produced in the order they were added. Finding the first event
+ * takes O(log n) time, and each subsequent event O(1) amortised time.
+ * @param list the linked list to iterate over
+ * @param from the start of the range, inclusive
+ * @param to the end of the range, exclusive
+ * @return an iterator to be passed to ucpcal_range_next()
+ */
+
+ucpcal_range ucpcal_list_range(
+	ucpcal_list *list,
+	ucpcal_date from,
+	ucpcal_date to
+);
+
+/**
+ * @brief Advances an iterator over a range of times.
+ * @param range the iterator obtained from ucpcal_list_range()
+ * @return the next event in the range, or NULL when there are no more
+ */
+
+ucpcal_event *ucpcal_range_next(ucpcal_range *range);
+
+/**
+ * @brief Starts iterating over the events overlapping a given event.
+ * An event occupies the half open interval from its start time to its start
+ * time plus its duration, so events that merely touch do not overlap, and
+ * events with no duration overlap nothing. The given event need not be in
+ * the list. Events are produced in order of start time, each in O(log n)
+ * time or better.
+ * @param list the linked list to search through
+ * @param event the event to check for overlaps with
+ * @return an iterator to be passed to ucpcal_overlaps_next()
+ */
+
+ucpcal_overlaps ucpcal_list_overlaps(
+	ucpcal_list *list,
+	const ucpcal_event *event
+);
+
+/**
+ * @brief Advances an iterator over overlapping events.
+ * @param overlaps the iterator obtained from ucpcal_list_overlaps()
+ * @return the next overlapping event, or NULL when there are no more
+ */
+
+ucpcal_event *ucpcal_overlaps_next(ucpcal_overlaps *overlaps);
+
+/**
+ * @brief Finds the columnar store of a linked list, ready to be scanned.
+ * The store is built from the list's index of start times the first time
+ * it is needed, in O(n) time, and tidied if the list has changed since.
+ * @param list the linked list
+ * @return the list's columnar store, which the list continues to own
+ */
+
+ucpcal_columns *ucpcal_list_columns(ucpcal_list *list);
+
+/**
+ * @brief Adds up the durations of the events starting in a range of times.
+ * The durations are read from the list's columnar store, one after another.
+ * @param list the linked list
+ * @param from the start of the range, inclusive
+ * @param to the end of the range, exclusive
+ * @return the total duration, in minutes
+ */
+
+unsigned long ucpcal_list_total(
+	ucpcal_list *list,
+	ucpcal_date from,
+	ucpcal_date to
+);
+
+/**
+ * @brief Finds every pair of overlapping events in a linked list.
+ * Runs in O(n log n + k) time for k pairs, over the list's columnar store.
+ * Be sure to use free() on the result when finished.
+ * @param list the linked list to search through
+ * @param count where to store the number of pairs found
+ * @return a heap allocated array of overlapping pairs, in order of the
+ * start time of the second event of each pair
+ */
+
+ucpcal_conflict *ucpcal_list_conflicts(ucpcal_list *list, size_t *count);
+
+/**
+ * @brief Finds the nodes of a linked list whose events recur.
+ * The set is built the first time it is needed, after which it is kept in
+ * sync as the list changes.
+ * @param list the linked list
+ * @return the set of recurring nodes, owned by the list
+ */
+
+ucpcal_series *ucpcal_list_series(ucpcal_list *list);
+
+/**
+ * @brief Starts iterating over every occurrence of the events in a linked
+ * list that start in a range of times.
+ * Only the events that do not recur and start in the range are visited,
+ * along with every recurring event, so this takes O(r log r + log n) time to
+ * start and O(log r) time per occurrence, for r recurring events of n.
+ * Be sure to use ucpcal_window_free() when finished.
+ * @param list the linked list
+ * @param from the start of the range, inclusive
+ * @param to the end of the range, exclusive
+ * @return the iterator
+ */
+
+ucpcal_window ucpcal_list_window(
+	ucpcal_list *list,
+	ucpcal_date from,
+	ucpcal_date to
+);
+
+/**
+ * @brief Produces the next occurrence of an event in a window.
+ * @param window the iterator
+ * @return the event, or a copy of it with the date of the occurrence, valid
+ * until the next call, or NULL when there are no more in the range
+ */
+
+const ucpcal_event *ucpcal_window_next(ucpcal_window *window);
+
+/**
+ * @brief Frees the memory used by a window, which may not have finished.
+ * @param window the iterator
+ */
+
+void ucpcal_window_free(ucpcal_window *window);
+
+/**
+ * @brief Finds the first node, from a node onwards in order of start time,
+ * whose event does not recur and starts before the end of a window.
+ * @param window the iterator
+ * @param node the node to start from, or NULL
+ * @return the node found, or NULL if there is none
+ */
+
+ucpcal_node *ucpcal_window_skip(ucpcal_window *window, ucpcal_node *node);
+
+/**
+ * @brief Sifts the iterator at a position in a window's heap down to its
+ * place.
+ * @param window the iterator
+ * @param i the position in the heap
+ */
+
+void ucpcal_window_sift(ucpcal_window *window, size_t i);
+
+/**
+ * @brief Checks whether one recurring event's next occurrence comes before
+ * another's in a window.
+ * @param a the iterator over the first event
+ * @param b the iterator over the second event
+ * @return non-zero if the first event's occurrence comes first
+ */
+
+int ucpcal_window_before(
+	const ucpcal_occurrences *a,
+	const ucpcal_occurrences *b
+);
+
 /**
  * @brief Empties a linked list.
- * All nodes and their events are removed and freed.
+ * All nodes and their events are removed and freed, by emptying the list's
+ * arena rather than freeing them one by one. Any memory mapped files are
+ * unmapped.
  * @param list the linked list to empty
  */
 
 void ucpcal_list_empty(ucpcal_list *list);
 
+/**
+ * @brief Exchanges the contents of two linked lists.
+ * Only the lists' pointers change hands, so this takes constant time
+ * however many events either list holds.
+ * @param a the first linked list
+ * @param b the second linked list
+ */
+
+void ucpcal_list_swap(ucpcal_list *a, ucpcal_list *b);
+
 /**
  * @brief Prints out an event list, for debugging purposes.
  * @param list the linked list to use
@@ -0,0 +1,94 @@
+/**
+ * @file loader.c
+ * @brief Data structures and algorithms for loading calendars in the
+ * background.
+ */
+
+#include "loader.h"
+
+ucpcal_loader *ucpcal_loader_start(const char *filename, int mode) {
+	ucpcal_loader *loader = (ucpcal_loader *) malloc(
+		sizeof(ucpcal_loader)
+	);
+	loader->filename = (char *) malloc(strlen(filename) + 1);
+	strcpy(loader->filename, filename);
+	loader->mode = mode;
+	loader->list = ucpcal_list_new();
+	ucpcal_progress_init(&loader->progress);
+	loader->finished = 0;
+	loader->result = 0;
+	loader->started = !pthread_create(
+		&loader->thread,
+		NULL,
+		ucpcal_loader_run,
+		loader
+	);
+	if (!loader->started)
+		ucpcal_loader_run(loader);
+	return loader;
+}
+
+void *ucpcal_loader_run(void *data) {
+	ucpcal_loader *loader = (ucpcal_loader *) data;
+	int result = 0;
+	if (ucpcal_binary_detect(loader->filename) < 0) {
+		result = UCPCAL_LOADER_FAILED;
+	} else {
+		if (ucpcal_load_mode(
+			loader->list,
+			loader->filename,
+			loader->mode,
+			&loader->progress
+		))
+			result = UCPCAL_LOADER_PARTIAL;
+		/* A cancelled load is thrown away, so skip the journal. */
+		if (!ucpcal_progress_cancelled(&loader->progress))
+			ucpcal_journal_replay(loader->list, loader->filename);
+	}
+	pthread_mutex_lock(&loader->progress.lock);
+	loader->result = result;
+	loader->finished = 1;
+	pthread_mutex_unlock(&loader->progress.lock);
+	return NULL;
+}
+
+int ucpcal_loader_finished(ucpcal_loader *loader) {
+	int result;
+	pthread_mutex_lock(&loader->progress.lock);
+	result = loader->finished;
+	pthread_mutex_unlock(&loader->progress.lock);
+	return result;
+}
+
+int ucpcal_loader_percent(ucpcal_loader *loader) {
+	return ucpcal_progress_percent(&loader->progress);
+}
+
+void ucpcal_loader_cancel(ucpcal_loader *loader) {
+	ucpcal_progress_cancel(&loader->progress);
+}
+
+int ucpcal_loader_finish(ucpcal_loader *loader, ucpcal_list **list) {
+	int result;
+	if (loader->started)
+		pthread_join(loader->thread, NULL);
+	result = loader->result;
+	if (
+		result != UCPCAL_LOADER_FAILED &&
+		ucpcal_progress_cancelled(&loader->progress)
+	)
+		result = UCPCAL_LOADER_CANCELLED;
+	if (
+		result == UCPCAL_LOADER_FAILED ||
+		result == UCPCAL_LOADER_CANCELLED
+	) {
+		ucpcal_list_free(loader->list);
+		*list = NULL;
+	} else {
+		*list = loader->list;
+	}
+	ucpcal_progress_destroy(&loader->progress);
+	free(loader->filename);
+	free(loader);
+	return result;
+}
@@ -0,0 +1,125 @@
+/**
+ * @file loader.h
+ * @brief Data structures and algorithms for loading calendars in the
+ * background.
+ */
+
+#ifndef UCPCAL_LOADER_H
+#define UCPCAL_LOADER_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "list.h"
+#include "file.h"
+#include "binary.h"
+#include "journal.h"
+
+/**
+ * @brief The result of a load whose file could not be opened.
+ */
+
+#define UCPCAL_LOADER_FAILED 1
+
+/**
+ * @brief The result of a load that was cancelled before it finished.
+ */
+
+#define UCPCAL_LOADER_CANCELLED 2
+
+/**
+ * @brief The result of a load that skipped malformed records, or rejected
+ * a binary file, but still has a list to show.
+ */
+
+#define UCPCAL_LOADER_PARTIAL 3
+
+/**
+ * @brief A data structure representing a calendar file being loaded by a
+ * thread of its own.
+ * The file is loaded into a new list, with its journal replayed, so that
+ * the calendar shown can be used until the new one is ready to replace it.
+ */
+
+typedef struct ucpcal_loader {
+	pthread_t thread;
+	/**
+	 * Non-zero if the thread was started, rather than the file being
+	 * loaded by the calling thread.
+	 */
+	int started;
+	char *filename;
+	int mode;
+	/**
+	 * The new list, which only the loading thread may touch until the
+	 * load has finished.
+	 */
+	ucpcal_list *list;
+	ucpcal_progress progress;
+	/**
+	 * Non-zero once the load has finished, guarded by the progress lock.
+	 */
+	int finished;
+	/**
+	 * 0 if the file was loaded, UCPCAL_LOADER_FAILED or
+	 * UCPCAL_LOADER_PARTIAL.
+	 */
+	int result;
+} ucpcal_loader;
+
+/**
+ * @brief Starts loading a calendar file in the background.
+ * If a thread cannot be started, the file is loaded before returning.
+ * @param filename the calendar file to load
+ * @param mode how the file should be loaded, as passed to ucpcal_load_mode()
+ * @return a pointer to a new heap allocated ucpcal_loader, to be passed to
+ * ucpcal_loader_finish() once it has finished
+ */
+
+ucpcal_loader *ucpcal_loader_start(const char *filename, int mode);
+
+/**
+ * @brief Loads the file of a ucpcal_loader, as its thread.
+ * @param loader the ucpcal_loader
+ * @return NULL
+ */
+
+void *ucpcal_loader_run(void *loader);
+
+/**
+ * @brief Checks whether a load has finished, without waiting for it.
+ * @param loader the ucpcal_loader
+ * @return non-zero if the load has finished
+ */
+
+int ucpcal_loader_finished(ucpcal_loader *loader);
+
+/**
+ * @brief Finds how far a load has got.
+ * @param loader the ucpcal_loader
+ * @return the percentage of the file loaded so far
+ */
+
+int ucpcal_loader_percent(ucpcal_loader *loader);
+
+/**
+ * @brief Asks a load to stop early, in which case nothing is loaded.
+ * @param loader the ucpcal_loader
+ */
+
+void ucpcal_loader_cancel(ucpcal_loader *loader);
+
+/**
+ * @brief Waits for a load to finish and frees the ucpcal_loader.
+ * @param loader the ucpcal_loader
+ * @param list where to store the new list if the file was loaded, even in
+ * part, which must be freed by the caller; otherwise the new list is freed
+ * @return 0 if the file was loaded, UCPCAL_LOADER_FAILED if it could not be
+ * opened, UCPCAL_LOADER_CANCELLED if the load was cancelled, or
+ * UCPCAL_LOADER_PARTIAL if only part of it could be loaded
+ */
+
+int ucpcal_loader_finish(ucpcal_loader *loader, ucpcal_list **list);
+
+#endif
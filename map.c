@@ -0,0 +1,55 @@
+/**
+ * @file map.c
+ * @brief Data structures and algorithms for memory mapped files.
+ */
+
+#include "map.h"
+#include "profile.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+ucpcal_map *ucpcal_map_view(const char *filename) {
+	ucpcal_map *map = NULL;
+	struct stat info;
+	void *data = NULL;
+	int fd = open(filename, O_RDONLY);
+	if (fd != -1 && !fstat(fd, &info)) {
+		/* mmap() refuses to map nothing, so empty files are special. */
+		if (info.st_size > 0)
+			data = mmap(
+				NULL,
+				info.st_size,
+				PROT_READ,
+				MAP_PRIVATE,
+				fd,
+				0
+			);
+		if (data != MAP_FAILED) {
+			map = (ucpcal_map *) malloc(sizeof(ucpcal_map));
+			map->data = (char *) data;
+			map->length = info.st_size;
+			map->next = NULL;
+			UCPCAL_PROFILE_COUNT(
+				UCPCAL_PROFILE_BYTES_READ,
+				map->length
+			);
+		}
+	}
+	/* The mapping stays valid after the descriptor is closed. */
+	if (fd != -1)
+		close(fd);
+	return map;
+}
+
+void ucpcal_map_free(ucpcal_map *map) {
+	ucpcal_map *next;
+	while (map) {
+		next = map->next;
+		if (map->data)
+			munmap(map->data, map->length);
+		free(map);
+		map = next;
+	}
+}
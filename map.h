@@ -0,0 +1,53 @@
+/**
+ * @file map.h
+ * @brief Data structures and algorithms for memory mapped files.
+ */
+
+#ifndef UCPCAL_MAP_H
+#define UCPCAL_MAP_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @brief A data structure representing a memory mapped file.
+ * The mapping is private and read only, so pages stay shared with the page
+ * cache rather than being copied. Mappings can be chained together so that
+ * their owner can release them all at once.
+ */
+
+typedef struct ucpcal_map {
+	/**
+	 * The contents of the file, or NULL if the file is empty.
+	 */
+	char *data;
+	/**
+	 * The number of bytes in the file.
+	 */
+	size_t length;
+	struct ucpcal_map *next;
+} ucpcal_map;
+
+/**
+ * @brief Maps a file into memory for reading only.
+ * Pages are only read from the file as they are first touched, so mapping
+ * even a large file takes next to no time, but the file must not be
+ * truncated while it is mapped. Saving replaces a file by renaming a new
+ * one over it, which leaves the old contents mapped.
+ * Be sure to use ucpcal_map_free() when finished.
+ * @param filename the file to map
+ * @return pointer to new ucpcal_map struct, or NULL if the file could not be
+ * opened or mapped
+ */
+
+ucpcal_map *ucpcal_map_view(const char *filename);
+
+/**
+ * @brief Unmaps a memory mapped file, along with any chained after it.
+ * @param map the mapping to be freed, or NULL to do nothing
+ */
+
+void ucpcal_map_free(ucpcal_map *map);
+
+#endif
@@ -0,0 +1,84 @@
+/**
+ * @file profile.c
+ * @brief Data structures and algorithms for profiling the calendar.
+ */
+
+#include "profile.h"
+
+/* Static storage is zeroed, so profiling starts off with nothing counted. */
+ucpcal_profile ucpcal_profile_data;
+pthread_mutex_t ucpcal_profile_lock = PTHREAD_MUTEX_INITIALIZER;
+
+void ucpcal_profile_init(void) {
+	const char *filename = getenv(UCPCAL_PROFILE_VARIABLE);
+	if (filename && *filename && !ucpcal_profile_data.enabled) {
+		ucpcal_profile_data.enabled = 1;
+		ucpcal_profile_data.filename = filename;
+		atexit(&ucpcal_profile_write);
+	}
+}
+
+void ucpcal_profile_count(int counter, unsigned long amount) {
+	pthread_mutex_lock(&ucpcal_profile_lock);
+	ucpcal_profile_data.counters[counter] += amount;
+	pthread_mutex_unlock(&ucpcal_profile_lock);
+}
+
+void ucpcal_profile_start(int timer) {
+	if (ucpcal_profile_data.enabled)
+		ucpcal_profile_data.started[timer] = ucpcal_profile_now();
+}
+
+void ucpcal_profile_stop(int timer) {
+	ucpcal_profile *profile = &ucpcal_profile_data;
+	if (profile->enabled) {
+		profile->seconds[timer] +=
+			ucpcal_profile_now() - profile->started[timer];
+		profile->calls[timer]++;
+	}
+}
+
+double ucpcal_profile_now(void) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+void ucpcal_profile_write(void) {
+	static const char *timers[] = {
+		"load", "save", "render", "set_text"
+	};
+	static const char *counters[] = {
+		"allocations", "finds", "find_strcmp", "bytes_read",
+		"bytes_written"
+	};
+	FILE *f = strcmp(ucpcal_profile_data.filename, "-") ?
+		fopen(ucpcal_profile_data.filename, "w") : stderr;
+	int i;
+	if (!f) {
+		fprintf(stderr,
+			"%s: cannot write profile\n",
+			ucpcal_profile_data.filename
+		);
+	} else {
+		fprintf(f, "{\n");
+		for (i = 0; i < UCPCAL_PROFILE_TIMERS; i++)
+			fprintf(f,
+				"  \"%s\": {\"calls\": %lu, "
+				"\"seconds\": %.6f},\n",
+				timers[i],
+				ucpcal_profile_data.calls[i],
+				ucpcal_profile_data.seconds[i]
+			);
+		for (i = 0; i < UCPCAL_PROFILE_COUNTERS; i++)
+			fprintf(f,
+				"  \"%s\": %lu%s\n",
+				counters[i],
+				ucpcal_profile_data.counters[i],
+				i + 1 < UCPCAL_PROFILE_COUNTERS ? "," : ""
+			);
+		fprintf(f, "}\n");
+		if (f != stderr)
+			fclose(f);
+	}
+}
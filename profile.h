@@ -0,0 +1,149 @@
+/**
+ * @file profile.h
+ * @brief Data structures and algorithms for profiling the calendar.
+ */
+
+#ifndef UCPCAL_PROFILE_H
+#define UCPCAL_PROFILE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+/**
+ * @brief The environment variable that turns profiling on.
+ * It names the file the results are written to when the program exits, or
+ * is "-" to write them to stderr. Profiling is off when it is unset or empty.
+ */
+
+#define UCPCAL_PROFILE_VARIABLE "UCPCAL_PROFILE"
+
+/**
+ * @brief The timers, each covering one phase of the program.
+ * Loading includes replaying the journal, and setting text covers handing
+ * the rendered calendar to the GUI.
+ */
+
+#define UCPCAL_PROFILE_LOAD 0
+#define UCPCAL_PROFILE_SAVE 1
+#define UCPCAL_PROFILE_RENDER 2
+#define UCPCAL_PROFILE_SET_TEXT 3
+#define UCPCAL_PROFILE_TIMERS 4
+
+/**
+ * @brief The counters.
+ * Arena allocations are counted as each arena is emptied, and bytes read
+ * cover whole files read through a ucpcal_reader or a memory map.
+ */
+
+#define UCPCAL_PROFILE_ALLOCATIONS 0
+#define UCPCAL_PROFILE_FINDS 1
+#define UCPCAL_PROFILE_FIND_STRCMP 2
+#define UCPCAL_PROFILE_BYTES_READ 3
+#define UCPCAL_PROFILE_BYTES_WRITTEN 4
+#define UCPCAL_PROFILE_COUNTERS 5
+
+/**
+ * @brief Adds to a counter, costing only a test when profiling is off.
+ * Files may be loaded in the background, so counters are locked, and may be
+ * counted from any thread.
+ * @param counter the counter to add to
+ * @param amount the amount to add
+ */
+
+#define UCPCAL_PROFILE_COUNT(counter, amount) \
+	do { \
+		if (ucpcal_profile_data.enabled) \
+			ucpcal_profile_count(counter, amount); \
+	} while (0)
+
+/**
+ * @brief A data structure holding the results of profiling.
+ * There is only one, ucpcal_profile_data, for the whole program.
+ */
+
+typedef struct ucpcal_profile {
+	/**
+	 * Non-zero if profiling is on.
+	 */
+	int enabled;
+	/**
+	 * The file to write the results to, or "-" for stderr.
+	 */
+	const char *filename;
+	/**
+	 * When each timer was last started, on the monotonic clock.
+	 */
+	double started[UCPCAL_PROFILE_TIMERS];
+	/**
+	 * The total time, in seconds, and the number of times each timer has
+	 * run.
+	 */
+	double seconds[UCPCAL_PROFILE_TIMERS];
+	unsigned long calls[UCPCAL_PROFILE_TIMERS];
+	unsigned long counters[UCPCAL_PROFILE_COUNTERS];
+} ucpcal_profile;
+
+/**
+ * @brief The results of profiling the program.
+ */
+
+extern ucpcal_profile ucpcal_profile_data;
+
+/**
+ * @brief The lock guarding the counters of ucpcal_profile_data.
+ */
+
+extern pthread_mutex_t ucpcal_profile_lock;
+
+/**
+ * @brief Turns profiling on if the environment asks for it.
+ * If it does, the results are written out as JSON by ucpcal_profile_write()
+ * when the program exits. Call this once, at the start of main().
+ */
+
+void ucpcal_profile_init(void);
+
+/**
+ * @brief Adds to a counter while holding the profiling lock.
+ * Use UCPCAL_PROFILE_COUNT() instead, which skips the lock when profiling is
+ * off.
+ * @param counter the counter to add to
+ * @param amount the amount to add
+ */
+
+void ucpcal_profile_count(int counter, unsigned long amount);
+
+/**
+ * @brief Starts a timer.
+ * Timers are not locked, so they must only be used from the main thread.
+ * @param timer the timer to start, which must not already be running
+ */
+
+void ucpcal_profile_start(int timer);
+
+/**
+ * @brief Stops a timer, adding the time since it started to its total.
+ * @param timer the timer to stop
+ */
+
+void ucpcal_profile_stop(int timer);
+
+/**
+ * @brief Reads the monotonic clock.
+ * @return the time in seconds since some fixed point
+ */
+
+double ucpcal_profile_now(void);
+
+/**
+ * @brief Writes the results of profiling as a JSON object.
+ * Registered with atexit() by ucpcal_profile_init(); the object has a member
+ * for each timer, giving its calls and seconds, and one for each counter.
+ */
+
+void ucpcal_profile_write(void);
+
+#endif
@@ -0,0 +1,88 @@
+/**
+ * @file reader.c
+ * @brief Data structures and algorithms for buffered line reading.
+ */
+
+#include "reader.h"
+#include "profile.h"
+
+ucpcal_reader *ucpcal_reader_new(FILE *f) {
+	ucpcal_reader *reader = (ucpcal_reader *) malloc(
+		sizeof(ucpcal_reader)
+	);
+	reader->f = f;
+	/* Big enough that few lines straddle two blocks. */
+	reader->size = 65536;
+	reader->buffer = (char *) malloc(reader->size);
+	reader->start = 0;
+	reader->end = 0;
+	reader->eof = 0;
+	reader->line = 0;
+	return reader;
+}
+
+void ucpcal_reader_free(ucpcal_reader *reader) {
+	if (reader) {
+		free(reader->buffer);
+		free(reader);
+	}
+}
+
+char *ucpcal_reader_line(ucpcal_reader *reader, size_t *length) {
+	char *result = NULL, *newline;
+	/* Bytes already known not to contain a newline. */
+	size_t scanned = 0, got;
+	while (
+		!(newline = (char *) memchr(
+			reader->buffer + reader->start + scanned,
+			'\n',
+			reader->end - reader->start - scanned
+		)) &&
+		!reader->eof
+	) {
+		scanned = reader->end - reader->start;
+		if (reader->end == reader->size) {
+			if (reader->start) {
+				/* Move the partial line to the front. */
+				memmove(
+					reader->buffer,
+					reader->buffer + reader->start,
+					scanned
+				);
+				reader->end = scanned;
+				reader->start = 0;
+			} else {
+				/* The line fills the buffer; grow it. */
+				reader->size *= 2;
+				reader->buffer = (char *) realloc(
+					reader->buffer,
+					reader->size
+				);
+			}
+		}
+		got = fread(
+			reader->buffer + reader->end,
+			1,
+			reader->size - reader->end,
+			reader->f
+		);
+		reader->end += got;
+		UCPCAL_PROFILE_COUNT(UCPCAL_PROFILE_BYTES_READ, got);
+		/* Nothing more means the end of the file, or an error. */
+		if (!got)
+			reader->eof = 1;
+	}
+	if (newline) {
+		result = reader->buffer + reader->start;
+		*length = newline - result;
+		reader->start += *length + 1;
+	} else if (reader->start < reader->end) {
+		/* The last line of the file has no newline. */
+		result = reader->buffer + reader->start;
+		*length = reader->end - reader->start;
+		reader->start = reader->end;
+	}
+	if (result)
+		reader->line++;
+	return result;
+}
@@ -0,0 +1,77 @@
+/**
+ * @file reader.h
+ * @brief Data structures and algorithms for buffered line reading.
+ */
+
+#ifndef UCPCAL_READER_H
+#define UCPCAL_READER_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @brief A data structure representing a buffered line reader.
+ * Reads a file handle in large blocks with fread(), and finds the end of
+ * each line with memchr(), which the C library can scan many bytes at a
+ * time. Lines are handed out in place, so the caller can copy each one
+ * straight to wherever it needs to end up. The buffer grows whenever a line
+ * is longer than the whole buffer, so lines of any length can be read.
+ */
+
+typedef struct ucpcal_reader {
+	FILE *f;
+	char *buffer;
+	/**
+	 * The number of bytes allocated for the buffer.
+	 */
+	size_t size;
+	/**
+	 * The offset of the first byte not yet handed out in a line.
+	 */
+	size_t start;
+	/**
+	 * The offset just past the last byte read into the buffer.
+	 */
+	size_t end;
+	/**
+	 * Non-zero once fread() has reached the end of the file.
+	 */
+	int eof;
+	/**
+	 * The number of lines handed out so far, which is also the line
+	 * number of the most recent line.
+	 */
+	unsigned long line;
+} ucpcal_reader;
+
+/**
+ * @brief Creates a new line reader on the heap.
+ * The file handle is not closed by ucpcal_reader_free(), and should not be
+ * read from by anything else while the reader is in use.
+ * Be sure to use ucpcal_reader_free() when finished.
+ * @param f the file handle to read from
+ * @return pointer to new ucpcal_reader struct
+ */
+
+ucpcal_reader *ucpcal_reader_new(FILE *f);
+
+/**
+ * @brief Frees the memory used for a line reader struct.
+ * @param reader the line reader to be freed
+ */
+
+void ucpcal_reader_free(ucpcal_reader *reader);
+
+/**
+ * @brief Reads the next line from a line reader.
+ * The line is left in the reader's buffer without its newline, and is not
+ * null terminated. It remains valid until the next call.
+ * @param reader the line reader to read from
+ * @param length where to store the number of bytes in the line
+ * @return the start of the line, or NULL at the end of the file
+ */
+
+char *ucpcal_reader_line(ucpcal_reader *reader, size_t *length);
+
+#endif
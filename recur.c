@@ -0,0 +1,507 @@
+/**
+ * @file recur.c
+ * @brief Data structures and algorithms for recurring events.
+ */
+
+#include "recur.h"
+
+ucpcal_rule *ucpcal_rule_new(ucpcal_arena *arena, size_t exception_count) {
+	ucpcal_rule *rule;
+	if (arena)
+		rule = (ucpcal_rule *) ucpcal_arena_alloc(
+			arena,
+			sizeof(ucpcal_rule)
+		);
+	else
+		rule = (ucpcal_rule *) malloc(sizeof(ucpcal_rule));
+	rule->frequency = UCPCAL_RULE_DAILY;
+	rule->interval = 1;
+	rule->count = 0;
+	rule->has_until = 0;
+	rule->until = 0;
+	rule->exceptions = NULL;
+	rule->exception_count = exception_count;
+	rule->arena = arena;
+	if (exception_count && arena)
+		rule->exceptions = (ucpcal_time *) ucpcal_arena_alloc(
+			arena,
+			exception_count * sizeof(ucpcal_time)
+		);
+	else if (exception_count)
+		rule->exceptions = (ucpcal_time *) malloc(
+			exception_count * sizeof(ucpcal_time)
+		);
+	return rule;
+}
+
+void ucpcal_rule_free(ucpcal_rule *rule) {
+	if (rule && rule->arena) {
+		if (rule->exceptions)
+			ucpcal_arena_recycle(
+				rule->arena,
+				rule->exceptions,
+				rule->exception_count * sizeof(ucpcal_time)
+			);
+		ucpcal_arena_recycle(rule->arena, rule, sizeof(ucpcal_rule));
+	} else if (rule) {
+		free(rule->exceptions);
+		free(rule);
+	}
+}
+
+ucpcal_rule *ucpcal_rule_copy(ucpcal_arena *arena, const ucpcal_rule *rule) {
+	ucpcal_rule *copy = NULL;
+	if (rule) {
+		copy = ucpcal_rule_new(arena, rule->exception_count);
+		copy->frequency = rule->frequency;
+		copy->interval = rule->interval;
+		copy->count = rule->count;
+		copy->has_until = rule->has_until;
+		copy->until = rule->until;
+		if (rule->exception_count)
+			memcpy(
+				copy->exceptions,
+				rule->exceptions,
+				rule->exception_count * sizeof(ucpcal_time)
+			);
+	}
+	return copy;
+}
+
+ucpcal_rule *ucpcal_rule_parse(
+	ucpcal_arena *arena,
+	const char *text,
+	const char *end
+) {
+	ucpcal_rule *result = NULL, scanned;
+	/* Scan once to count the exceptions, then again to store them. */
+	scanned.exceptions = NULL;
+	if (ucpcal_rule_scan(text, end, &scanned)) {
+		result = ucpcal_rule_new(arena, scanned.exception_count);
+		ucpcal_rule_scan(text, end, result);
+		/* Dates may be written in any order, but are searched sorted. */
+		if (result->exception_count > 1)
+			qsort(
+				result->exceptions,
+				result->exception_count,
+				sizeof(ucpcal_time),
+				ucpcal_rule_compare
+			);
+	}
+	return result;
+}
+
+int ucpcal_rule_scan(const char *text, const char *end, ucpcal_rule *rule) {
+	const char *cur = text, *next, *error = NULL;
+	ucpcal_rule fields;
+	ucpcal_date date;
+	int value, more;
+	fields.frequency = UCPCAL_RULE_DAILY;
+	fields.interval = 1;
+	fields.count = 0;
+	fields.has_until = 0;
+	fields.until = 0;
+	fields.exceptions = rule ? rule->exceptions : NULL;
+	fields.exception_count = 0;
+	fields.arena = rule ? rule->arena : NULL;
+	while (
+		cur < end &&
+		(*cur == ' ' || *cur == '\t' || *cur == '\r')
+	)
+		cur++;
+	if (!(cur = ucpcal_rule_word(cur, end, "every")))
+		error = "expected every";
+	while (!error && cur < end && (*cur == ' ' || *cur == '\t'))
+		cur++;
+	/* The interval may be left out when it is 1. */
+	if (!error && cur < end && *cur >= '0' && *cur <= '9') {
+		cur = ucpcal_date_parse_number(cur, end, 9, &value);
+		if (!cur || value < 1)
+			error = "expected an interval of at least 1";
+		else
+			fields.interval = value;
+		while (!error && cur < end && (*cur == ' ' || *cur == '\t'))
+			cur++;
+	}
+	if (!error && (
+		(next = ucpcal_rule_word(cur, end, "day")) ||
+		(next = ucpcal_rule_word(cur, end, "days"))
+	)) {
+		fields.frequency = UCPCAL_RULE_DAILY;
+		cur = next;
+	} else if (!error && (
+		(next = ucpcal_rule_word(cur, end, "week")) ||
+		(next = ucpcal_rule_word(cur, end, "weeks"))
+	)) {
+		fields.frequency = UCPCAL_RULE_WEEKLY;
+		cur = next;
+	} else if (!error && (
+		(next = ucpcal_rule_word(cur, end, "month")) ||
+		(next = ucpcal_rule_word(cur, end, "months"))
+	)) {
+		fields.frequency = UCPCAL_RULE_MONTHLY;
+		cur = next;
+	} else if (!error) {
+		error = "expected day, week or month";
+	}
+	while (
+		!error && cur < end &&
+		(*cur == ' ' || *cur == '\t' || *cur == '\r')
+	)
+		cur++;
+	while (!error && cur < end) {
+		if ((next = ucpcal_rule_word(cur, end, "count"))) {
+			cur = next;
+			while (cur < end && (*cur == ' ' || *cur == '\t'))
+				cur++;
+			cur = ucpcal_date_parse_number(cur, end, 9, &value);
+			if (!cur || value < 1)
+				error = "expected a count of at least 1";
+			else
+				fields.count = value;
+		} else if ((next = ucpcal_rule_word(cur, end, "until"))) {
+			cur = next;
+			while (cur < end && (*cur == ' ' || *cur == '\t'))
+				cur++;
+			cur = ucpcal_date_parse(cur, end, &date, &error);
+			fields.has_until = 1;
+			fields.until = ucpcal_time_from_date(date);
+		} else if ((next = ucpcal_rule_word(cur, end, "except"))) {
+			cur = next;
+			more = 1;
+			while (!error && more) {
+				while (
+					cur < end &&
+					(*cur == ' ' || *cur == '\t')
+				)
+					cur++;
+				cur = ucpcal_date_parse(
+					cur,
+					end,
+					&date,
+					&error
+				);
+				if (!error && fields.exceptions)
+					fields.exceptions[
+						fields.exception_count
+					] = ucpcal_time_from_date(date);
+				fields.exception_count++;
+				while (
+					cur < end &&
+					(*cur == ' ' || *cur == '\t')
+				)
+					cur++;
+				/* Exceptions are separated by commas. */
+				more = cur < end && *cur == ',';
+				if (more)
+					cur++;
+			}
+		} else {
+			error = "expected count, until or except";
+		}
+		/* Each part must be followed by whitespace or the end. */
+		if (
+			!error && cur < end &&
+			*cur != ' ' && *cur != '\t' && *cur != '\r'
+		)
+			error = "expected a space";
+		/* Trailing whitespace ends the rule. */
+		while (
+			!error && cur < end &&
+			(*cur == ' ' || *cur == '\t' || *cur == '\r')
+		)
+			cur++;
+	}
+	if (!error && rule)
+		*rule = fields;
+	return !error;
+}
+
+const char *ucpcal_rule_line(
+	const char *text,
+	const char *end,
+	const char **error
+) {
+	size_t length = sizeof(UCPCAL_RULE_PREFIX) - 1;
+	const char *result = NULL;
+	*error = NULL;
+	if (
+		(size_t) (end - text) >= length &&
+		!memcmp(text, UCPCAL_RULE_PREFIX, length)
+	) {
+		result = text + length;
+		if (!ucpcal_rule_scan(result, end, NULL))
+			*error = "malformed repeat rule";
+	}
+	return result;
+}
+
+const char *ucpcal_rule_word(
+	const char *text,
+	const char *end,
+	const char *word
+) {
+	size_t length = strlen(word);
+	const char *result = NULL;
+	if (
+		(size_t) (end - text) >= length &&
+		!memcmp(text, word, length) && (
+			text + length == end ||
+			text[length] == ' ' ||
+			text[length] == '\t' ||
+			text[length] == '\r'
+		)
+	)
+		result = text + length;
+	return result;
+}
+
+int ucpcal_rule_compare(const void *a, const void *b) {
+	ucpcal_time x = *(const ucpcal_time *) a;
+	ucpcal_time y = *(const ucpcal_time *) b;
+	return (x > y) - (x < y);
+}
+
+size_t ucpcal_rule_format_size(const ucpcal_rule *rule) {
+	/* Start with enough to hold a null terminator. */
+	size_t size = 1;
+	/* Add enough for "every ", a 32-bit interval and " months". */
+	size += 6 + 10 + 7;
+	/* Add enough for " count " and a 32-bit count. */
+	size += 7 + 10;
+	/* Add enough for " until " and a time with a nine digit year. */
+	size += 7 + 25;
+	/* Add enough for " except ", then each time and ", ". */
+	size += 8 + rule->exception_count * (25 + 2);
+	return size;
+}
+
+size_t ucpcal_rule_format(char *buffer, const ucpcal_rule *rule) {
+	static const char *units[] = { "day", "week", "month" };
+	char *cur = buffer;
+	size_t i;
+	memcpy(cur, "every ", 6);
+	cur += 6;
+	if (rule->interval != 1) {
+		cur = ucpcal_format_number(cur, rule->interval, 1);
+		*cur++ = ' ';
+	}
+	strcpy(cur, units[rule->frequency]);
+	cur += strlen(cur);
+	if (rule->interval != 1)
+		*cur++ = 's';
+	if (rule->count) {
+		memcpy(cur, " count ", 7);
+		cur = ucpcal_format_number(cur + 7, rule->count, 1);
+	}
+	if (rule->has_until) {
+		memcpy(cur, " until ", 7);
+		cur = ucpcal_rule_format_time(cur + 7, rule->until);
+	}
+	for (i = 0; i < rule->exception_count; i++) {
+		if (i) {
+			memcpy(cur, ", ", 2);
+			cur += 2;
+		} else {
+			memcpy(cur, " except ", 8);
+			cur += 8;
+		}
+		cur = ucpcal_rule_format_time(cur, rule->exceptions[i]);
+	}
+	*cur = 0;
+	return cur - buffer;
+}
+
+char *ucpcal_rule_format_time(char *buffer, ucpcal_time time) {
+	ucpcal_date date = ucpcal_time_to_date(time);
+	char *cur = ucpcal_format_number(buffer, date.year, 1);
+	*cur++ = '-';
+	cur = ucpcal_format_number(cur, date.month, 2);
+	*cur++ = '-';
+	cur = ucpcal_format_number(cur, date.day, 2);
+	*cur++ = ' ';
+	cur = ucpcal_format_number(cur, date.hour, 2);
+	*cur++ = ':';
+	return ucpcal_format_number(cur, date.minute, 2);
+}
+
+ucpcal_time ucpcal_rule_start(
+	const ucpcal_rule *rule,
+	ucpcal_date first,
+	unsigned long index
+) {
+	ucpcal_time result = ucpcal_time_from_date(first);
+	long months, days;
+	if (rule && rule->frequency == UCPCAL_RULE_MONTHLY) {
+		/*
+			Count months from 10000 years before year 0, as in
+			date.c, so that division never sees a negative number.
+		*/
+		months = (first.year + 10000L) * 12 + (first.month - 1) +
+			(long) (index * rule->interval);
+		first.year = months / 12 - 10000;
+		first.month = months % 12 + 1;
+		/* Months too short for the day end the occurrence early. */
+		days = ucpcal_date_days_in_month(first.year, first.month);
+		if (first.day > days)
+			first.day = days;
+		result = ucpcal_time_from_date(first);
+	} else if (rule) {
+		days = rule->frequency == UCPCAL_RULE_WEEKLY ? 7 : 1;
+		result = ucpcal_time_add(
+			result,
+			(long) (index * rule->interval) * days * 1440
+		);
+	}
+	return result;
+}
+
+unsigned long ucpcal_rule_index(
+	const ucpcal_rule *rule,
+	ucpcal_date first,
+	ucpcal_time from
+) {
+	ucpcal_time start = ucpcal_time_from_date(first);
+	ucpcal_date date;
+	unsigned long result = 0;
+	long step, months;
+	if (rule && from > start) {
+		if (rule->frequency == UCPCAL_RULE_MONTHLY) {
+			/*
+				Start from the last occurrence in a month no
+				later than the time's, which is at most one
+				occurrence too early.
+			*/
+			date = ucpcal_time_to_date(from);
+			months = (date.year - first.year) * 12L +
+				(date.month - first.month);
+			result = (unsigned long) months / rule->interval;
+		} else {
+			step = (long) rule->interval * 1440 *
+				(rule->frequency == UCPCAL_RULE_WEEKLY ? 7 : 1);
+			result = (unsigned long) ((from - start) / step);
+		}
+		while (ucpcal_rule_start(rule, first, result) < from)
+			result++;
+	} else if (!rule && from > start) {
+		/* An event that does not recur has only occurrence 0. */
+		result = 1;
+	}
+	return result;
+}
+
+int ucpcal_rule_includes(
+	const ucpcal_rule *rule,
+	unsigned long index,
+	ucpcal_time start
+) {
+	return rule ?
+		(!rule->count || index < rule->count) &&
+		(!rule->has_until || start <= rule->until) :
+		index == 0;
+}
+
+int ucpcal_rule_excludes(const ucpcal_rule *rule, ucpcal_time start) {
+	size_t low = 0, high = rule ? rule->exception_count : 0, middle;
+	while (low < high) {
+		middle = low + (high - low) / 2;
+		if (rule->exceptions[middle] < start)
+			low = middle + 1;
+		else
+			high = middle;
+	}
+	return rule && low < rule->exception_count &&
+		rule->exceptions[low] == start;
+}
+
+ucpcal_occurrences ucpcal_event_occurrences(
+	const ucpcal_event *event,
+	ucpcal_time from,
+	ucpcal_time to
+) {
+	ucpcal_occurrences occurrences;
+	occurrences.event = event;
+	occurrences.occurrence = *event;
+	occurrences.index = ucpcal_rule_index(event->rule, event->date, from);
+	occurrences.to = to;
+	occurrences.done = 0;
+	ucpcal_occurrences_seek(&occurrences);
+	return occurrences;
+}
+
+const ucpcal_event *ucpcal_occurrences_next(ucpcal_occurrences *occurrences) {
+	const ucpcal_event *result = NULL;
+	if (!occurrences->done) {
+		occurrences->occurrence.date = ucpcal_time_to_date(
+			occurrences->start
+		);
+		result = &occurrences->occurrence;
+		occurrences->index++;
+		ucpcal_occurrences_seek(occurrences);
+	}
+	return result;
+}
+
+void ucpcal_occurrences_seek(ucpcal_occurrences *occurrences) {
+	const ucpcal_event *event = occurrences->event;
+	int found = 0;
+	while (!found && !occurrences->done) {
+		occurrences->start = ucpcal_rule_start(
+			event->rule,
+			event->date,
+			occurrences->index
+		);
+		if (
+			occurrences->start >= occurrences->to ||
+			!ucpcal_rule_includes(
+				event->rule,
+				occurrences->index,
+				occurrences->start
+			)
+		)
+			occurrences->done = 1;
+		else if (ucpcal_rule_excludes(event->rule, occurrences->start))
+			occurrences->index++;
+		else
+			found = 1;
+	}
+}
+
+ucpcal_series *ucpcal_series_new(void) {
+	ucpcal_series *series = (ucpcal_series *) malloc(
+		sizeof(ucpcal_series)
+	);
+	series->nodes = NULL;
+	series->count = 0;
+	series->capacity = 0;
+	return series;
+}
+
+void ucpcal_series_free(ucpcal_series *series) {
+	if (series) {
+		free(series->nodes);
+		free(series);
+	}
+}
+
+void ucpcal_series_add(ucpcal_series *series, struct ucpcal_node *node) {
+	if (series->count == series->capacity) {
+		series->capacity = series->capacity ? series->capacity * 2 : 16;
+		series->nodes = (struct ucpcal_node **) realloc(
+			series->nodes,
+			series->capacity * sizeof(struct ucpcal_node *)
+		);
+	}
+	series->nodes[series->count++] = node;
+}
+
+void ucpcal_series_remove(ucpcal_series *series, struct ucpcal_node *node) {
+	size_t i;
+	for (i = 0; i < series->count; i++) {
+		if (series->nodes[i] == node) {
+			series->nodes[i] = series->nodes[--series->count];
+			/* Nodes are never added twice, so stop looking. */
+			i = series->count;
+		}
+	}
+}
@@ -0,0 +1,377 @@
+/**
+ * @file recur.h
+ * @brief Data structures and algorithms for recurring events.
+ */
+
+#ifndef UCPCAL_RECUR_H
+#define UCPCAL_RECUR_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "date.h"
+#include "event.h"
+#include "arena.h"
+#include "writer.h"
+
+/*
+	As with columns.h, list.h keeps a set of recurring nodes in each list,
+	so the node structure can only be declared incompletely here.
+*/
+struct ucpcal_node;
+
+/**
+ * @brief The frequencies an event may recur at.
+ * An event recurring monthly on a day that some months lack, such as the
+ * 31st, falls on the last day of those months instead.
+ */
+
+#define UCPCAL_RULE_DAILY 0
+#define UCPCAL_RULE_WEEKLY 1
+#define UCPCAL_RULE_MONTHLY 2
+
+/**
+ * @brief The text that starts a rule line in a calendar file or journal.
+ * A location may not start with it, so a line that does is always a rule.
+ */
+
+#define UCPCAL_RULE_PREFIX "repeat: "
+
+/**
+ * @brief A data structure representing the rule by which an event recurs.
+ * The event's own date is the first occurrence, and each later occurrence
+ * is some whole number of intervals after it. Occurrences are never stored;
+ * they are worked out as needed by a ucpcal_occurrences iterator.
+ * In a calendar file, a rule is written on the line after its event's
+ * header, as UCPCAL_RULE_PREFIX followed by "every [INTERVAL] UNIT [count
+ * COUNT] [until DATE] [except DATE[, DATE...]]", where UNIT is day, week or
+ * month, optionally plural, and each DATE is "YYYY-MM-DD HH:MM" as in the
+ * header.
+ */
+
+typedef struct ucpcal_rule {
+	/**
+	 * UCPCAL_RULE_DAILY, UCPCAL_RULE_WEEKLY or UCPCAL_RULE_MONTHLY.
+	 */
+	int frequency;
+	/**
+	 * The number of days, weeks or months between occurrences, at least 1.
+	 */
+	unsigned int interval;
+	/**
+	 * The number of occurrences, including any excepted, or 0 for no
+	 * limit.
+	 */
+	unsigned int count;
+	/**
+	 * Non-zero if occurrences must start at or before until.
+	 */
+	int has_until;
+	ucpcal_time until;
+	/**
+	 * The start times of occurrences that do not happen after all, in
+	 * increasing order.
+	 */
+	ucpcal_time *exceptions;
+	size_t exception_count;
+	/**
+	 * The arena the rule was allocated from, or NULL for the heap.
+	 */
+	ucpcal_arena *arena;
+} ucpcal_rule;
+
+/**
+ * @brief A data structure for iterating over the occurrences of an event in
+ * a range of times.
+ * Obtained from ucpcal_event_occurrences() and advanced with
+ * ucpcal_occurrences_next(). An event that does not recur occurs once.
+ * Editing or freeing the event invalidates the iterator.
+ */
+
+typedef struct ucpcal_occurrences {
+	/**
+	 * The event whose occurrences are produced.
+	 */
+	const ucpcal_event *event;
+	/**
+	 * A copy of the event, sharing its strings and rule, whose date is
+	 * that of the occurrence last produced.
+	 */
+	ucpcal_event occurrence;
+	/**
+	 * The number of the occurrence to be produced next, counting from 0
+	 * for the event's own date, and its start time.
+	 */
+	unsigned long index;
+	ucpcal_time start;
+	/**
+	 * The end of the range, in minutes since the Unix epoch.
+	 */
+	ucpcal_time to;
+	/**
+	 * Non-zero when finished.
+	 */
+	int done;
+} ucpcal_occurrences;
+
+/**
+ * @brief A data structure representing a set of list nodes whose events
+ * recur, in no particular order.
+ * Recurring events are expected to be few, standing in for the many events
+ * they would otherwise take, so removing a node searches the whole set.
+ */
+
+typedef struct ucpcal_series {
+	struct ucpcal_node **nodes;
+	size_t count;
+	size_t capacity;
+} ucpcal_series;
+
+/**
+ * @brief Creates a new rule, recurring daily with no limit, in an arena or
+ * on the heap.
+ * Be sure to use ucpcal_rule_free() when finished.
+ * @param arena the arena to allocate from, or NULL for the heap
+ * @param exception_count the number of exceptions to make room for
+ * @return pointer to new ucpcal_rule struct
+ */
+
+ucpcal_rule *ucpcal_rule_new(ucpcal_arena *arena, size_t exception_count);
+
+/**
+ * @brief Frees the memory used for a rule, including its exceptions.
+ * Rules from an arena are recycled into it rather than freed.
+ * @param rule the rule to be freed, or NULL
+ */
+
+void ucpcal_rule_free(ucpcal_rule *rule);
+
+/**
+ * @brief Copies a rule into an arena or onto the heap.
+ * @param arena the arena to allocate from, or NULL for the heap
+ * @param rule the rule to copy, or NULL
+ * @return pointer to new ucpcal_rule struct, or NULL if rule is NULL
+ */
+
+ucpcal_rule *ucpcal_rule_copy(ucpcal_arena *arena, const ucpcal_rule *rule);
+
+/**
+ * @brief Parses a rule, as found by ucpcal_rule_line().
+ * @param arena the arena to allocate the rule from, or NULL for the heap
+ * @param text the start of the rule
+ * @param end the end of the rule, which need not be null terminated
+ * @return pointer to new ucpcal_rule struct, or NULL if the whole text is
+ * not a rule
+ */
+
+ucpcal_rule *ucpcal_rule_parse(
+	ucpcal_arena *arena,
+	const char *text,
+	const char *end
+);
+
+/**
+ * @brief Checks whether a line of a calendar file is a rule, and reads it.
+ * Whitespace, including carriage returns, may appear between and around
+ * the parts of the rule.
+ * @param text the start of the line
+ * @param end the end of the line, which need not be null terminated
+ * @param rule where to store the rule's fields and number of exceptions,
+ * or NULL to only check the line; the exceptions themselves are stored only
+ * if its exceptions are not NULL, in the order written
+ * @return non-zero if the whole line is a rule
+ */
+
+int ucpcal_rule_scan(const char *text, const char *end, ucpcal_rule *rule);
+
+/**
+ * @brief Checks whether a line of a calendar file is a rule line.
+ * Any line starting with UCPCAL_RULE_PREFIX is one, so a record whose rule
+ * does not read is malformed rather than taken for a location.
+ * @param text the start of the line
+ * @param end the end of the line, which need not be null terminated
+ * @param error where to store a description of the problem if the rest of
+ * the line does not read as a rule, or NULL otherwise
+ * @return the start of the rule after UCPCAL_RULE_PREFIX if the line starts
+ * with it, or NULL otherwise
+ */
+
+const char *ucpcal_rule_line(
+	const char *text,
+	const char *end,
+	const char **error
+);
+
+/**
+ * @brief Checks whether text starts with a word, followed by whitespace or
+ * the end of the text.
+ * @param text the start of the text
+ * @param end the end of the text
+ * @param word the null terminated word to look for
+ * @return just past the word if it is there, or NULL otherwise
+ */
+
+const char *ucpcal_rule_word(
+	const char *text,
+	const char *end,
+	const char *word
+);
+
+/**
+ * @brief Compares two start times for qsort(), in increasing order.
+ * @param a pointer to the first ucpcal_time
+ * @param b pointer to the second ucpcal_time
+ * @return negative, zero or positive as a is before, at or after b
+ */
+
+int ucpcal_rule_compare(const void *a, const void *b);
+
+/**
+ * @brief Works out how many bytes a rule could need when formatted.
+ * @param rule the rule
+ * @return the size of buffer needed, including the null terminator
+ */
+
+size_t ucpcal_rule_format_size(const ucpcal_rule *rule);
+
+/**
+ * @brief Formats a rule as it is written in a calendar file.
+ * @param buffer where to write, with room for ucpcal_rule_format_size()
+ * bytes
+ * @param rule the rule
+ * @return the number of bytes written, excluding the null terminator
+ */
+
+size_t ucpcal_rule_format(char *buffer, const ucpcal_rule *rule);
+
+/**
+ * @brief Formats a time as "YYYY-MM-DD HH:MM", as in a calendar file.
+ * @param buffer where to write, with room for a sign and 24 more bytes
+ * @param time the time, in minutes since the Unix epoch
+ * @return just past the last byte written; nothing is null terminated
+ */
+
+char *ucpcal_rule_format_time(char *buffer, ucpcal_time time);
+
+/**
+ * @brief Works out when an occurrence of an event starts, ignoring its
+ * rule's limits and exceptions.
+ * @param rule the event's rule, or NULL if it does not recur
+ * @param first the event's own date
+ * @param index the number of the occurrence, counting from 0
+ * @return the start of the occurrence, in minutes since the Unix epoch
+ */
+
+ucpcal_time ucpcal_rule_start(
+	const ucpcal_rule *rule,
+	ucpcal_date first,
+	unsigned long index
+);
+
+/**
+ * @brief Finds the number of the first occurrence of an event starting at or
+ * after a time, ignoring its rule's limits and exceptions.
+ * Works in O(1) time, however far the time is from the first occurrence.
+ * @param rule the event's rule, or NULL if it does not recur
+ * @param first the event's own date
+ * @param from the time, in minutes since the Unix epoch
+ * @return the number of the occurrence
+ */
+
+unsigned long ucpcal_rule_index(
+	const ucpcal_rule *rule,
+	ucpcal_date first,
+	ucpcal_time from
+);
+
+/**
+ * @brief Checks whether an occurrence is within a rule's limits.
+ * @param rule the rule, or NULL if the event does not recur
+ * @param index the number of the occurrence
+ * @param start the start of the occurrence
+ * @return non-zero if the occurrence is within the count and until
+ */
+
+int ucpcal_rule_includes(
+	const ucpcal_rule *rule,
+	unsigned long index,
+	ucpcal_time start
+);
+
+/**
+ * @brief Checks whether an occurrence is one of a rule's exceptions.
+ * @param rule the rule, or NULL if the event does not recur
+ * @param start the start of the occurrence
+ * @return non-zero if the occurrence does not happen
+ */
+
+int ucpcal_rule_excludes(const ucpcal_rule *rule, ucpcal_time start);
+
+/**
+ * @brief Starts iterating over the occurrences of an event that start in a
+ * range of times.
+ * Occurrences before the range are skipped over rather than visited, so
+ * this takes O(1) time wherever the range is.
+ * @param event the event
+ * @param from the start of the range, inclusive
+ * @param to the end of the range, exclusive
+ * @return the iterator
+ */
+
+ucpcal_occurrences ucpcal_event_occurrences(
+	const ucpcal_event *event,
+	ucpcal_time from,
+	ucpcal_time to
+);
+
+/**
+ * @brief Produces the next occurrence of an event.
+ * @param occurrences the iterator
+ * @return a copy of the event with the date of the occurrence, valid until
+ * the next call, or NULL when there are no more occurrences in the range
+ */
+
+const ucpcal_event *ucpcal_occurrences_next(ucpcal_occurrences *occurrences);
+
+/**
+ * @brief Moves an iterator on to the next occurrence that happens, from the
+ * one whose number it holds, finishing it if there is none in the range.
+ * @param occurrences the iterator
+ */
+
+void ucpcal_occurrences_seek(ucpcal_occurrences *occurrences);
+
+/**
+ * @brief Creates a new, empty set of recurring nodes on the heap.
+ * Be sure to use ucpcal_series_free() when finished.
+ * @return pointer to new ucpcal_series struct
+ */
+
+ucpcal_series *ucpcal_series_new(void);
+
+/**
+ * @brief Frees the memory used for a set of recurring nodes.
+ * The nodes themselves are not freed.
+ * @param series the set to be freed, or NULL
+ */
+
+void ucpcal_series_free(ucpcal_series *series);
+
+/**
+ * @brief Adds a node to a set of recurring nodes.
+ * @param series the set
+ * @param node the node, whose event must recur
+ */
+
+void ucpcal_series_add(ucpcal_series *series, struct ucpcal_node *node);
+
+/**
+ * @brief Removes a node from a set of recurring nodes, if it is there.
+ * The last node in the set takes its place.
+ * @param series the set
+ * @param node the node to remove
+ */
+
+void ucpcal_series_remove(ucpcal_series *series, struct ucpcal_node *node);
+
+#endif
@@ -0,0 +1,448 @@
+/**
+ * @file render.c
+ * @brief Algorithms for rendering calendars as text for display.
+ */
+
+#include "render.h"
+
+char *ucpcal_render_list(ucpcal_list *list) {
+	/* result_cursor is used for appending each event's text */
+	char *result, *result_cursor;
+	/* First, let's calculate how much to allocate for the string. */
+	/* Start with enough to hold a null terminator. */
+	size_t size = 1;
+	/* Events are shown in chronological order. */
+	ucpcal_node *cur = ucpcal_tree_first(list->times);
+	/* Occurrences are not stored, so there is no knowing the size. */
+	if (cur && ucpcal_list_series(list)->count) {
+		result = ucpcal_render_window(
+			list,
+			cur->when.start,
+			ucpcal_tree_last(list->times)->when.start +
+				UCPCAL_RENDER_HORIZON
+		);
+	} else {
+		while (cur) {
+			size += ucpcal_render_node_size(cur);
+			cur = ucpcal_tree_next(cur);
+		}
+		/* Now, let's allocate. */
+		result = (char *) malloc(size);
+		result_cursor = result;
+		/* Terminate the string first in case there are no nodes. */
+		*result_cursor = 0;
+		/* For each event, let's append to the string. */
+		cur = ucpcal_tree_first(list->times);
+		while (cur) {
+			/* Events that have not changed are simply copied. */
+			result_cursor += ucpcal_render_node(
+				result_cursor,
+				cur,
+				list->arena
+			);
+			/*
+				Remember where each event's text is, so that it
+				can be replaced later without rendering
+				everything again.
+			*/
+			cur->when.weight = cur->text_characters;
+			cur = ucpcal_tree_next(cur);
+		}
+		ucpcal_tree_update_subtree(list->times->root);
+	}
+	return result;
+}
+
+char *ucpcal_render_window(
+	ucpcal_list *list,
+	ucpcal_time from,
+	ucpcal_time to
+) {
+	ucpcal_window window = ucpcal_list_window(
+		list,
+		ucpcal_time_to_date(from),
+		ucpcal_time_to_date(to)
+	);
+	const ucpcal_event *event;
+	size_t size = 1024, length = 0, needed;
+	char *result = (char *) malloc(size);
+	*result = 0;
+	while ((event = ucpcal_window_next(&window))) {
+		needed = window.node ?
+			ucpcal_render_node_size(window.node) :
+			ucpcal_render_event_size(event);
+		while (length + needed > size) {
+			size *= 2;
+			result = (char *) realloc(result, size);
+		}
+		/* Only events that do not recur have a node to cache in. */
+		length += window.node ?
+			ucpcal_render_node(
+				result + length,
+				window.node,
+				list->arena
+			) :
+			ucpcal_render_event(result + length, event);
+	}
+	ucpcal_window_free(&window);
+	return result;
+}
+
+/* Runs shorter than this are not worth a thread of their own. */
+#define UCPCAL_RENDER_MIN_SLICE 4096
+
+char *ucpcal_render_parallel(ucpcal_list *list, int threads) {
+	ucpcal_slice *slices;
+	ucpcal_node **nodes, *cur;
+	pthread_t *ids;
+	int *started;
+	char *result;
+	size_t count = 0, capacity = 1024, size = 1, offset = 0;
+	int i;
+	/* Threads need to know where their runs start, so list the nodes. */
+	nodes = (ucpcal_node **) malloc(capacity * sizeof(ucpcal_node *));
+	for (
+		cur = ucpcal_tree_first(list->times);
+		cur;
+		cur = ucpcal_tree_next(cur)
+	) {
+		if (count == capacity) {
+			capacity *= 2;
+			nodes = (ucpcal_node **) realloc(
+				nodes,
+				capacity * sizeof(ucpcal_node *)
+			);
+		}
+		nodes[count++] = cur;
+	}
+	if (threads < 1)
+		threads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+	if (threads < 1)
+		threads = 1;
+	if ((size_t) threads > count / UCPCAL_RENDER_MIN_SLICE + 1)
+		threads = (int) (count / UCPCAL_RENDER_MIN_SLICE) + 1;
+	slices = (ucpcal_slice *) malloc(threads * sizeof(ucpcal_slice));
+	ids = (pthread_t *) malloc(threads * sizeof(pthread_t));
+	started = (int *) malloc(threads * sizeof(int));
+	for (i = 0; i < threads; i++) {
+		slices[i].nodes = nodes + count / threads * i;
+		slices[i].count = i < threads - 1 ?
+			count / threads : count - count / threads * i;
+		slices[i].text = NULL;
+		slices[i].length = 0;
+		slices[i].arena = ucpcal_arena_new();
+	}
+	/*
+		As when loading, the calling thread takes the first slice, and
+		renders any slice whose thread cannot be started.
+	*/
+	for (i = 1; i < threads; i++)
+		started[i] = !pthread_create(
+			&ids[i],
+			NULL,
+			ucpcal_slice_render,
+			&slices[i]
+		);
+	ucpcal_slice_render(&slices[0]);
+	for (i = 1; i < threads; i++) {
+		if (started[i])
+			pthread_join(ids[i], NULL);
+		else
+			ucpcal_slice_render(&slices[i]);
+	}
+	for (i = 0; i < threads; i++)
+		size += slices[i].length;
+	result = (char *) malloc(size);
+	/* Each slice goes after the total length of those before it. */
+	for (i = 0; i < threads; i++) {
+		memcpy(result + offset, slices[i].text, slices[i].length);
+		offset += slices[i].length;
+		free(slices[i].text);
+		/* The list takes over the text cached by each thread. */
+		ucpcal_arena_adopt(list->arena, slices[i].arena);
+		ucpcal_arena_free(slices[i].arena);
+	}
+	result[offset] = 0;
+	ucpcal_tree_update_subtree(list->times->root);
+	free(started);
+	free(ids);
+	free(slices);
+	free(nodes);
+	return result;
+}
+
+void *ucpcal_slice_render(void *slice) {
+	ucpcal_slice *s = (ucpcal_slice *) slice;
+	size_t size = 1, i, length;
+	for (i = 0; i < s->count; i++)
+		size += ucpcal_render_node_size(s->nodes[i]);
+	s->text = (char *) malloc(size);
+	s->text[0] = 0;
+	for (i = 0; i < s->count; i++) {
+		length = ucpcal_render_node(
+			s->text + s->length,
+			s->nodes[i],
+			s->arena
+		);
+		s->nodes[i]->when.weight = s->nodes[i]->text_characters;
+		s->length += length;
+	}
+	return NULL;
+}
+
+ucpcal_page ucpcal_page_first(ucpcal_list *list) {
+	ucpcal_node *first = ucpcal_tree_first(list->times);
+	ucpcal_page result;
+	result.start = first ? first->when.start : 0;
+	result.skip = 0;
+	return result;
+}
+
+ucpcal_window ucpcal_page_window(ucpcal_list *list, ucpcal_time from) {
+	ucpcal_node *last = ucpcal_tree_last(list->times);
+	ucpcal_time to = from;
+	if (last && last->when.start + UCPCAL_RENDER_HORIZON > from)
+		to = last->when.start + UCPCAL_RENDER_HORIZON;
+	return ucpcal_list_window(
+		list,
+		ucpcal_time_to_date(from),
+		ucpcal_time_to_date(to)
+	);
+}
+
+const ucpcal_event *ucpcal_page_next(
+	ucpcal_window *window,
+	ucpcal_page *after
+) {
+	const ucpcal_event *result = ucpcal_window_next(window);
+	ucpcal_time start;
+	if (result) {
+		start = ucpcal_time_from_date(result->date);
+		if (start != after->start) {
+			after->start = start;
+			after->skip = 0;
+		}
+		after->skip++;
+	}
+	return result;
+}
+
+ucpcal_page ucpcal_page_forward(
+	ucpcal_list *list,
+	ucpcal_page page,
+	unsigned long count
+) {
+	ucpcal_window window = ucpcal_page_window(list, page.start);
+	ucpcal_page result = page, after;
+	unsigned long shown = 0;
+	int done = 0;
+	after.start = page.start;
+	after.skip = 0;
+	/* Stay on the last page rather than showing nothing. */
+	while (!done && ucpcal_page_next(&window, &after)) {
+		/* Occurrences at the page's time may come before it. */
+		if (
+			(after.start != page.start || after.skip > page.skip) &&
+			shown++ == count
+		) {
+			/* The position is just after the occurrence. */
+			result.start = after.start;
+			result.skip = after.skip - 1;
+			done = 1;
+		}
+	}
+	ucpcal_window_free(&window);
+	return result;
+}
+
+ucpcal_page ucpcal_page_back(
+	ucpcal_list *list,
+	ucpcal_page page,
+	unsigned long count
+) {
+	ucpcal_node *first = ucpcal_tree_first(list->times);
+	ucpcal_page result = page, after, *ring;
+	ucpcal_window window;
+	ucpcal_time span = 60, from;
+	unsigned long seen;
+	int done;
+	if (first && count && (page.start > first->when.start || page.skip)) {
+		ring = (ucpcal_page *) malloc(count * sizeof(ucpcal_page));
+		/* No occurrence comes before the first event. */
+		do {
+			from = page.start - first->when.start > span ?
+				page.start - span :
+				first->when.start;
+			span *= 2;
+			window = ucpcal_page_window(list, from);
+			after.start = from;
+			after.skip = 0;
+			seen = 0;
+			done = 0;
+			while (!done && ucpcal_page_next(&window, &after)) {
+				/* Stop at the first occurrence on the page. */
+				done = after.start > page.start || (
+					after.start == page.start &&
+					after.skip > page.skip
+				);
+				if (!done)
+					ring[seen++ % count] = after;
+			}
+			ucpcal_window_free(&window);
+		} while (seen < count && from > first->when.start);
+		/* Each position is just after its occurrence. */
+		if (seen) {
+			result = ring[seen < count ? 0 : seen % count];
+			result.skip--;
+		}
+		free(ring);
+	}
+	return result;
+}
+
+char *ucpcal_render_occurrences(
+	ucpcal_list *list,
+	ucpcal_page page,
+	unsigned long count
+) {
+	ucpcal_window window = ucpcal_page_window(list, page.start);
+	const ucpcal_event *event;
+	ucpcal_page after;
+	size_t size = 1024, length = 0, needed;
+	unsigned long shown = 0;
+	char *result = (char *) malloc(size);
+	*result = 0;
+	after.start = page.start;
+	after.skip = 0;
+	while (shown < count && (event = ucpcal_page_next(&window, &after))) {
+		/* Occurrences at the page's time may come before it. */
+		if (after.start != page.start || after.skip > page.skip) {
+			needed = window.node ?
+				ucpcal_render_node_size(window.node) :
+				ucpcal_render_event_size(event);
+			while (length + needed > size) {
+				size *= 2;
+				result = (char *) realloc(result, size);
+			}
+			/* Occurrences of recurring events have no node. */
+			length += window.node ?
+				ucpcal_render_node(
+					result + length,
+					window.node,
+					list->arena
+				) :
+				ucpcal_render_event(result + length, event);
+			shown++;
+		}
+	}
+	ucpcal_window_free(&window);
+	return result;
+}
+
+char *ucpcal_render_page(
+	ucpcal_list *list,
+	ucpcal_page *page,
+	unsigned long count
+) {
+	char *result = ucpcal_render_occurrences(list, *page, count);
+	ucpcal_page back;
+	if (!*result) {
+		/* Show the last page rather than nothing. */
+		back = ucpcal_page_back(list, *page, count);
+		if (back.start != page->start || back.skip != page->skip) {
+			free(result);
+			*page = back;
+			result = ucpcal_render_occurrences(list, back, count);
+		}
+	}
+	return result;
+}
+
+size_t ucpcal_render_event_size(const ucpcal_event *event) {
+	/* Start with enough to hold a null terminator. */
+	size_t size = 1;
+	/*
+		This would be a lot easier with the snprintf(0) trick
+		that does nothing but returns the buffer size required,
+		but alas we do not have ISO C99 available in this unit.
+	*/
+	/* Add enough for the event name. */
+	size += ucpcal_string_length(event->name);
+	/* Add enough for " @ ". */
+	size += 3;
+	/* Add enough for the event location. */
+	size += event->location ? ucpcal_string_length(event->location) : 0;
+	/* Add enough for " (". */
+	size += 2;
+	/* Add enough for the worst case friendly duration. */
+	size += UCPCAL_FRIENDLY_SIZE;
+	/* Add enough for ")\n". */
+	size += 2;
+	/* Add enough for the worst case friendly date and time. */
+	size += UCPCAL_FRIENDLY_SIZE;
+	/* Add enough for "\n---\n\n". */
+	size += 6;
+	return size;
+}
+
+size_t ucpcal_render_event(char *buffer, const ucpcal_event *event) {
+	/*
+		Piece the text together directly rather than with sprintf(),
+		which is much slower and, through the static buffers of the
+		friendly strings, not reentrant.
+	*/
+	size_t length = ucpcal_string_length(event->name), size;
+	memcpy(buffer, event->name, length);
+	if (event->location) {
+		length += ucpcal_text_format(buffer + length, " @ ");
+		size = ucpcal_string_length(event->location);
+		memcpy(buffer + length, event->location, size);
+		length += size;
+	}
+	length += ucpcal_text_format(buffer + length, " (");
+	length += ucpcal_duration_format(buffer + length, event->duration);
+	length += ucpcal_text_format(buffer + length, ")\n");
+	length += ucpcal_date_format(buffer + length, event->date);
+	length += ucpcal_text_format(buffer + length, "\n---\n\n");
+	buffer[length] = 0;
+	return length;
+}
+
+size_t ucpcal_render_node_size(const ucpcal_node *node) {
+	return node->text ?
+		node->text_length + 1 :
+		ucpcal_render_event_size(node->event);
+}
+
+size_t ucpcal_render_node(
+	char *buffer,
+	ucpcal_node *node,
+	ucpcal_arena *arena
+) {
+	size_t length;
+	if (node->text) {
+		length = node->text_length;
+		memcpy(buffer, node->text, length + 1);
+	} else {
+		length = ucpcal_render_event(buffer, node->event);
+		if (arena) {
+			node->text = ucpcal_arena_string(arena, buffer, length);
+			node->text_length = length;
+			node->text_characters = ucpcal_render_characters(
+				buffer,
+				length
+			);
+		}
+	}
+	return length;
+}
+
+unsigned long ucpcal_render_characters(const char *text, size_t length) {
+	unsigned long result = 0;
+	size_t i;
+	/* Every UTF-8 character has one byte that is not a continuation. */
+	for (i = 0; i < length; i++)
+		if (((unsigned char) text[i] & 0xc0) != 0x80)
+			result++;
+	return result;
+}
@@ -0,0 +1,309 @@
+/**
+ * @file render.h
+ * @brief Algorithms for rendering calendars as text for display.
+ */
+
+#ifndef UCPCAL_RENDER_H
+#define UCPCAL_RENDER_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "date.h"
+#include "event.h"
+#include "list.h"
+#include "tree.h"
+
+/**
+ * @brief How far past the last event in a calendar its recurring events are
+ * shown, in minutes.
+ */
+
+#define UCPCAL_RENDER_HORIZON (366L * 24 * 60)
+
+/**
+ * @brief Builds a heap allocated string from a calendar for the GUI to show.
+ * The length of each event's text, in characters, is stored as its weight in
+ * the list's index of start times, so that the offset of any event's text
+ * can be found with ucpcal_tree_offset() when it changes later. Each event's
+ * text is also cached in its node, so rendering the calendar again is mostly
+ * a matter of copying the text of the events that have not changed.
+ * If any event recurs, the calendar is rendered with ucpcal_render_window()
+ * instead, up to UCPCAL_RENDER_HORIZON after the last event, and the weights
+ * are left alone, since occurrences come between the events.
+ * Be sure to use free() when finished.
+ * @param list the linked list of calendar events
+ * @return a heap allocated string with GUI calendar output
+ */
+
+char *ucpcal_render_list(ucpcal_list *list);
+
+/**
+ * @brief Builds a heap allocated string from the occurrences of the events
+ * in a calendar that start in a range of times.
+ * The occurrences come from ucpcal_list_window(), so recurring events are
+ * expanded as they are rendered rather than stored. The text of events that
+ * do not recur is cached in their nodes, as by ucpcal_render_list().
+ * Be sure to use free() when finished.
+ * @param list the linked list of calendar events
+ * @param from the start of the range, inclusive
+ * @param to the end of the range, exclusive
+ * @return a heap allocated string with GUI calendar output
+ */
+
+char *ucpcal_render_window(
+	ucpcal_list *list,
+	ucpcal_time from,
+	ucpcal_time to
+);
+
+/**
+ * @brief A data structure representing one thread's share of a parallel
+ * render: a run of consecutive events and the text rendered for them.
+ */
+
+typedef struct ucpcal_slice {
+	/**
+	 * The nodes of the events, in order of start time.
+	 */
+	ucpcal_node **nodes;
+	size_t count;
+	/**
+	 * The text of the events, in a heap allocated buffer of the slice's
+	 * own, or NULL until rendered.
+	 */
+	char *text;
+	/**
+	 * The number of bytes of text, excluding the null terminator.
+	 */
+	size_t length;
+	/**
+	 * The arena to cache the text of each event in, which the list adopts
+	 * once every slice is rendered.
+	 */
+	ucpcal_arena *arena;
+} ucpcal_slice;
+
+/**
+ * @brief Builds a heap allocated string from a calendar using many threads.
+ * The events are split into runs of consecutive events, one for each
+ * thread, and each thread measures and renders its run into a buffer of its
+ * own. The buffers are then joined in order, each at the sum of the lengths
+ * before it. The result, and the weights left in the list's index of start
+ * times, are the same as from ucpcal_render_list() for a calendar in which
+ * no event recurs. Recurring events are only shown at their own dates, so
+ * render any other calendar with ucpcal_render_list().
+ * Be sure to use free() when finished.
+ * @param list the linked list of calendar events
+ * @param threads the number of threads to use, or zero for one per online
+ * processor
+ * @return a heap allocated string with GUI calendar output
+ */
+
+char *ucpcal_render_parallel(ucpcal_list *list, int threads);
+
+/**
+ * @brief Renders the events of a slice into a buffer of its own.
+ * Each event's length in characters is stored as its weight, as by
+ * ucpcal_render_list(), but the totals of the index's subtrees are left for
+ * the caller to update. Only touches the slice and its nodes, so separate
+ * slices can be rendered on separate threads.
+ * @param slice pointer to the ucpcal_slice to render, as a void pointer for
+ * pthread_create()
+ * @return NULL
+ */
+
+void *ucpcal_slice_render(void *slice);
+
+/**
+ * @brief A data structure representing where a page of a calendar starts,
+ * as a position among the occurrences produced by ucpcal_list_window().
+ * A page is a number of occurrences rather than of events, so a recurring
+ * event shows up on a page as often as it occurs there, and no page holds
+ * more than its size however often events recur. Positions are times
+ * rather than nodes, so they stay meaningful while events are added, edited
+ * and deleted, though those at the same time as the page may shift by one.
+ */
+
+typedef struct ucpcal_page {
+	/**
+	 * The start time of the first occurrence on the page, in minutes since
+	 * the Unix epoch.
+	 */
+	ucpcal_time start;
+	/**
+	 * The number of occurrences starting at the same time that come before
+	 * the page.
+	 */
+	unsigned long skip;
+} ucpcal_page;
+
+/**
+ * @brief Finds where the first page of a calendar starts.
+ * @param list the linked list of calendar events
+ * @return the position of the first occurrence, or of the Unix epoch if the
+ * calendar is empty
+ */
+
+ucpcal_page ucpcal_page_first(ucpcal_list *list);
+
+/**
+ * @brief Starts iterating over the occurrences of the events in a calendar
+ * from a time onwards, up to UCPCAL_RENDER_HORIZON after the last event, as
+ * ucpcal_render_list() shows them.
+ * Be sure to use ucpcal_window_free() when finished.
+ * @param list the linked list of calendar events
+ * @param from the start of the range, inclusive
+ * @return the iterator
+ */
+
+ucpcal_window ucpcal_page_window(ucpcal_list *list, ucpcal_time from);
+
+/**
+ * @brief Produces the next occurrence in a window, keeping track of its
+ * position.
+ * @param window the iterator, from ucpcal_page_window()
+ * @param after the position just after the occurrence produced last, which
+ * must start out at the window's start time with nothing skipped, and is
+ * moved to just after the occurrence produced
+ * @return the occurrence, as from ucpcal_window_next(), or NULL when there
+ * are no more
+ */
+
+const ucpcal_event *ucpcal_page_next(
+	ucpcal_window *window,
+	ucpcal_page *after
+);
+
+/**
+ * @brief Finds where the page after a page of a calendar starts.
+ * @param list the linked list of calendar events
+ * @param page where the page starts
+ * @param count the number of occurrences on each page
+ * @return the position of the occurrence following the page, or the page
+ * itself if the page is the last
+ */
+
+ucpcal_page ucpcal_page_forward(
+	ucpcal_list *list,
+	ucpcal_page page,
+	unsigned long count
+);
+
+/**
+ * @brief Finds where the page before a page of a calendar starts.
+ * Windows cannot be walked backwards, so one is started at a time before the
+ * page and walked up to it, remembering the positions of the last count
+ * occurrences. The time is tried nearer the page first, then twice as far
+ * back each time too few occurrences are found, so the occurrences walked
+ * are not many more than the page holds, however far back the calendar goes.
+ * @param list the linked list of calendar events
+ * @param page where the page starts
+ * @param count the number of occurrences on each page
+ * @return the position count occurrences before the page, or of the first
+ * occurrence if there are fewer, or the page itself if there are none
+ */
+
+ucpcal_page ucpcal_page_back(
+	ucpcal_list *list,
+	ucpcal_page page,
+	unsigned long count
+);
+
+/**
+ * @brief Builds a heap allocated string from the occurrences following a
+ * position in a calendar, as ucpcal_render_window() does for a range.
+ * @param list the linked list of calendar events
+ * @param page the position of the first occurrence to show
+ * @param count the most occurrences to show
+ * @return the string; its memory must be freed by the caller
+ */
+
+char *ucpcal_render_occurrences(
+	ucpcal_list *list,
+	ucpcal_page page,
+	unsigned long count
+);
+
+/**
+ * @brief Builds a heap allocated string from one page of a calendar.
+ * Only the occurrences on the page are rendered, and those before it at the
+ * same time walked past, so the time taken and the memory needed depend on
+ * the size of the page rather than of the calendar, however often its events
+ * recur. The text of events that do not recur is cached in their nodes as by
+ * ucpcal_render_list(), so paging back and forth formats them only once.
+ * A page past the last occurrence is moved back to show the last page rather
+ * than nothing.
+ * @param list the linked list of calendar events
+ * @param page where the page starts, which is moved if the page is past the
+ * last occurrence
+ * @param count the number of occurrences on each page
+ * @return the string; its memory must be freed by the caller
+ */
+
+char *ucpcal_render_page(
+	ucpcal_list *list,
+	ucpcal_page *page,
+	unsigned long count
+);
+
+/**
+ * @brief Calculates how much room the text for an event may need.
+ * @param event the event to be rendered
+ * @return an upper bound on the bytes written by ucpcal_render_event(),
+ * including the null terminator
+ */
+
+size_t ucpcal_render_event_size(const ucpcal_event *event);
+
+/**
+ * @brief Writes the text for one event, as it appears in the whole calendar.
+ * Safe to call from any number of threads at once.
+ * @param buffer where to write, with room for at least
+ * ucpcal_render_event_size() bytes
+ * @param event the event to render
+ * @return the number of bytes written, excluding the null terminator
+ */
+
+size_t ucpcal_render_event(char *buffer, const ucpcal_event *event);
+
+/**
+ * @brief Calculates how much room the text for a node's event may need.
+ * @param node the node whose event is to be rendered
+ * @return the bytes written by ucpcal_render_node(), including the null
+ * terminator, if the text is cached, or else an upper bound on them
+ */
+
+size_t ucpcal_render_node_size(const ucpcal_node *node);
+
+/**
+ * @brief Writes the text for a node's event, from its cache if it has one.
+ * Otherwise, the event is rendered and, given an arena, its text is cached
+ * in the node, along with its length in bytes and characters, until the
+ * event next changes.
+ * @param buffer where to write, with room for at least
+ * ucpcal_render_node_size() bytes
+ * @param node the node whose event is to be rendered
+ * @param arena the arena to cache the text in, which must belong to the
+ * node's list or be adopted by it later, or NULL to leave it uncached
+ * @return the number of bytes written, excluding the null terminator
+ */
+
+size_t ucpcal_render_node(
+	char *buffer,
+	ucpcal_node *node,
+	ucpcal_arena *arena
+);
+
+/**
+ * @brief Counts the characters in some UTF-8 text, as the GUI counts them.
+ * @param text the start of the text
+ * @param length the number of bytes in the text
+ * @return the number of characters
+ */
+
+unsigned long ucpcal_render_characters(const char *text, size_t length);
+
+#endif
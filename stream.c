@@ -0,0 +1,199 @@
+/**
+ * @file stream.c
+ * @brief Data structures and algorithms for streaming calendar files.
+ */
+
+#include "stream.h"
+
+ucpcal_stream *ucpcal_stream_new(const char *filename) {
+	ucpcal_stream *stream = NULL;
+	/* Text mode, for the same reasons as in ucpcal_load(). */
+	FILE *f = fopen(filename, "r");
+	if (f) {
+		stream = (ucpcal_stream *) malloc(sizeof(ucpcal_stream));
+		stream->f = f;
+		stream->reader = ucpcal_reader_new(f);
+		stream->event.rule = NULL;
+		stream->name = NULL;
+		stream->name_size = 0;
+		stream->location = NULL;
+		stream->location_size = 0;
+		stream->error = NULL;
+		stream->line = 0;
+		stream->column = 0;
+	}
+	return stream;
+}
+
+void ucpcal_stream_free(ucpcal_stream *stream) {
+	if (stream) {
+		ucpcal_reader_free(stream->reader);
+		fclose(stream->f);
+		ucpcal_rule_free(stream->event.rule);
+		free(stream->name);
+		free(stream->location);
+		free(stream);
+	}
+}
+
+const ucpcal_event *ucpcal_stream_next(ucpcal_stream *stream) {
+	const ucpcal_event *result = NULL;
+	ucpcal_event *event = &stream->event;
+	ucpcal_reader *reader = stream->reader;
+	const char *name, *rule;
+	char *line;
+	size_t length;
+	if (!stream->error) {
+		/* Skip any blank lines before the record. */
+		line = ucpcal_reader_line(reader, &length);
+		while (line && ucpcal_is_blank(line, line + length))
+			line = ucpcal_reader_line(reader, &length);
+		if (line) {
+			name = ucpcal_parse_header(
+				line,
+				line + length,
+				&event->date,
+				&event->duration,
+				&stream->error
+			);
+			if (stream->error) {
+				stream->line = reader->line;
+				stream->column =
+					(unsigned long) (name - line) + 1;
+			} else {
+				event->name = ucpcal_stream_copy(
+					&stream->name,
+					&stream->name_size,
+					name,
+					line + length - name
+				);
+				event->location = NULL;
+				event->arena = NULL;
+				event->borrowed = 1;
+				ucpcal_rule_free(event->rule);
+				event->rule = NULL;
+				line = ucpcal_reader_line(reader, &length);
+				/* A recurring event's rule comes first. */
+				rule = line ? ucpcal_rule_line(
+					line,
+					line + length,
+					&stream->error
+				) : NULL;
+				if (stream->error) {
+					stream->line = reader->line;
+					stream->column = (unsigned long) (
+						rule - line
+					) + 1;
+				} else if (rule) {
+					event->rule = ucpcal_rule_parse(
+						NULL,
+						rule,
+						line + length
+					);
+					line = ucpcal_reader_line(
+						reader,
+						&length
+					);
+				}
+				if (!stream->error && line && length > 0) {
+					event->location = ucpcal_stream_copy(
+						&stream->location,
+						&stream->location_size,
+						line,
+						length
+					);
+					/* Discard the following blank line. */
+					ucpcal_reader_line(reader, &length);
+				}
+				if (!stream->error)
+					result = event;
+			}
+		}
+	}
+	return result;
+}
+
+char *ucpcal_stream_copy(
+	char **buffer,
+	size_t *size,
+	const char *text,
+	size_t length
+) {
+	if (length + 1 > *size) {
+		*size = length + 1 > 256 ? length + 1 : 256;
+		free(*buffer);
+		*buffer = (char *) malloc(*size);
+	}
+	memcpy(*buffer, text, length);
+	(*buffer)[length] = 0;
+	return *buffer;
+}
+
+ucpcal_filter ucpcal_filter_all(void) {
+	ucpcal_filter filter;
+	filter.has_from = 0;
+	filter.from = 0;
+	filter.has_to = 0;
+	filter.to = 0;
+	filter.name = NULL;
+	filter.location = NULL;
+	return filter;
+}
+
+int ucpcal_filter_match(
+	const ucpcal_filter *filter,
+	const ucpcal_event *event
+) {
+	ucpcal_time start = ucpcal_time_from_date(event->date);
+	return (!filter->has_from || start >= filter->from) &&
+		(!filter->has_to || start < filter->to) &&
+		(
+			!filter->name ||
+			ucpcal_string_contains(event->name, filter->name)
+		) && (
+			!filter->location || (
+				event->location &&
+				ucpcal_string_contains(
+					event->location,
+					filter->location
+				)
+			)
+		);
+}
+
+int ucpcal_filter_file(
+	const ucpcal_filter *filter,
+	const char *from,
+	const char *to
+) {
+	ucpcal_stream *stream = ucpcal_stream_new(from);
+	ucpcal_writer *writer = NULL;
+	const ucpcal_event *event;
+	int result = 1;
+	if (!stream)
+		fprintf(stderr, "%s: cannot open file\n", from);
+	else if (!strcmp(to, "-"))
+		writer = ucpcal_writer_new_fd(1);
+	else
+		writer = ucpcal_writer_new(to);
+	if (stream && !writer)
+		fprintf(stderr, "%s: cannot write file\n", to);
+	if (writer) {
+		while ((event = ucpcal_stream_next(stream)))
+			if (ucpcal_filter_match(filter, event))
+				ucpcal_save_event(writer, event);
+		if (stream->error)
+			fprintf(stderr,
+				"%s:%lu:%lu: %s\n",
+				from,
+				stream->line,
+				stream->column,
+				stream->error
+			);
+		result = ucpcal_writer_commit(writer) || stream->error;
+		if (result && !stream->error)
+			fprintf(stderr, "%s: cannot write file\n", to);
+	}
+	ucpcal_stream_free(stream);
+	return result;
+}
@@ -0,0 +1,163 @@
+/**
+ * @file stream.h
+ * @brief Data structures and algorithms for streaming calendar files.
+ */
+
+#ifndef UCPCAL_STREAM_H
+#define UCPCAL_STREAM_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "date.h"
+#include "event.h"
+#include "file.h"
+#include "reader.h"
+#include "writer.h"
+
+/**
+ * @brief A data structure for iterating over the records of a calendar file.
+ * Only one event is held at a time, in buffers that are reused from one
+ * record to the next, so a file of any size can be read in memory bounded
+ * by its longest line rather than its length.
+ */
+
+typedef struct ucpcal_stream {
+	FILE *f;
+	ucpcal_reader *reader;
+	/**
+	 * The current event, whose strings and rule are only valid until the
+	 * next call to ucpcal_stream_next().
+	 */
+	ucpcal_event event;
+	/**
+	 * The buffer holding the name of the current event.
+	 */
+	char *name;
+	size_t name_size;
+	/**
+	 * The buffer holding the location of the current event, if any.
+	 */
+	char *location;
+	size_t location_size;
+	/**
+	 * A description of the malformed record that stopped the stream, or
+	 * NULL if there was none.
+	 */
+	const char *error;
+	/**
+	 * The line and column of the problem, if any.
+	 */
+	unsigned long line;
+	unsigned long column;
+} ucpcal_stream;
+
+/**
+ * @brief A data structure representing a condition on calendar events.
+ * An event matches if it meets every condition that is set.
+ */
+
+typedef struct ucpcal_filter {
+	/**
+	 * Non-zero if events must start at or after from.
+	 */
+	int has_from;
+	ucpcal_time from;
+	/**
+	 * Non-zero if events must start before to.
+	 */
+	int has_to;
+	ucpcal_time to;
+	/**
+	 * Text the name must contain, or NULL.
+	 */
+	const char *name;
+	/**
+	 * Text the location must contain, or NULL. Events without a location
+	 * never match one.
+	 */
+	const char *location;
+} ucpcal_filter;
+
+/**
+ * @brief Opens a calendar file for streaming.
+ * Be sure to use ucpcal_stream_free() when finished.
+ * @param filename the file to stream
+ * @return pointer to new ucpcal_stream struct, or NULL if the file could not
+ * be opened
+ */
+
+ucpcal_stream *ucpcal_stream_new(const char *filename);
+
+/**
+ * @brief Closes a calendar file and frees the memory used for streaming it.
+ * @param stream the stream to be freed, or NULL to do nothing
+ */
+
+void ucpcal_stream_free(ucpcal_stream *stream);
+
+/**
+ * @brief Reads the next event from a calendar file.
+ * Records are read as by ucpcal_load(), one at a time.
+ * @param stream the stream to read from
+ * @return the event, valid until the next call, or NULL at the end of the
+ * file or at a malformed record, in which case the stream's error is set
+ */
+
+const ucpcal_event *ucpcal_stream_next(ucpcal_stream *stream);
+
+/**
+ * @brief Copies a line into one of a stream's reusable buffers.
+ * @param buffer the buffer, which is grown as needed
+ * @param size the number of bytes allocated for the buffer
+ * @param text the start of the line
+ * @param length the number of bytes in the line
+ * @return the null terminated copy
+ */
+
+char *ucpcal_stream_copy(
+	char **buffer,
+	size_t *size,
+	const char *text,
+	size_t length
+);
+
+/**
+ * @brief Creates a filter that every event matches.
+ * @return the filter, to have its conditions set by the caller
+ */
+
+ucpcal_filter ucpcal_filter_all(void);
+
+/**
+ * @brief Checks whether an event matches a filter.
+ * @param filter the filter to check against
+ * @param event the event to check
+ * @return 1 if the event matches, 0 otherwise
+ */
+
+int ucpcal_filter_match(
+	const ucpcal_filter *filter,
+	const ucpcal_event *event
+);
+
+/**
+ * @brief Copies the records of a calendar file that match a filter.
+ * The input is streamed rather than loaded, so files bigger than memory can
+ * be filtered, and the matching records are written in the same format and
+ * order. A malformed record stops the filter after reporting the problem
+ * and where it is on stderr; the matches before it are still written.
+ * @param filter the filter to apply
+ * @param from the calendar file to read
+ * @param to the calendar file to write, or "-" for standard output
+ * @return 0 on success, or 1 if a file could not be read or written or a
+ * record was malformed
+ */
+
+int ucpcal_filter_file(
+	const ucpcal_filter *filter,
+	const char *from,
+	const char *to
+);
+
+#endif
@@ -0,0 +1,394 @@
+/**
+ * @file tree.c
+ * @brief Data structures and algorithms for balanced trees of list nodes.
+ */
+
+#include "tree.h"
+#include "list.h"
+
+ucpcal_tree *ucpcal_tree_new(void) {
+	ucpcal_tree *tree = (ucpcal_tree *) malloc(sizeof(ucpcal_tree));
+	tree->root = NULL;
+	tree->seq = 0;
+	return tree;
+}
+
+void ucpcal_tree_free(ucpcal_tree *tree) {
+	free(tree);
+}
+
+void ucpcal_tree_insert(ucpcal_tree *tree, ucpcal_node *node) {
+	ucpcal_node *parent = NULL, *cur = tree->root;
+	int left = 0;
+	node->when.parent = NULL;
+	node->when.left = NULL;
+	node->when.right = NULL;
+	node->when.height = 1;
+	node->when.start = ucpcal_time_from_date(node->event->date);
+	node->when.end = ucpcal_time_end(
+		node->when.start,
+		node->event->duration
+	);
+	node->when.max_end = node->when.end;
+	node->when.seq = tree->seq++;
+	node->when.weight = 0;
+	node->when.total_weight = 0;
+	/*
+		Every inserted node has the greatest sequence number so far, so
+		it goes after any existing node with the same start time.
+	*/
+	while (cur) {
+		parent = cur;
+		left = node->when.start < cur->when.start;
+		cur = left ? cur->when.left : cur->when.right;
+	}
+	node->when.parent = parent;
+	if (!parent)
+		tree->root = node;
+	else if (left)
+		parent->when.left = node;
+	else
+		parent->when.right = node;
+	ucpcal_tree_rebalance(tree, parent);
+}
+
+void ucpcal_tree_build(
+	ucpcal_tree *tree,
+	ucpcal_node **nodes,
+	size_t count
+) {
+	size_t i;
+	tree->root = ucpcal_tree_build_subtree(nodes, count, NULL);
+	for (i = 0; i < count; i++)
+		if (nodes[i]->when.seq >= tree->seq)
+			tree->seq = nodes[i]->when.seq + 1;
+}
+
+ucpcal_node *ucpcal_tree_build_subtree(
+	ucpcal_node **nodes,
+	size_t count,
+	ucpcal_node *parent
+) {
+	ucpcal_node *root = NULL;
+	size_t middle = count / 2;
+	if (count) {
+		/*
+			Halving the nodes at every level keeps the heights of
+			sibling subtrees within one of each other.
+		*/
+		root = nodes[middle];
+		root->when.parent = parent;
+		root->when.end = ucpcal_time_end(
+			root->when.start,
+			root->event->duration
+		);
+		root->when.weight = 0;
+		root->when.left = ucpcal_tree_build_subtree(
+			nodes,
+			middle,
+			root
+		);
+		root->when.right = ucpcal_tree_build_subtree(
+			nodes + middle + 1,
+			count - middle - 1,
+			root
+		);
+		ucpcal_tree_update(root);
+	}
+	return root;
+}
+
+int ucpcal_tree_compare(const void *a, const void *b) {
+	const ucpcal_node *x = *(ucpcal_node *const *) a;
+	const ucpcal_node *y = *(ucpcal_node *const *) b;
+	int result = ucpcal_time_compare(x->when.start, y->when.start);
+	if (!result)
+		result = (x->when.seq > y->when.seq) - (x->when.seq < y->when.seq);
+	return result;
+}
+
+void ucpcal_tree_remove(ucpcal_tree *tree, ucpcal_node *node) {
+	ucpcal_node *successor, *child, *changed;
+	if (node->when.left && node->when.right) {
+		/*
+			The links are part of the nodes themselves, so rather
+			than swapping payloads, the in-order successor (which has
+			no left child) is moved into the removed node's place.
+		*/
+		successor = node->when.right;
+		while (successor->when.left)
+			successor = successor->when.left;
+		if (successor->when.parent == node) {
+			changed = successor;
+		} else {
+			changed = successor->when.parent;
+			child = successor->when.right;
+			changed->when.left = child;
+			if (child)
+				child->when.parent = changed;
+			successor->when.right = node->when.right;
+			node->when.right->when.parent = successor;
+		}
+		successor->when.left = node->when.left;
+		node->when.left->when.parent = successor;
+		ucpcal_tree_replace(tree, node, successor);
+	} else {
+		/* With at most one child, the child takes its place. */
+		child = node->when.left ? node->when.left : node->when.right;
+		changed = node->when.parent;
+		ucpcal_tree_replace(tree, node, child);
+	}
+	node->when.parent = NULL;
+	node->when.left = NULL;
+	node->when.right = NULL;
+	ucpcal_tree_rebalance(tree, changed);
+}
+
+void ucpcal_tree_set_weight(ucpcal_node *node, unsigned long weight) {
+	node->when.weight = weight;
+	for (; node; node = node->when.parent)
+		ucpcal_tree_update(node);
+}
+
+unsigned long ucpcal_tree_offset(ucpcal_node *node) {
+	unsigned long result = node->when.left ?
+		node->when.left->when.total_weight : 0;
+	ucpcal_node *parent;
+	/*
+		Each ancestor reached from its right subtree comes before the
+		node, along with everything in its left subtree.
+	*/
+	for (; (parent = node->when.parent); node = parent)
+		if (node == parent->when.right)
+			result += parent->when.weight + (
+				parent->when.left ?
+				parent->when.left->when.total_weight : 0
+			);
+	return result;
+}
+
+void ucpcal_tree_update_subtree(ucpcal_node *node) {
+	if (node) {
+		ucpcal_tree_update_subtree(node->when.left);
+		ucpcal_tree_update_subtree(node->when.right);
+		ucpcal_tree_update(node);
+	}
+}
+
+ucpcal_node *ucpcal_tree_first(ucpcal_tree *tree) {
+	ucpcal_node *cur = tree->root;
+	if (cur)
+		while (cur->when.left)
+			cur = cur->when.left;
+	return cur;
+}
+
+ucpcal_node *ucpcal_tree_last(ucpcal_tree *tree) {
+	ucpcal_node *cur = tree->root;
+	if (cur)
+		while (cur->when.right)
+			cur = cur->when.right;
+	return cur;
+}
+
+ucpcal_node *ucpcal_tree_lower_bound(ucpcal_tree *tree, ucpcal_time start) {
+	ucpcal_node *cur = tree->root, *result = NULL;
+	while (cur) {
+		if (cur->when.start >= start) {
+			/* A candidate, but there may be an earlier one. */
+			result = cur;
+			cur = cur->when.left;
+		} else {
+			cur = cur->when.right;
+		}
+	}
+	return result;
+}
+
+ucpcal_node *ucpcal_tree_next(ucpcal_node *node) {
+	ucpcal_node *cur = node->when.right;
+	if (cur) {
+		/* The leftmost node of the right subtree comes next. */
+		while (cur->when.left)
+			cur = cur->when.left;
+	} else {
+		/* Otherwise, climb until we come up from a left subtree. */
+		cur = node;
+		while (cur->when.parent && cur == cur->when.parent->when.right)
+			cur = cur->when.parent;
+		cur = cur->when.parent;
+	}
+	return cur;
+}
+
+ucpcal_node *ucpcal_tree_overlap_first(
+	ucpcal_node *node,
+	ucpcal_time start,
+	ucpcal_time end
+) {
+	ucpcal_node *result = NULL;
+	/* Nothing in this subtree ends after the interval starts. */
+	if (node && node->when.max_end > start) {
+		result = ucpcal_tree_overlap_first(node->when.left, start, end);
+		/*
+			If this node starts too late, so does everything in its
+			right subtree, and the search can stop here.
+		*/
+		if (!result && node->when.start < end) {
+			if (
+				node->when.end > start &&
+				node->when.end > node->when.start
+			)
+				result = node;
+			else
+				result = ucpcal_tree_overlap_first(
+					node->when.right,
+					start,
+					end
+				);
+		}
+	}
+	return result;
+}
+
+ucpcal_node *ucpcal_tree_overlap_next(
+	ucpcal_node *node,
+	ucpcal_time start,
+	ucpcal_time end
+) {
+	ucpcal_node *result = ucpcal_tree_overlap_first(
+		node->when.right,
+		start,
+		end
+	);
+	ucpcal_node *parent;
+	int done = 0;
+	/*
+		Otherwise, climb the tree. Each ancestor reached from its left
+		subtree comes later in order, followed by its right subtree.
+	*/
+	while (!result && !done && node->when.parent) {
+		parent = node->when.parent;
+		if (node == parent->when.left) {
+			if (parent->when.start >= end)
+				/* Everything further on starts too late. */
+				done = 1;
+			else if (
+				parent->when.end > start &&
+				parent->when.end > parent->when.start
+			)
+				result = parent;
+			else
+				result = ucpcal_tree_overlap_first(
+					parent->when.right,
+					start,
+					end
+				);
+		}
+		node = parent;
+	}
+	return result;
+}
+
+void ucpcal_tree_replace(
+	ucpcal_tree *tree,
+	ucpcal_node *old,
+	ucpcal_node *replacement
+) {
+	ucpcal_node *parent = old->when.parent;
+	if (!parent)
+		tree->root = replacement;
+	else if (parent->when.left == old)
+		parent->when.left = replacement;
+	else
+		parent->when.right = replacement;
+	if (replacement)
+		replacement->when.parent = parent;
+}
+
+ucpcal_node *ucpcal_tree_rotate(
+	ucpcal_tree *tree,
+	ucpcal_node *node,
+	int left
+) {
+	ucpcal_node *pivot, *inner;
+	if (left) {
+		pivot = node->when.right;
+		inner = pivot->when.left;
+		node->when.right = inner;
+		pivot->when.left = node;
+	} else {
+		pivot = node->when.left;
+		inner = pivot->when.right;
+		node->when.left = inner;
+		pivot->when.right = node;
+	}
+	if (inner)
+		inner->when.parent = node;
+	ucpcal_tree_replace(tree, node, pivot);
+	node->when.parent = pivot;
+	/* The old root is now below the pivot, so update it first. */
+	ucpcal_tree_update(node);
+	ucpcal_tree_update(pivot);
+	return pivot;
+}
+
+int ucpcal_tree_height(ucpcal_node *node) {
+	return node ? node->when.height : 0;
+}
+
+void ucpcal_tree_update(ucpcal_node *node) {
+	int left = ucpcal_tree_height(node->when.left);
+	int right = ucpcal_tree_height(node->when.right);
+	node->when.height = (left > right ? left : right) + 1;
+	node->when.max_end = node->when.end;
+	if (
+		node->when.left &&
+		node->when.left->when.max_end > node->when.max_end
+	)
+		node->when.max_end = node->when.left->when.max_end;
+	if (
+		node->when.right &&
+		node->when.right->when.max_end > node->when.max_end
+	)
+		node->when.max_end = node->when.right->when.max_end;
+	node->when.total_weight = node->when.weight;
+	if (node->when.left)
+		node->when.total_weight += node->when.left->when.total_weight;
+	if (node->when.right)
+		node->when.total_weight += node->when.right->when.total_weight;
+}
+
+void ucpcal_tree_rebalance(ucpcal_tree *tree, ucpcal_node *node) {
+	ucpcal_node *child;
+	int balance;
+	while (node) {
+		ucpcal_tree_update(node);
+		balance = ucpcal_tree_height(node->when.left) -
+			ucpcal_tree_height(node->when.right);
+		if (balance > 1) {
+			/* Left heavy; straighten a left-right kink first. */
+			child = node->when.left;
+			if (
+				ucpcal_tree_height(child->when.left) <
+				ucpcal_tree_height(child->when.right)
+			)
+				ucpcal_tree_rotate(tree, child, 1);
+			node = ucpcal_tree_rotate(tree, node, 0);
+		} else if (balance < -1) {
+			/* Right heavy; straighten a right-left kink first. */
+			child = node->when.right;
+			if (
+				ucpcal_tree_height(child->when.right) <
+				ucpcal_tree_height(child->when.left)
+			)
+				ucpcal_tree_rotate(tree, child, 0);
+			node = ucpcal_tree_rotate(tree, node, 1);
+		}
+		node = node->when.parent;
+	}
+}
+
+void ucpcal_tree_empty(ucpcal_tree *tree) {
+	tree->root = NULL;
+}
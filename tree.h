@@ -0,0 +1,317 @@
+/**
+ * @file tree.h
+ * @brief Data structures and algorithms for balanced trees of list nodes.
+ */
+
+#ifndef UCPCAL_TREE_H
+#define UCPCAL_TREE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "event.h"
+
+/*
+	The tree is intrusive: its links are embedded in each linked list node
+	so that indexing an event needs no allocation of its own. list.h needs
+	to include this header for that, so the node structure can only be
+	declared incompletely here.
+*/
+struct ucpcal_node;
+
+/**
+ * @brief A data structure representing the tree links of a list node.
+ * Nodes are ordered by the start time of their event, then by the order in
+ * which they were inserted, so that events starting at the same time keep a
+ * stable order. Each node also records the latest end time in its subtree,
+ * which makes the tree an interval tree over [start, start + duration), and
+ * the total weight of its subtree, which gives the position of any node in
+ * a sequence of variable length items laid out in the tree's order.
+ */
+
+typedef struct ucpcal_tree_link {
+	struct ucpcal_node *parent;
+	struct ucpcal_node *left;
+	struct ucpcal_node *right;
+	/**
+	 * The height of the subtree rooted at this node, where a leaf is 1.
+	 */
+	int height;
+	/**
+	 * The start time of the event when it was inserted, in minutes since
+	 * the Unix epoch.
+	 */
+	ucpcal_time start;
+	/**
+	 * The end time of the event when it was inserted, which is its start
+	 * time plus its duration.
+	 */
+	ucpcal_time end;
+	/**
+	 * The latest end time of any node in the subtree rooted at this node.
+	 */
+	ucpcal_time max_end;
+	/**
+	 * The insertion sequence number, used to break ties between events
+	 * with the same start time.
+	 */
+	unsigned long seq;
+	/**
+	 * The weight of the node, such as the length of the event's text in
+	 * a rendering of the list, which is zero until set.
+	 */
+	unsigned long weight;
+	/**
+	 * The total weight of the subtree rooted at this node.
+	 */
+	unsigned long total_weight;
+} ucpcal_tree_link;
+
+/**
+ * @brief A data structure representing an AVL tree of list nodes.
+ * The heights of any node's two subtrees differ by at most one, so the tree
+ * is always balanced and lookups, insertions and removals are O(log n).
+ */
+
+typedef struct ucpcal_tree {
+	struct ucpcal_node *root;
+	/**
+	 * The sequence number to give the next inserted node.
+	 */
+	unsigned long seq;
+} ucpcal_tree;
+
+/**
+ * @brief Creates a new, empty tree on the heap.
+ * Be sure to use ucpcal_tree_free() when finished.
+ * @return pointer to new ucpcal_tree struct
+ */
+
+ucpcal_tree *ucpcal_tree_new(void);
+
+/**
+ * @brief Frees the memory used for a tree struct.
+ * The nodes in the tree are not freed.
+ * @param tree the tree to be freed
+ */
+
+void ucpcal_tree_free(ucpcal_tree *tree);
+
+/**
+ * @brief Inserts a node into a tree, keyed on its event's start time.
+ * @param tree the tree to insert into
+ * @param node the node to insert, which must not already be in a tree
+ */
+
+void ucpcal_tree_insert(ucpcal_tree *tree, struct ucpcal_node *node);
+
+/**
+ * @brief Builds a tree from scratch out of nodes already in order.
+ * Takes O(n) time, rather than the O(n log n) of inserting the nodes one at
+ * a time, and visits them in memory order rather than at random. Each node's
+ * links must already hold its start time and sequence number, which must be
+ * in ascending order and at least as great as any previously inserted.
+ * @param tree the tree to build, which must be empty
+ * @param nodes the nodes to build the tree from, in ascending order
+ * @param count the number of nodes
+ */
+
+void ucpcal_tree_build(
+	ucpcal_tree *tree,
+	struct ucpcal_node **nodes,
+	size_t count
+);
+
+/**
+ * @brief Builds a balanced subtree out of nodes already in order.
+ * @param nodes the nodes to build the subtree from, in ascending order
+ * @param count the number of nodes
+ * @param parent the parent of the new subtree, or NULL
+ * @return the root of the new subtree, or NULL if count is zero
+ */
+
+struct ucpcal_node *ucpcal_tree_build_subtree(
+	struct ucpcal_node **nodes,
+	size_t count,
+	struct ucpcal_node *parent
+);
+
+/**
+ * @brief Compares two nodes by their order in a tree, for qsort().
+ * @param a pointer to the first node pointer
+ * @param b pointer to the second node pointer
+ * @return a negative, zero or positive value where the first node comes
+ * before, at the same place as or after the second respectively
+ */
+
+int ucpcal_tree_compare(const void *a, const void *b);
+
+/**
+ * @brief Removes a node from a tree.
+ * The node's event may have changed since it was inserted, as the tree only
+ * relies on the key stored in the node's links.
+ * @param tree the tree to remove from
+ * @param node the node to remove
+ */
+
+void ucpcal_tree_remove(ucpcal_tree *tree, struct ucpcal_node *node);
+
+/**
+ * @brief Sets the weight of a node in a tree.
+ * The totals of its ancestors are updated, in O(log n) time.
+ * @param node the node to weigh
+ * @param weight the new weight
+ */
+
+void ucpcal_tree_set_weight(struct ucpcal_node *node, unsigned long weight);
+
+/**
+ * @brief Finds the total weight of the nodes before a node in a tree.
+ * Runs in O(log n) time.
+ * @param node the node to find the position of
+ * @return the sum of the weights of every node before it in order
+ */
+
+unsigned long ucpcal_tree_offset(struct ucpcal_node *node);
+
+/**
+ * @brief Recomputes everything stored for a whole subtree.
+ * Used after setting the weights of many nodes directly, which is cheaper
+ * than setting them one by one with ucpcal_tree_set_weight().
+ * @param node the root of the subtree, or NULL to do nothing
+ */
+
+void ucpcal_tree_update_subtree(struct ucpcal_node *node);
+
+/**
+ * @brief Finds the earliest node in a tree.
+ * @param tree the tree to search through
+ * @return the node with the earliest start time, or NULL if the tree is empty
+ */
+
+struct ucpcal_node *ucpcal_tree_first(ucpcal_tree *tree);
+
+/**
+ * @brief Finds the node with the latest start time in a tree.
+ * @param tree the tree to search through
+ * @return the node with the latest start time, or NULL if the tree is empty
+ */
+
+struct ucpcal_node *ucpcal_tree_last(ucpcal_tree *tree);
+
+/**
+ * @brief Finds the earliest node starting at or after a given time.
+ * @param tree the tree to search through
+ * @param start the time in minutes since the Unix epoch
+ * @return the first such node, or NULL if there is no such node
+ */
+
+struct ucpcal_node *ucpcal_tree_lower_bound(
+	ucpcal_tree *tree,
+	ucpcal_time start
+);
+
+/**
+ * @brief Finds the node following another in a tree's order.
+ * @param node the node to start from
+ * @return the next node, or NULL if node is the last
+ */
+
+struct ucpcal_node *ucpcal_tree_next(struct ucpcal_node *node);
+
+/**
+ * @brief Finds the earliest node in a subtree overlapping a time interval.
+ * Intervals are half open, so an event ending at the very minute another
+ * starts does not overlap it, and an event with no duration overlaps
+ * nothing. Subtrees whose latest end time is too early are skipped.
+ * @param node the root of the subtree to search, or NULL
+ * @param start the start of the interval, in minutes since the Unix epoch
+ * @param end the end of the interval, in minutes since the Unix epoch
+ * @return the first overlapping node, or NULL if there is no such node
+ */
+
+struct ucpcal_node *ucpcal_tree_overlap_first(
+	struct ucpcal_node *node,
+	ucpcal_time start,
+	ucpcal_time end
+);
+
+/**
+ * @brief Finds the next node after another overlapping a time interval.
+ * @param node the node to start from, which is not itself considered
+ * @param start the start of the interval, in minutes since the Unix epoch
+ * @param end the end of the interval, in minutes since the Unix epoch
+ * @return the next overlapping node, or NULL if there is no such node
+ */
+
+struct ucpcal_node *ucpcal_tree_overlap_next(
+	struct ucpcal_node *node,
+	ucpcal_time start,
+	ucpcal_time end
+);
+
+/**
+ * @brief Finds the height of the subtree rooted at a node.
+ * @param node the root of the subtree, or NULL
+ * @return the height of the subtree, which is 0 for an empty subtree
+ */
+
+int ucpcal_tree_height(struct ucpcal_node *node);
+
+/**
+ * @brief Recalculates the information a node keeps about its subtree.
+ * The node's children must already be up to date.
+ * @param node the node to update
+ */
+
+void ucpcal_tree_update(struct ucpcal_node *node);
+
+/**
+ * @brief Puts one node in another's place under the other's parent.
+ * Only the links between the parent and the two nodes are changed.
+ * @param tree the tree containing the nodes
+ * @param old the node currently in place
+ * @param replacement the node to take its place, or NULL
+ */
+
+void ucpcal_tree_replace(
+	ucpcal_tree *tree,
+	struct ucpcal_node *old,
+	struct ucpcal_node *replacement
+);
+
+/**
+ * @brief Rotates the subtree rooted at a node.
+ * A left rotation makes the node's right child the root of the subtree, and
+ * a right rotation does the same with its left child.
+ * @param tree the tree containing the node
+ * @param node the root of the subtree to rotate
+ * @param left non-zero to rotate left, zero to rotate right
+ * @return the new root of the subtree
+ */
+
+struct ucpcal_node *ucpcal_tree_rotate(
+	ucpcal_tree *tree,
+	struct ucpcal_node *node,
+	int left
+);
+
+/**
+ * @brief Rebalances a tree after the subtree at a node has changed.
+ * Walks from the node up to the root, recalculating heights and rotating
+ * wherever a node has become unbalanced.
+ * @param tree the tree to rebalance
+ * @param node the lowest node whose subtree has changed, or NULL
+ */
+
+void ucpcal_tree_rebalance(ucpcal_tree *tree, struct ucpcal_node *node);
+
+/**
+ * @brief Empties a tree.
+ * The nodes in the tree are not freed.
+ * @param tree the tree to empty
+ */
+
+void ucpcal_tree_empty(ucpcal_tree *tree);
+
+#endif
@@ -0,0 +1,303 @@
+/**
+ * @file trigram.c
+ * @brief Data structures and algorithms for trigram indexes of list nodes.
+ */
+
+#include "trigram.h"
+#include "list.h"
+
+ucpcal_trigram *ucpcal_trigram_new(void) {
+	ucpcal_trigram *index = (ucpcal_trigram *) malloc(
+		sizeof(ucpcal_trigram)
+	);
+	index->slots = NULL;
+	index->capacity = 0;
+	index->used = 0;
+	index->nodes = NULL;
+	index->count = 0;
+	index->node_capacity = 0;
+	index->removed = 0;
+	/* Even short calendars have a few hundred distinct trigrams. */
+	ucpcal_trigram_resize(index, 1024);
+	return index;
+}
+
+void ucpcal_trigram_free(ucpcal_trigram *index) {
+	size_t i;
+	if (index) {
+		for (i = 0; i < index->capacity; i++)
+			free(index->slots[i].ids);
+		free(index->slots);
+		free(index->nodes);
+		free(index);
+	}
+}
+
+unsigned long ucpcal_trigram_key(const char *text) {
+	const unsigned char *cur = (const unsigned char *) text;
+	return (unsigned long) tolower(cur[0]) << 16 |
+		(unsigned long) tolower(cur[1]) << 8 |
+		(unsigned long) tolower(cur[2]);
+}
+
+void ucpcal_trigram_insert(ucpcal_trigram *index, ucpcal_node *node) {
+	if (index->count == index->node_capacity) {
+		index->node_capacity = index->node_capacity ?
+			index->node_capacity * 2 : 1024;
+		index->nodes = (ucpcal_node **) realloc(
+			index->nodes,
+			index->node_capacity * sizeof(ucpcal_node *)
+		);
+	}
+	node->trigram_id = index->count;
+	index->nodes[index->count++] = node;
+	ucpcal_trigram_add_text(index, node->event->name, node->trigram_id);
+	ucpcal_trigram_add_text(
+		index,
+		node->event->location,
+		node->trigram_id
+	);
+}
+
+void ucpcal_trigram_add_text(
+	ucpcal_trigram *index,
+	const char *text,
+	unsigned int id
+) {
+	ucpcal_trigram_slot *slot;
+	const char *cur, *end = text ? text + ucpcal_string_length(text) : NULL;
+	for (cur = text; cur && cur + 2 < end; cur++) {
+		/* Keep at most three quarters of the slots occupied. */
+		if ((index->used + 1) * 4 > index->capacity * 3)
+			ucpcal_trigram_resize(index, index->capacity * 2);
+		slot = ucpcal_trigram_find(index, ucpcal_trigram_key(cur));
+		if (!slot->trigram) {
+			slot->trigram = ucpcal_trigram_key(cur);
+			index->used++;
+		}
+		/*
+			A node's trigrams are all added together, so a trigram
+			seen twice in its name or location already ends with
+			its id.
+		*/
+		if (!slot->count || slot->ids[slot->count - 1] != id) {
+			if (slot->count == slot->capacity) {
+				slot->capacity = slot->capacity ?
+					slot->capacity * 2 : 4;
+				slot->ids = (unsigned int *) realloc(
+					slot->ids,
+					slot->capacity * sizeof(unsigned int)
+				);
+			}
+			slot->ids[slot->count++] = id;
+		}
+	}
+}
+
+void ucpcal_trigram_remove(ucpcal_trigram *index, ucpcal_node *node) {
+	/*
+		Taking the id out of every trigram's list would mean searching
+		lists that may be very long, so searches skip it instead.
+	*/
+	index->nodes[node->trigram_id] = NULL;
+	index->removed++;
+	if (index->removed > 1024 && index->removed * 2 > index->count)
+		ucpcal_trigram_rebuild(index);
+}
+
+ucpcal_trigram_slot *ucpcal_trigram_find(
+	ucpcal_trigram *index,
+	unsigned long trigram
+) {
+	/* Trigrams of similar text differ in few bits, so mix them up. */
+	unsigned long mixed = (trigram * 2654435761UL) & 0xFFFFFFFFUL;
+	size_t mask = index->capacity - 1;
+	size_t i = (mixed ^ mixed >> 16) & mask;
+	while (index->slots[i].trigram && index->slots[i].trigram != trigram)
+		i = (i + 1) & mask;
+	return &index->slots[i];
+}
+
+void ucpcal_trigram_resize(ucpcal_trigram *index, size_t capacity) {
+	ucpcal_trigram_slot *old = index->slots, *slot;
+	size_t old_capacity = index->capacity;
+	size_t i;
+	index->slots = (ucpcal_trigram_slot *) malloc(
+		capacity * sizeof(ucpcal_trigram_slot)
+	);
+	for (i = 0; i < capacity; i++) {
+		index->slots[i].trigram = 0;
+		index->slots[i].ids = NULL;
+		index->slots[i].count = 0;
+		index->slots[i].capacity = 0;
+	}
+	index->capacity = capacity;
+	/* The lists of ids move over as they are. */
+	for (i = 0; i < old_capacity; i++) {
+		if (old[i].trigram) {
+			slot = ucpcal_trigram_find(index, old[i].trigram);
+			*slot = old[i];
+		}
+	}
+	free(old);
+}
+
+void ucpcal_trigram_rebuild(ucpcal_trigram *index) {
+	size_t i, live = 0;
+	for (i = 0; i < index->capacity; i++) {
+		free(index->slots[i].ids);
+		index->slots[i].trigram = 0;
+		index->slots[i].ids = NULL;
+		index->slots[i].count = 0;
+		index->slots[i].capacity = 0;
+	}
+	index->used = 0;
+	/* Move the remaining nodes to the front, keeping their order. */
+	for (i = 0; i < index->count; i++)
+		if (index->nodes[i])
+			index->nodes[live++] = index->nodes[i];
+	index->count = 0;
+	index->removed = 0;
+	/* Each node goes back where it already is, under its new id. */
+	for (i = 0; i < live; i++)
+		ucpcal_trigram_insert(index, index->nodes[i]);
+}
+
+ucpcal_node **ucpcal_trigram_search(
+	ucpcal_trigram *index,
+	const char *text,
+	size_t *count
+) {
+	ucpcal_trigram_slot *slot, *best = NULL;
+	ucpcal_node **result, *node;
+	unsigned int *ids = NULL;
+	size_t candidates = index->count, i;
+	const char *cur;
+	int missing = 0;
+	/* Every trigram of the text is in every match, so use the rarest. */
+	for (cur = text; cur[0] && cur[1] && cur[2] && !missing; cur++) {
+		slot = ucpcal_trigram_find(index, ucpcal_trigram_key(cur));
+		if (!slot->trigram)
+			missing = 1;
+		else if (!best || slot->count < best->count)
+			best = slot;
+	}
+	if (missing) {
+		candidates = 0;
+	} else if (best) {
+		candidates = best->count;
+		ids = (unsigned int *) malloc(
+			(candidates ? candidates : 1) * sizeof(unsigned int)
+		);
+		memcpy(ids, best->ids, candidates * sizeof(unsigned int));
+		/*
+			Narrow the candidates down to those listed by the
+			text's other trigrams too, which only touches the
+			index rather than the events themselves.
+		*/
+		for (cur = text; cur[0] && cur[1] && cur[2]; cur++) {
+			slot = ucpcal_trigram_find(
+				index,
+				ucpcal_trigram_key(cur)
+			);
+			if (slot != best)
+				candidates = ucpcal_trigram_intersect(
+					slot,
+					ids,
+					candidates
+				);
+		}
+	}
+	result = (ucpcal_node **) malloc(
+		(candidates ? candidates : 1) * sizeof(ucpcal_node *)
+	);
+	*count = 0;
+	/* Sharing trigrams is not enough, so check each candidate. */
+	for (i = 0; i < candidates; i++) {
+		node = index->nodes[ids ? ids[i] : i];
+		if (
+			node && (
+				ucpcal_trigram_contains(
+					node->event->name,
+					text
+				) ||
+				ucpcal_trigram_contains(
+					node->event->location,
+					text
+				)
+			)
+		)
+			result[(*count)++] = node;
+	}
+	free(ids);
+	return result;
+}
+
+size_t ucpcal_trigram_intersect(
+	const ucpcal_trigram_slot *slot,
+	unsigned int *ids,
+	size_t count
+) {
+	size_t i, kept = 0, at = 0;
+	for (i = 0; i < count; i++) {
+		at = ucpcal_trigram_seek(slot, at, ids[i]);
+		if (at < slot->count && slot->ids[at] == ids[i])
+			ids[kept++] = ids[i];
+	}
+	return kept;
+}
+
+size_t ucpcal_trigram_seek(
+	const ucpcal_trigram_slot *slot,
+	size_t from,
+	unsigned int id
+) {
+	size_t low = from, high = from, step = 1, middle;
+	/*
+		Ids are listed in increasing order. Candidates are usually close
+		together, so gallop ahead to bound the id before searching by
+		halves, which costs little however long the list is.
+	*/
+	while (high < slot->count && slot->ids[high] < id) {
+		low = high + 1;
+		high += step;
+		step *= 2;
+	}
+	if (high > slot->count)
+		high = slot->count;
+	while (low < high) {
+		middle = low + (high - low) / 2;
+		if (slot->ids[middle] < id)
+			low = middle + 1;
+		else
+			high = middle;
+	}
+	return low;
+}
+
+int ucpcal_trigram_contains(const char *haystack, const char *needle) {
+	const unsigned char *start, *a, *b;
+	int result = 0;
+	if (haystack) {
+		for (
+			start = (const unsigned char *) haystack;
+			*start && *start != '\n' && !result;
+			start++
+		) {
+			a = start;
+			b = (const unsigned char *) needle;
+			while (
+				*a && *a != '\n' && *b &&
+				tolower(*a) == tolower(*b)
+			) {
+				a++;
+				b++;
+			}
+			result = !*b;
+		}
+		/* Empty text is found even in an empty string. */
+		if (!*needle)
+			result = 1;
+	}
+	return result;
+}
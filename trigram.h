@@ -0,0 +1,219 @@
+/**
+ * @file trigram.h
+ * @brief Data structures and algorithms for trigram indexes of list nodes.
+ */
+
+#ifndef UCPCAL_TRIGRAM_H
+#define UCPCAL_TRIGRAM_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "event.h"
+
+/*
+	As with hash.h, list.h embeds an index in each list, so the node
+	structure can only be declared incompletely here.
+*/
+struct ucpcal_node;
+
+/**
+ * @brief A data structure representing the nodes containing one trigram.
+ * A slot whose trigram is 0 is empty, as no trigram of a string can be 0.
+ */
+
+typedef struct ucpcal_trigram_slot {
+	/**
+	 * Three bytes of text, folded to lower case, packed into one number.
+	 */
+	unsigned long trigram;
+	/**
+	 * The ids of the nodes whose event's name or location contains the
+	 * trigram, in increasing order, each given once. Ids are unsigned
+	 * ints rather than pointers to halve the size of the index.
+	 */
+	unsigned int *ids;
+	size_t count;
+	size_t capacity;
+} ucpcal_trigram_slot;
+
+/**
+ * @brief A data structure representing an inverted index of trigrams.
+ * Each node is given an id when inserted, and every trigram of its event's
+ * name and location lists the id. Searching for some text only has to check
+ * the nodes listed by every trigram of the text. Removing a node only forgets
+ * its id, and the index is rebuilt once most ids are forgotten.
+ */
+
+typedef struct ucpcal_trigram {
+	/**
+	 * An open addressing hash table of trigrams, with linear probing.
+	 */
+	ucpcal_trigram_slot *slots;
+	/**
+	 * The number of slots, always a power of two.
+	 */
+	size_t capacity;
+	/**
+	 * The number of slots holding a trigram.
+	 */
+	size_t used;
+	/**
+	 * The node given each id, or NULL where the node has been removed.
+	 */
+	struct ucpcal_node **nodes;
+	/**
+	 * The number of ids given out, which is also the next id.
+	 */
+	size_t count;
+	size_t node_capacity;
+	/**
+	 * The number of ids forgotten since the index was last rebuilt.
+	 */
+	size_t removed;
+} ucpcal_trigram;
+
+/**
+ * @brief Creates a new, empty trigram index on the heap.
+ * Be sure to use ucpcal_trigram_free() when finished.
+ * @return pointer to new ucpcal_trigram struct
+ */
+
+ucpcal_trigram *ucpcal_trigram_new(void);
+
+/**
+ * @brief Frees the memory used for a trigram index.
+ * The nodes referred to by the index are not freed.
+ * @param index the trigram index to be freed, or NULL
+ */
+
+void ucpcal_trigram_free(ucpcal_trigram *index);
+
+/**
+ * @brief Packs the three bytes at the start of some text into a trigram.
+ * ASCII letters are folded to lower case, so that searching ignores case.
+ * @param text the text, which must have at least three bytes
+ * @return the trigram, which is never 0
+ */
+
+unsigned long ucpcal_trigram_key(const char *text);
+
+/**
+ * @brief Inserts a node into a trigram index, giving it the next id.
+ * @param index the trigram index
+ * @param node the node, whose event's name and location are indexed
+ */
+
+void ucpcal_trigram_insert(ucpcal_trigram *index, struct ucpcal_node *node);
+
+/**
+ * @brief Adds the trigrams of some text to a trigram index for a node.
+ * @param index the trigram index
+ * @param text the text, or NULL for none
+ * @param id the id of the node
+ */
+
+void ucpcal_trigram_add_text(
+	ucpcal_trigram *index,
+	const char *text,
+	unsigned int id
+);
+
+/**
+ * @brief Removes a particular node from a trigram index.
+ * The node's id is forgotten, so the index must be given the node with the
+ * same name and location as when it was inserted.
+ * @param index the trigram index
+ * @param node the node to remove
+ */
+
+void ucpcal_trigram_remove(ucpcal_trigram *index, struct ucpcal_node *node);
+
+/**
+ * @brief Finds the slot of a trigram, or the empty slot where it would go.
+ * @param index the trigram index
+ * @param trigram the trigram to look for
+ * @return the slot
+ */
+
+ucpcal_trigram_slot *ucpcal_trigram_find(
+	ucpcal_trigram *index,
+	unsigned long trigram
+);
+
+/**
+ * @brief Rebuilds a trigram index's hash table with a new capacity.
+ * @param index the trigram index
+ * @param capacity the new number of slots, which must be a power of two
+ */
+
+void ucpcal_trigram_resize(ucpcal_trigram *index, size_t capacity);
+
+/**
+ * @brief Rebuilds a trigram index from its remaining nodes, renumbering
+ * them, so that removed nodes no longer take up room.
+ * @param index the trigram index
+ */
+
+void ucpcal_trigram_rebuild(ucpcal_trigram *index);
+
+/**
+ * @brief Finds the nodes whose event's name or location contains some text.
+ * Case is ignored for ASCII letters. Text shorter than a trigram is looked
+ * for in every node.
+ * @param index the trigram index
+ * @param text the text to look for
+ * @param count where to store the number of nodes found
+ * @return a heap allocated array of the nodes found, in the order they were
+ * inserted, which must be freed by the caller
+ */
+
+struct ucpcal_node **ucpcal_trigram_search(
+	ucpcal_trigram *index,
+	const char *text,
+	size_t *count
+);
+
+/**
+ * @brief Keeps only those ids that a trigram's slot also lists.
+ * @param slot the slot of the trigram
+ * @param ids the ids, in increasing order, which are overwritten by the ids
+ * kept, in the same order
+ * @param count the number of ids
+ * @return the number of ids kept
+ */
+
+size_t ucpcal_trigram_intersect(
+	const ucpcal_trigram_slot *slot,
+	unsigned int *ids,
+	size_t count
+);
+
+/**
+ * @brief Finds where a node's id is, or would be, in a trigram's slot.
+ * @param slot the slot of the trigram
+ * @param from where to start looking, as ids are only searched for in
+ * increasing order
+ * @param id the id of the node
+ * @return the position of the first id not less than the id, which may be
+ * the number of ids in the slot
+ */
+
+size_t ucpcal_trigram_seek(
+	const ucpcal_trigram_slot *slot,
+	size_t from,
+	unsigned int id
+);
+
+/**
+ * @brief Checks whether some text contains other text, ignoring the case of
+ * ASCII letters.
+ * @param haystack the text to look through, or NULL for none
+ * @param needle the text to look for
+ * @return non-zero if it is found
+ */
+
+int ucpcal_trigram_contains(const char *haystack, const char *needle);
+
+#endif
@@ -7,123 +7,382 @@
 
 int main(int argc, char **argv) {
 	int return_value = 0;
-	ucpcal_list *list = ucpcal_list_new();
-	switch (argc) {
-	case 1:
-		break;
-	case 2:
-		ucpcal_load(list, argv[1]);
-		break;
-	default:
-		fprintf(stderr, "Usage: %s [filename?]\n", argv[0]);
-		return_value = 1;
-		break;
+	/*
+		With -m, the file is memory mapped rather than copied, and
+		with -p, it is also parsed, and the calendar rendered, by
+		many threads at once. With -c, a file is converted between
+		the text and binary formats, and with -f, a file is
+		filtered, without starting the GUI at all.
+	*/
+	int mode = UCPCAL_LOAD_BUFFERED, option = 0;
+	const char *filename = NULL;
+	ucpcal_list *list;
+	ucpcal_profile_init();
+	if (argc == 4 && !strcmp(argv[1], "-c")) {
+		return_value = ucpcal_command_convert(
+			2,
+			argv + 2,
+			UCPCAL_LOAD_MAPPED
+		);
+	} else if (argc > 1 && !strcmp(argv[1], "-f")) {
+		return_value = ucpcal_command_filter(argc - 2, argv + 2, 0);
+	} else {
+		list = ucpcal_list_new();
+		if (argc > 1 && !strcmp(argv[1], "-m"))
+			mode = UCPCAL_LOAD_MAPPED;
+		else if (argc > 1 && !strcmp(argv[1], "-p"))
+			mode = UCPCAL_LOAD_PARALLEL;
+		option = mode != UCPCAL_LOAD_BUFFERED;
+		switch (argc - option) {
+		case 1:
+			break;
+		case 2:
+			filename = argv[1 + option];
+			break;
+		default:
+			fprintf(stderr,
+				"Usage: %s [-m|-p] [filename?]\n"
+				"       %s -c from to\n"
+				"       %s -f from to [-a date] [-b date] "
+				"[-n name] [-l location]\n",
+				argv[0],
+				argv[0],
+				argv[0]
+			);
+			return_value = 1;
+			break;
+		}
+		ucpcal_gui(list, mode, filename);
+		ucpcal_list_free(list);
 	}
-	ucpcal_gui(list);
-	ucpcal_list_free(list);
 	return return_value;
 }
 
-void ucpcal_gui(ucpcal_list *list) {
-	Window *win = createWindow("Calendar: Delan Azabani #17065012");
+void ucpcal_gui(ucpcal_list *list, int mode, const char *filename) {
+	Window *win = createWindow(UCPCAL_TITLE);
 	ucpcal_state state;
+	ucpcal_list *loaded;
 	state.win = win;
 	state.list = list;
+	state.mode = mode;
+	state.journal = NULL;
+	state.page_size = 0;
+	state.page.start = 0;
+	state.page.skip = 0;
+	state.first_page = 1;
+	state.windowed = 0;
+	state.loader = NULL;
+	if (filename)
+		ucpcal_gui_open(&state, filename);
 	addButton(win, "Load a calendar from file", &ucpcal_gui_load, &state);
+	addButton(win, "Cancel loading", &ucpcal_gui_cancel, &state);
 	addButton(win, "Save this calendar to file", &ucpcal_gui_save, &state);
+	addButton(win, "Compact the calendar file", &ucpcal_gui_compact, &state);
 	addButton(win, "Add a calendar event", &ucpcal_gui_add, &state);
 	addButton(win, "Edit a calendar event", &ucpcal_gui_edit, &state);
 	addButton(win, "Delete a calendar event", &ucpcal_gui_delete, &state);
+	addButton(win, "Search for events", &ucpcal_gui_search, &state);
+	addButton(win, "Show one page at a time", &ucpcal_gui_paging, &state);
+	addButton(win, "Previous page", &ucpcal_gui_previous_page, &state);
+	addButton(win, "Next page", &ucpcal_gui_next_page, &state);
+	addButton(win, "Jump to a date", &ucpcal_gui_jump, &state);
 	ucpcal_gui_update(&state);
 	runGUI(win);
+	/* The window may be closed while a file is still loading. */
+	if (state.loader) {
+		ucpcal_loader_cancel(state.loader);
+		/* It may have finished before it could be cancelled. */
+		if (!ucpcal_loader_finish(state.loader, &loaded))
+			ucpcal_list_free(loaded);
+	}
 	freeWindow(win);
+	ucpcal_journal_free(state.journal);
+}
+
+void ucpcal_gui_open(ucpcal_state *state, const char *filename) {
+	ucpcal_profile_start(UCPCAL_PROFILE_LOAD);
+	state->loader = ucpcal_loader_start(filename, state->mode);
+	ucpcal_gui_poll(state);
+	addTimeout(state->win, UCPCAL_LOAD_POLL, &ucpcal_gui_poll, state);
+}
+
+int ucpcal_gui_poll(void *state) {
+	ucpcal_state *s = (ucpcal_state *) state;
+	ucpcal_list *list;
+	ucpcal_journal *journal;
+	char *title;
+	int result, running;
+	if (!s->loader) {
+		/* The load was finished when it was started. */
+		running = 0;
+	} else if ((running = !ucpcal_loader_finished(s->loader))) {
+		/* Add enough for " (loading, 100%)". */
+		title = (char *) malloc(strlen(UCPCAL_TITLE) + 17);
+		sprintf(
+			title,
+			"%s (loading, %d%%)",
+			UCPCAL_TITLE,
+			ucpcal_loader_percent(s->loader)
+		);
+		setTitle(s->win, title);
+		free(title);
+	} else {
+		journal = ucpcal_journal_new(s->loader->filename);
+		result = ucpcal_loader_finish(s->loader, &list);
+		s->loader = NULL;
+		ucpcal_profile_stop(UCPCAL_PROFILE_LOAD);
+		setTitle(s->win, UCPCAL_TITLE);
+		if (!list) {
+			ucpcal_journal_free(journal);
+			if (result == UCPCAL_LOADER_FAILED)
+				messageBox(
+					s->win,
+					"The calendar file could not be opened."
+				);
+		} else {
+			/* The new calendar replaces the old all at once. */
+			ucpcal_list_swap(s->list, list);
+			ucpcal_list_free(list);
+			ucpcal_journal_free(s->journal);
+			s->journal = journal;
+			/* Any page shown was of the old calendar. */
+			s->first_page = 1;
+			ucpcal_gui_update(s);
+			if (result == UCPCAL_LOADER_PARTIAL)
+				messageBox(
+					s->win,
+					"Some records in the calendar file are "
+					"not valid and were left out; saving "
+					"will drop them from the file."
+				);
+		}
+	}
+	return running;
+}
+
+int ucpcal_gui_busy(ucpcal_state *state) {
+	if (state->loader)
+		messageBox(
+			state->win,
+			"Wait for the calendar to load, or cancel loading."
+		);
+	return state->loader != NULL;
+}
+
+int ucpcal_gui_rule(ucpcal_state *state, const char *text, ucpcal_rule **rule) {
+	*rule = NULL;
+	if (
+		strlen(text) > 0 &&
+		!(*rule = ucpcal_rule_parse(NULL, text, text + strlen(text)))
+	)
+		messageBox(
+			state->win,
+			"Write the repeat rule like \"every [N] day|week|month"
+			" [count N] [until YYYY-MM-DD HH:MM]"
+			" [except YYYY-MM-DD HH:MM, ...]\"."
+		);
+	return strlen(text) > 0 && !*rule;
+}
+
+int ucpcal_gui_location(ucpcal_state *state, const char *text) {
+	const char *error;
+	int result = ucpcal_rule_line(
+		text,
+		text + strlen(text),
+		&error
+	) != NULL;
+	if (result)
+		messageBox(
+			state->win,
+			"A location cannot start with \""
+			UCPCAL_RULE_PREFIX "\"."
+		);
+	return result;
+}
+
+int ucpcal_gui_when(
+	ucpcal_state *state,
+	char **inputs,
+	ucpcal_date *date,
+	unsigned int *duration
+) {
+	/* The inputs hold at most 56 characters between them. */
+	char text[64], message[128];
+	const char *end, *error;
+	sprintf(
+		text,
+		"%s-%s-%s %s:%s %s",
+		inputs[0],
+		inputs[1],
+		inputs[2],
+		inputs[3],
+		inputs[4],
+		inputs[5]
+	);
+	/*
+		Check the fields as the loaders will, so that nothing is saved
+		or journalled that they would later reject.
+	*/
+	end = ucpcal_parse_header(
+		text,
+		text + strlen(text),
+		date,
+		duration,
+		&error
+	);
+	if (!error && *end)
+		error = "expected nothing after the duration";
+	if (error) {
+		sprintf(
+			message,
+			"The date, time or duration is not valid: %s.",
+			error
+		);
+		messageBox(state->win, message);
+	}
+	return error != NULL;
 }
 
 void ucpcal_gui_update(ucpcal_state *state) {
-	char *output = ucpcal_gui_build_output(state->list);
+	ucpcal_page page;
+	char *output;
+	ucpcal_profile_start(UCPCAL_PROFILE_RENDER);
+	state->windowed = ucpcal_list_series(state->list)->count > 0;
+	if (state->page_size) {
+		page = ucpcal_gui_page_first(state);
+		output = ucpcal_render_page(
+			state->list,
+			&page,
+			state->page_size
+		);
+		/* A page past the end is moved back to the last page. */
+		if (!state->first_page)
+			state->page = page;
+	} else if (state->mode == UCPCAL_LOAD_PARALLEL && !state->windowed)
+		output = ucpcal_render_parallel(state->list, 0);
+	else
+		output = ucpcal_render_list(state->list);
+	ucpcal_profile_stop(UCPCAL_PROFILE_RENDER);
+	ucpcal_profile_start(UCPCAL_PROFILE_SET_TEXT);
 	setText(state->win, output);
+	ucpcal_profile_stop(UCPCAL_PROFILE_SET_TEXT);
 	free(output);
 }
 
-char *ucpcal_gui_build_output(ucpcal_list *list) {
-	/* result_cursor is used for appending with sprintf() */
-	char *result, *result_cursor;
-	/* First, let's calculate how much to allocate for the string. */
-	/* Start with enough to hold a null terminator. */
-	size_t size = 1;
-	ucpcal_node *cur = list->head;
-	while (cur) {
-		/*
-			This would be a lot easier with the snprintf(0) trick
-			that does nothing but returns the buffer size required,
-			but alas we do not have ISO C99 available in this unit.
-		*/
-		/* Add enough for the event name. */
-		size += strlen(cur->event->name);
-		/* Add enough for " @ ". */
-		size += 3;
-		/* Add enough for the event location. */
-		size += cur->event->location ?
-			strlen(cur->event->location) : 0;
-		/* Add enough for " (". */
-		size += 2;
-		/* Add enough for the worst case friendly duration. */
-		size += 64;
-		/* Add enough for ")\n". */
-		size += 2;
-		/* Add enough for the worst case friendly date and time. */
-		size += 64;
-		/* Add enough for "\n---\n\n". */
-		size += 6;
-		cur = cur->next;
+ucpcal_page ucpcal_gui_page_first(ucpcal_state *state) {
+	return state->first_page ?
+		ucpcal_page_first(state->list) :
+		state->page;
+}
+
+void ucpcal_gui_show_event(ucpcal_state *state, ucpcal_event *event) {
+	ucpcal_node *node = ucpcal_hash_find_event(state->list->names, event);
+	char *text;
+	/* Occurrences move the text of the events after them. */
+	if (
+		state->page_size ||
+		state->windowed ||
+		ucpcal_list_series(state->list)->count
+	) {
+		ucpcal_gui_update(state);
+	} else if (node) {
+		ucpcal_profile_start(UCPCAL_PROFILE_RENDER);
+		/* The event's new text is cached for the next full render. */
+		text = (char *) malloc(ucpcal_render_node_size(node));
+		ucpcal_render_node(text, node, state->list->arena);
+		ucpcal_tree_set_weight(node, node->text_characters);
+		ucpcal_profile_stop(UCPCAL_PROFILE_RENDER);
+		ucpcal_profile_start(UCPCAL_PROFILE_SET_TEXT);
+		insertText(state->win, ucpcal_tree_offset(node), text);
+		ucpcal_profile_stop(UCPCAL_PROFILE_SET_TEXT);
+		free(text);
 	}
-	/* Now, let's allocate. */
-	result = (char *) malloc(size);
-	result_cursor = result;
-	/* Terminate the string correctly first in case there are no nodes. */
-	*result_cursor = 0;
-	/* For each event, let's append to the string. */
-	cur = list->head;
-	while (cur) {
-		/*
-			Print to result_cursor, then advancing result_cursor
-			by the number of bytes printed excluding the null
-			terminator afterwards.
-		*/
-		result_cursor += sprintf(
-			result_cursor,
-			"%s%s%s (%s)\n%s\n---\n\n",
-			cur->event->name,
-			cur->event->location ? " @ " : "",
-			cur->event->location ? cur->event->location : "",
-			ucpcal_duration_friendly(cur->event->duration),
-			ucpcal_date_friendly(cur->event->date)
+}
+
+void ucpcal_gui_hide_event(ucpcal_state *state, ucpcal_event *event) {
+	ucpcal_node *node = ucpcal_hash_find_event(state->list->names, event);
+	/* Pages start at times, so they outlive the events on them. */
+	if (node && !state->page_size && !state->windowed) {
+		ucpcal_profile_start(UCPCAL_PROFILE_SET_TEXT);
+		deleteText(
+			state->win,
+			ucpcal_tree_offset(node),
+			node->when.weight
 		);
-		cur = cur->next;
+		ucpcal_profile_stop(UCPCAL_PROFILE_SET_TEXT);
+		ucpcal_tree_set_weight(node, 0);
 	}
-	return result;
 }
 
 void ucpcal_gui_load(void *state) {
 	ucpcal_state *s = (ucpcal_state *) state;
 	InputProperties props[] = {{ "Input filename", 255, 0 }};
 	char *filename = (char *) calloc(256, sizeof(char));
-	if (dialogBox(s->win, "Open file", 1, props, &filename)) {
-		ucpcal_load(s->list, filename);
-		ucpcal_gui_update(s);
-	}
+	if (
+		!ucpcal_gui_busy(s) &&
+		dialogBox(s->win, "Open file", 1, props, &filename)
+	)
+		ucpcal_gui_open(s, filename);
 	free(filename);
 }
 
+void ucpcal_gui_cancel(void *state) {
+	ucpcal_state *s = (ucpcal_state *) state;
+	/* The load stops, and is thrown away, at its next check. */
+	if (s->loader)
+		ucpcal_loader_cancel(s->loader);
+}
+
 void ucpcal_gui_save(void *state) {
 	ucpcal_state *s = (ucpcal_state *) state;
 	InputProperties props[] = {{ "Output filename", 255, 0 }};
 	char *filename = (char *) calloc(256, sizeof(char));
-	if (dialogBox(s->win, "Save file", 1, props, &filename))
-		ucpcal_save(s->list, filename);
+	int result = 0;
+	if (
+		!ucpcal_gui_busy(s) &&
+		dialogBox(s->win, "Save file", 1, props, &filename)
+	) {
+		ucpcal_profile_start(UCPCAL_PROFILE_SAVE);
+		if (s->journal && !strcmp(filename, s->journal->base)) {
+			/* Only the changes since the last save are written. */
+			result = ucpcal_journal_flush(s->journal);
+		} else {
+			/*
+				A calendar written out in full has nothing to
+				replay, so any old journal for the file goes,
+				and changes are journaled for it from now on.
+			*/
+			result = ucpcal_save(s->list, filename);
+			if (!result) {
+				ucpcal_journal_free(s->journal);
+				s->journal = ucpcal_journal_new(filename);
+				ucpcal_journal_discard(s->journal);
+			}
+		}
+		ucpcal_profile_stop(UCPCAL_PROFILE_SAVE);
+		if (result)
+			messageBox(s->win, "The calendar could not be saved.");
+	}
 	free(filename);
 }
 
+void ucpcal_gui_compact(void *state) {
+	ucpcal_state *s = (ucpcal_state *) state;
+	int result, busy = ucpcal_gui_busy(s);
+	if (!busy && !s->journal) {
+		messageBox(s->win, "Load or save a calendar file first.");
+	} else if (!busy) {
+		ucpcal_profile_start(UCPCAL_PROFILE_SAVE);
+		result = ucpcal_journal_compact(s->journal, s->list);
+		ucpcal_profile_stop(UCPCAL_PROFILE_SAVE);
+		if (result)
+			messageBox(
+				s->win,
+				"The calendar could not be compacted."
+			);
+	}
+}
+
 void ucpcal_gui_add(void *state) {
 	ucpcal_state *s = (ucpcal_state *) state;
 	InputProperties props[] = {
@@ -134,10 +393,14 @@ void ucpcal_gui_add(void *state) {
 		{ "Minute", 2, 0 },
 		{ "Duration in minutes", 24, 0 },
 		{ "Name of event", 255, 0 },
-		{ "Optional location", 255, 0 }
+		{ "Optional location", 255, 0 },
+		{ "Optional repeat, like \"every 2 weeks count 5\"", 255, 0 }
 	};
 	int i;
-	char *inputs[8];
+	char *inputs[9];
+	ucpcal_rule *rule = NULL;
+	ucpcal_date date;
+	unsigned int duration;
 	inputs[0] = (char *) calloc(25, sizeof(char));
 	inputs[1] = (char *) calloc(3, sizeof(char));
 	inputs[2] = (char *) calloc(3, sizeof(char));
@@ -146,15 +409,17 @@ void ucpcal_gui_add(void *state) {
 	inputs[5] = (char *) calloc(25, sizeof(char));
 	inputs[6] = (char *) calloc(256, sizeof(char));
 	inputs[7] = (char *) calloc(256, sizeof(char));
-	if (dialogBox(s->win, "Add calendar event", 8, props, inputs)) {
+	inputs[8] = (char *) calloc(256, sizeof(char));
+	if (
+		!ucpcal_gui_busy(s) &&
+		dialogBox(s->win, "Add calendar event", 9, props, inputs) &&
+		!ucpcal_gui_when(s, inputs, &date, &duration) &&
+		!ucpcal_gui_location(s, inputs[7]) &&
+		!ucpcal_gui_rule(s, inputs[8], &rule)
+	) {
 		ucpcal_event *event = ucpcal_event_new();
-		event->date.year = atoi(inputs[0]);
-		event->date.month = atoi(inputs[1]);
-		event->date.day = atoi(inputs[2]);
-		event->date.hour = atoi(inputs[3]);
-		event->date.minute = atoi(inputs[4]);
-		event->date.good = 1;
-		event->duration = atoi(inputs[5]);
+		event->date = date;
+		event->duration = duration;
 		event->name = inputs[6];
 		if (strlen(inputs[7]) > 0) {
 			event->location = inputs[7];
@@ -162,14 +427,23 @@ void ucpcal_gui_add(void *state) {
 			event->location = NULL;
 			free(inputs[7]);
 		}
-		ucpcal_list_append(s->list, event);
-		ucpcal_gui_update(s);
+		event->rule = rule;
+		/* The list copies the event into its arena. */
+		event = ucpcal_list_append(s->list, event);
+		/* The list keeps the first event with a given name. */
+		if (event)
+			ucpcal_gui_show_event(s, event);
+		if (event && s->journal)
+			ucpcal_journal_add(s->journal, event);
+		if (event)
+			ucpcal_gui_warn_overlaps(s, event);
 	} else {
 		free(inputs[6]);
 		free(inputs[7]);
 	}
 	for (i = 0; i < 6; i++)
 		free(inputs[i]);
+	free(inputs[8]);
 }
 
 void ucpcal_gui_edit(void *state) {
@@ -177,9 +451,24 @@ void ucpcal_gui_edit(void *state) {
 	InputProperties props[] = {{ "Name of event", 255, 0 }};
 	char *name = (char *) calloc(256, sizeof(char));
 	ucpcal_event *event;
-	if (dialogBox(s->win, "Edit calendar event", 1, props, &name))
-		if ((event = ucpcal_list_find(s->list, name)))
+	if (
+		!ucpcal_gui_busy(s) &&
+		dialogBox(s->win, "Edit calendar event", 1, props, &name) &&
+		(event = ucpcal_list_find(s->list, name))
+	) {
+		/* A rule cut short by its input would be saved cut short. */
+		if (
+			event->rule &&
+			ucpcal_rule_format_size(event->rule) >
+				UCPCAL_INPUT_MAX + 1
+		)
+			messageBox(
+				s->win,
+				"This event's repeat rule is too long to edit."
+			);
+		else
 			ucpcal_gui_edit_more(s, event);
+	}
 	free(name);
 }
 
@@ -193,10 +482,15 @@ void ucpcal_gui_edit_more(void *state, ucpcal_event *event) {
 		{ "Minute", 2, 0 },
 		{ "Duration in minutes", 24, 0 },
 		{ "Name of event", 255, 0 },
-		{ "Optional location", 255, 0 }
+		{ "Optional location", 255, 0 },
+		{ "Optional repeat, like \"every 2 weeks count 5\"", 255, 0 }
 	};
 	int i;
-	char *inputs[8];
+	char *inputs[9];
+	ucpcal_rule *rule = NULL;
+	ucpcal_date date;
+	unsigned int duration;
+	size_t length, rule_size = 256;
 	inputs[0] = (char *) calloc(25, sizeof(char));
 	sprintf(inputs[0], "%d", event->date.year);
 	inputs[1] = (char *) calloc(3, sizeof(char));
@@ -209,34 +503,46 @@ void ucpcal_gui_edit_more(void *state, ucpcal_event *event) {
 	sprintf(inputs[4], "%d", event->date.minute);
 	inputs[5] = (char *) calloc(25, sizeof(char));
 	sprintf(inputs[5], "%d", event->duration);
+	/* Borrowed strings end at a newline, so copy them by length. */
 	inputs[6] = (char *) calloc(256, sizeof(char));
-	strncpy(inputs[6], event->name, 255);
+	length = ucpcal_string_length(event->name);
+	memcpy(inputs[6], event->name, length < 255 ? length : 255);
 	inputs[7] = (char *) calloc(256, sizeof(char));
+	length = event->location ? ucpcal_string_length(event->location) : 0;
 	if (event->location)
-		strncpy(inputs[7], event->location, 255);
-	if (dialogBox(s->win, "Edit calendar event", 8, props, inputs)) {
-		free(event->name);
-		free(event->location);
-		event->date.year = atoi(inputs[0]);
-		event->date.month = atoi(inputs[1]);
-		event->date.day = atoi(inputs[2]);
-		event->date.hour = atoi(inputs[3]);
-		event->date.minute = atoi(inputs[4]);
-		event->date.good = 1;
-		event->duration = atoi(inputs[5]);
-		event->name = inputs[6];
-		if (strlen(inputs[7]) > 0) {
-			event->location = inputs[7];
-		} else {
-			event->location = NULL;
-			free(inputs[7]);
-		}
-		ucpcal_gui_update(s);
-	} else {
-		free(inputs[6]);
-		free(inputs[7]);
+		memcpy(inputs[7], event->location, length < 255 ? length : 255);
+	/* Rules with many exceptions need more room to be edited whole. */
+	if (event->rule && ucpcal_rule_format_size(event->rule) > rule_size)
+		rule_size = ucpcal_rule_format_size(event->rule);
+	props[8].maxLength = (int) (rule_size - 1);
+	inputs[8] = (char *) calloc(rule_size, sizeof(char));
+	if (event->rule)
+		ucpcal_rule_format(inputs[8], event->rule);
+	if (
+		dialogBox(s->win, "Edit calendar event", 9, props, inputs) &&
+		!ucpcal_gui_when(s, inputs, &date, &duration) &&
+		!ucpcal_gui_location(s, inputs[7]) &&
+		!ucpcal_gui_rule(s, inputs[8], &rule)
+	) {
+		/* The list copies the new data and reindexes the event. */
+		ucpcal_event changes;
+		changes.date = date;
+		changes.duration = duration;
+		changes.name = inputs[6];
+		changes.location = strlen(inputs[7]) > 0 ? inputs[7] : NULL;
+		changes.rule = rule;
+		/* Journal the edit while the event has its old name. */
+		if (s->journal)
+			ucpcal_journal_edit(s->journal, event->name, &changes);
+		/* The event may move, so its text goes and comes back. */
+		ucpcal_gui_hide_event(s, event);
+		ucpcal_list_edit(s->list, event, &changes);
+		ucpcal_gui_show_event(s, event);
+		ucpcal_gui_warn_overlaps(s, event);
+		/* The list copies the rule too. */
+		ucpcal_rule_free(rule);
 	}
-	for (i = 0; i < 6; i++)
+	for (i = 0; i < 9; i++)
 		free(inputs[i]);
 }
 
@@ -244,106 +550,196 @@ void ucpcal_gui_delete(void *state) {
 	ucpcal_state *s = (ucpcal_state *) state;
 	InputProperties props[] = {{ "Name of event", 255, 0 }};
 	char *name = (char *) calloc(256, sizeof(char));
-	if (dialogBox(s->win, "Delete calendar event", 1, props, &name)) {
-		ucpcal_list_delete(s->list, name);
-		ucpcal_gui_update(s);
+	ucpcal_event *event;
+	if (
+		!ucpcal_gui_busy(s) &&
+		dialogBox(s->win, "Delete calendar event", 1, props, &name)
+	) {
+		if ((event = ucpcal_list_find(s->list, name))) {
+			if (s->journal)
+				ucpcal_journal_delete(s->journal, name);
+			ucpcal_gui_hide_event(s, event);
+			ucpcal_list_delete(s->list, name);
+			if (s->page_size || s->windowed)
+				ucpcal_gui_update(s);
+		}
 	}
 	free(name);
 }
 
-char *ucpcal_readline(FILE *f) {
-	/* A sane starting buffer size that may minimise reallocations. */
-	size_t bufsize = 32;
-	size_t used = 0;
-	char *result = (char *) malloc(bufsize);
-	int ch = getc(f);
-	while (ch != '\n' && ch != EOF) {
-		if (used == bufsize) {
-			bufsize *= 2;
-			result = (char *) realloc(result, bufsize);
-		}
-		result[used] = ch;
-		used++;
-		ch = getc(f);
+void ucpcal_gui_search(void *state) {
+	ucpcal_state *s = (ucpcal_state *) state;
+	InputProperties props[] = {{ "Text to search for", 255, 0 }};
+	char *text = (char *) calloc(256, sizeof(char));
+	/* Listing every match could make an enormous message box. */
+	size_t shown = 20, count, size, i;
+	const char *heading = "Events containing the text:\n\n";
+	ucpcal_event **events;
+	char *message;
+	if (dialogBox(s->win, "Search for events", 1, props, &text)) {
+		events = ucpcal_list_search(s->list, text, &count);
+		if (count < shown)
+			shown = count;
+		/* Start with enough for the heading and a null terminator. */
+		size = strlen(heading) + 1;
+		/* Add enough for each name, " (", the date and ")\n". */
+		for (i = 0; i < shown; i++)
+			size += ucpcal_string_length(events[i]->name) +
+				UCPCAL_FRIENDLY_SIZE + 4;
+		/* Add enough for "...and %lu more" with a 64-bit count. */
+		size += 32;
+		message = (char *) malloc(size);
+		strcpy(
+			message,
+			count ? heading : "No events contain the text."
+		);
+		for (i = 0; i < shown; i++)
+			sprintf(
+				message + strlen(message),
+				"%.*s (%s)\n",
+				(int) ucpcal_string_length(events[i]->name),
+				events[i]->name,
+				ucpcal_date_friendly(events[i]->date)
+			);
+		if (count > shown)
+			sprintf(
+				message + strlen(message),
+				"...and %lu more",
+				(unsigned long) (count - shown)
+			);
+		messageBox(s->win, message);
+		free(message);
+		free(events);
 	}
-	result = (char *) realloc(result, used + 1);
-	result[used] = 0;
-	return result;
+	free(text);
 }
 
-void ucpcal_load(ucpcal_list *list, const char *filename) {
-	/*
-		Postel's law: be conservative in what you do, be liberal in
-		what you accept from others.
+void ucpcal_gui_paging(void *state) {
+	ucpcal_state *s = (ucpcal_state *) state;
+	s->page_size = s->page_size ? 0 : UCPCAL_PAGE_SIZE;
+	s->first_page = 1;
+	ucpcal_gui_update(s);
+}
 
-		Binary mode is OFF here so that files with CR+LF line endings
-		can be read properly, at least on Windows, though hopefully
-		users of other platforms won't use CR+LF delimited input.
-	*/
-	FILE *f = fopen(filename, "r");
-	int done = 0;
-	if (f) {
-		ucpcal_list_empty(list);
-		do {
-			int duration;
-			char *name, *location;
-			ucpcal_event *event;
-			ucpcal_date date = ucpcal_date_scan(f);
-			if (date.good) {
-				/* Consume whitespace around duration value. */
-				fscanf(f, " %d ", &duration);
-				name = ucpcal_readline(f);
-				location = ucpcal_readline(f);
-				if (strlen(location) > 0) {
-					/* Discard the following blank line. */
-					free(ucpcal_readline(f));
-				} else {
-					/* Free the empty location string. */
-					free(location);
-					/* Set the location pointer to NULL. */
-					location = NULL;
-				}
-				event = ucpcal_event_new();
-				event->date = date;
-				event->duration = duration;
-				event->name = name;
-				event->location = location;
-				ucpcal_list_append(list, event);
-			} else {
-				done = 1;
-			}
-		} while (!done);
-		fclose(f);
+void ucpcal_gui_next_page(void *state) {
+	ucpcal_state *s = (ucpcal_state *) state;
+	if (!s->page_size) {
+		s->page_size = UCPCAL_PAGE_SIZE;
+		s->first_page = 1;
+	} else {
+		s->page = ucpcal_page_forward(
+			s->list,
+			ucpcal_gui_page_first(s),
+			s->page_size
+		);
+		s->first_page = 0;
 	}
+	ucpcal_gui_update(s);
 }
 
-void ucpcal_save(ucpcal_list *list, const char *filename) {
-	/*
-		Postel's law: be conservative in what you do, be liberal in
-		what you accept from others.
+void ucpcal_gui_previous_page(void *state) {
+	ucpcal_state *s = (ucpcal_state *) state;
+	if (!s->page_size) {
+		s->page_size = UCPCAL_PAGE_SIZE;
+		s->first_page = 1;
+	} else {
+		s->page = ucpcal_page_back(
+			s->list,
+			ucpcal_gui_page_first(s),
+			s->page_size
+		);
+		s->first_page = 0;
+	}
+	ucpcal_gui_update(s);
+}
 
-		Binary mode is ON here so that regardless of platform, we
-		standardise on outputting files with LF line endings.
-	*/
-	FILE *f = fopen(filename, "wb");
-	if (f) {
-		ucpcal_node *cur = list->head;
-		while (cur) {
-			fprintf(f,
-				"%d-%02d-%02d %02d:%02d %d %s%s%s\n\n",
-				cur->event->date.year,
-				cur->event->date.month,
-				cur->event->date.day,
-				cur->event->date.hour,
-				cur->event->date.minute,
-				cur->event->duration,
-				cur->event->name,
-				cur->event->location ? "\n" : "",
-				cur->event->location ?
-					cur->event->location : ""
+void ucpcal_gui_jump(void *state) {
+	ucpcal_state *s = (ucpcal_state *) state;
+	InputProperties props[] = {
+		{ "Year", 24, 0 },
+		{ "Month", 2, 0 },
+		{ "Day", 2, 0 }
+	};
+	int i;
+	/* The inputs hold at most 28 characters between them. */
+	char *inputs[3], text[40], message[128];
+	const char *end, *error;
+	ucpcal_date date;
+	inputs[0] = (char *) calloc(25, sizeof(char));
+	inputs[1] = (char *) calloc(3, sizeof(char));
+	inputs[2] = (char *) calloc(3, sizeof(char));
+	if (dialogBox(s->win, "Jump to a date", 3, props, inputs)) {
+		/* Check the date as the add and edit dialogs do. */
+		sprintf(
+			text,
+			"%s-%s-%s 00:00",
+			inputs[0],
+			inputs[1],
+			inputs[2]
+		);
+		end = ucpcal_date_parse(
+			text,
+			text + strlen(text),
+			&date,
+			&error
+		);
+		if (!error && *end)
+			error = "expected nothing after the day";
+		if (error) {
+			sprintf(message, "The date is not valid: %s.", error);
+			messageBox(s->win, message);
+		} else {
+			if (!s->page_size)
+				s->page_size = UCPCAL_PAGE_SIZE;
+			/* Past the last occurrence, the last page is shown. */
+			s->page.start = ucpcal_time_from_date(date);
+			s->page.skip = 0;
+			s->first_page = 0;
+			ucpcal_gui_update(s);
+		}
+	}
+	for (i = 0; i < 3; i++)
+		free(inputs[i]);
+}
+
+void ucpcal_gui_warn_overlaps(ucpcal_state *state, ucpcal_event *event) {
+	/* Listing every overlap could make an enormous message box. */
+	size_t shown = 10;
+	const char *heading = "This event overlaps with:\n\n";
+	ucpcal_overlaps overlaps = ucpcal_list_overlaps(state->list, event);
+	ucpcal_event *other;
+	char *message;
+	/* Start with enough for the heading and a null terminator. */
+	size_t size = strlen(heading) + 1, count = 0;
+	while ((other = ucpcal_overlaps_next(&overlaps))) {
+		/* Add enough for the name and "\n". */
+		if (count < shown)
+			size += ucpcal_string_length(other->name) + 1;
+		count++;
+	}
+	if (count) {
+		/* Add enough for "...and %lu more" with a 64-bit count. */
+		size += 32;
+		message = (char *) malloc(size);
+		strcpy(message, heading);
+		overlaps = ucpcal_list_overlaps(state->list, event);
+		while (shown && (other = ucpcal_overlaps_next(&overlaps))) {
+			strncat(
+				message,
+				other->name,
+				ucpcal_string_length(other->name)
 			);
-			cur = cur->next;
+			strcat(message, "\n");
+			count--;
+			shown--;
 		}
-		fclose(f);
+		if (count)
+			sprintf(
+				message + strlen(message),
+				"...and %lu more",
+				(unsigned long) count
+			);
+		messageBox(state->win, message);
+		free(message);
 	}
 }
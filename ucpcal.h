@@ -13,6 +13,39 @@
 #include "date.h"
 #include "event.h"
 #include "list.h"
+#include "file.h"
+#include "binary.h"
+#include "journal.h"
+#include "stream.h"
+#include "command.h"
+#include "render.h"
+#include "profile.h"
+#include "loader.h"
+
+/**
+ * @brief The title of the main window.
+ */
+
+#define UCPCAL_TITLE "Calendar: Delan Azabani #17065012"
+
+/**
+ * @brief How often, in milliseconds, a file being loaded is checked on.
+ */
+
+#define UCPCAL_LOAD_POLL 100
+
+/**
+ * @brief The number of occurrences of events on each page of the paged view.
+ */
+
+#define UCPCAL_PAGE_SIZE 50
+
+/**
+ * @brief The most characters a single line dialog input can hold, since
+ * GTK+ clamps the maximum length of an entry to this.
+ */
+
+#define UCPCAL_INPUT_MAX 65536
 
 /**
  * @brief A data structure for passing state to GTK+ callbacks.
@@ -22,6 +55,36 @@
 typedef struct ucpcal_state {
 	Window *win;
 	ucpcal_list *list;
+	/**
+	 * How files should be loaded, as passed to ucpcal_load_mode().
+	 */
+	int mode;
+	/**
+	 * The journal of the calendar file being worked on, or NULL if the
+	 * calendar has not been loaded from or saved to a file yet.
+	 */
+	ucpcal_journal *journal;
+	/**
+	 * The most occurrences of events to show at once, or 0 to show the
+	 * whole calendar.
+	 */
+	unsigned long page_size;
+	/**
+	 * Where the page shown starts, unless first_page is non-zero, in which
+	 * case the first page is shown wherever it starts.
+	 */
+	ucpcal_page page;
+	int first_page;
+	/**
+	 * Non-zero if the text shown includes occurrences of recurring events,
+	 * so that the offsets of events' text in it are unknown.
+	 */
+	int windowed;
+	/**
+	 * The calendar file being loaded in the background, or NULL if none
+	 * is.
+	 */
+	ucpcal_loader *loader;
 } ucpcal_state;
 
 /**
@@ -36,9 +99,83 @@ int main(int argc, char **argv);
 /**
  * @brief Sets up, runs and cleans up calendar application GUI.
  * @param list a linked list of calendar events
+ * @param mode how files should be loaded, as passed to ucpcal_load_mode()
+ * @param filename a calendar file to open at the start, or NULL
  */
 
-void ucpcal_gui(ucpcal_list *list);
+void ucpcal_gui(ucpcal_list *list, int mode, const char *filename);
+
+/**
+ * @brief Starts opening a calendar file, replaying the changes in its
+ * journal.
+ * The file is loaded in the background, into a new list, while the window
+ * shows the progress in its title. Once it has loaded, ucpcal_gui_poll()
+ * swaps it in for the calendar shown, and changes made from then on are
+ * journaled for the file.
+ * @param state the ucpcal_state consisting of a window and linked list
+ * @param filename the calendar file to open
+ */
+
+void ucpcal_gui_open(ucpcal_state *state, const char *filename);
+
+/**
+ * @brief Checks on a calendar file being loaded in the background.
+ * Called every UCPCAL_LOAD_POLL milliseconds by the GUI while loading.
+ * @param state the ucpcal_state consisting of a window and linked list
+ * @return non-zero if the file is still loading
+ */
+
+int ucpcal_gui_poll(void *state);
+
+/**
+ * @brief Checks whether a calendar file is loading, telling the user to wait
+ * if it is.
+ * Anything that would change the calendar waits, so that no change is lost
+ * when the new calendar replaces the one shown.
+ * @param state the ucpcal_state consisting of a window and linked list
+ * @return non-zero if a file is loading
+ */
+
+int ucpcal_gui_busy(ucpcal_state *state);
+
+/**
+ * @brief Reads the date, time and duration typed into an event dialog,
+ * telling the user what is wrong if they are not valid.
+ * @param state the ucpcal_state consisting of a window and linked list
+ * @param inputs the dialog's inputs, starting with the year, month, day,
+ * hour, minute and duration
+ * @param date where to store the date and time
+ * @param duration where to store the duration
+ * @return non-zero if the inputs are not valid
+ */
+
+int ucpcal_gui_when(
+	ucpcal_state *state,
+	char **inputs,
+	ucpcal_date *date,
+	unsigned int *duration
+);
+
+/**
+ * @brief Reads the repeat rule typed into a dialog, telling the user how to
+ * write one if it is not valid.
+ * @param state the ucpcal_state consisting of a window and linked list
+ * @param text the text typed, or an empty string if the event does not recur
+ * @param rule where to store the rule, allocated on the heap, or NULL
+ * @return non-zero if the text is not a valid rule
+ */
+
+int ucpcal_gui_rule(ucpcal_state *state, const char *text, ucpcal_rule **rule);
+
+/**
+ * @brief Checks the location typed into a dialog, telling the user if it
+ * starts with UCPCAL_RULE_PREFIX and so would be read back as a repeat rule.
+ * @param state the ucpcal_state consisting of a window and linked list
+ * @param text the text typed
+ * @return non-zero if the location cannot be saved
+ */
+
+int ucpcal_gui_location(ucpcal_state *state, const char *text);
 
 /**
  * @brief Regenerates and rewrites the main calendar view field.
@@ -48,13 +185,35 @@ void ucpcal_gui(ucpcal_list *list);
 void ucpcal_gui_update(ucpcal_state *state);
 
 /**
- * @brief Builds a heap allocated string from the current calendar for the GUI.
- * Be sure to use free() when finished.
- * @param list the linked list of calendar events
- * @return a heap allocated string with GUI calendar output
+ * @brief Finds where the page shown starts.
+ * @param state the ucpcal_state consisting of a window and linked list
+ * @return the position of the first occurrence on the page
  */
 
-char *ucpcal_gui_build_output(ucpcal_list *list);
+ucpcal_page ucpcal_gui_page_first(ucpcal_state *state);
+
+/**
+ * @brief Shows an event that has just been added to the calendar, or edited.
+ * Only the event's own text is rendered and inserted into the view, at the
+ * offset found from the weights in the list's index of start times, rather
+ * than rebuilding and replacing all of the text. In the paged view, the page
+ * is rendered again instead.
+ * @param state the ucpcal_state consisting of a window and linked list
+ * @param event the event, which must be in the list
+ */
+
+void ucpcal_gui_show_event(ucpcal_state *state, ucpcal_event *event);
+
+/**
+ * @brief Removes an event's text from the view, before it is deleted from the
+ * calendar or edited.
+ * In the paged view, this does nothing, and the page must be rendered again
+ * once the event is gone.
+ * @param state the ucpcal_state consisting of a window and linked list
+ * @param event the event, which must still be in the list
+ */
+
+void ucpcal_gui_hide_event(ucpcal_state *state, ucpcal_event *event);
 
 /**
  * @brief GUI: loads calendar data from a file.
@@ -63,6 +222,13 @@ char *ucpcal_gui_build_output(ucpcal_list *list);
 
 void ucpcal_gui_load(void *state);
 
+/**
+ * @brief GUI: stops loading a calendar file, keeping the calendar shown.
+ * @param state the ucpcal_state consisting of a window and linked list
+ */
+
+void ucpcal_gui_cancel(void *state);
+
 /**
  * @brief GUI: saves calendar data to a file.
  * @param state the ucpcal_state consisting of a window and linked list
@@ -70,6 +236,13 @@ void ucpcal_gui_load(void *state);
 
 void ucpcal_gui_save(void *state);
 
+/**
+ * @brief GUI: folds the journal back into the current calendar file.
+ * @param state the ucpcal_state consisting of a window and linked list
+ */
+
+void ucpcal_gui_compact(void *state);
+
 /**
  * @brief GUI: adds an event to the current calendar.
  * @param state the ucpcal_state consisting of a window and linked list
@@ -90,7 +263,9 @@ void ucpcal_gui_edit(void *state);
 /**
  * @brief GUI: finishes editing an event.
  * Final stage; given an event, actually obtains the new event data to be
- * stored back into the event.
+ * stored back into the event. The repeat rule's input is made big enough to
+ * hold the event's whole rule, which must be at most UCPCAL_INPUT_MAX
+ * characters.
  * @param state the ucpcal_state consisting of a window and linked list
  * @param event the event
  */
@@ -105,32 +280,53 @@ void ucpcal_gui_edit_more(void *state, ucpcal_event *event);
 void ucpcal_gui_delete(void *state);
 
 /**
- * @brief Reads a string from the given file handle until the next newline.
- * Allocates and reallocates buffers of increasing size as more space is
- * required, doubling the size of the buffer each time to only require O(log n)
- * reallocations, though in the worst case just under 50% of the space may be
- * wasted until the buffer is shrunk to only what is needed before returning.
- * Be sure to use free() when finished.
- * @param f the file handle to read from
- * @return a heap allocated string containing the input
+ * @brief GUI: lists the events whose name or location contains some text.
+ * Shows a message box naming the first few events found, with their dates.
+ * @param state the ucpcal_state consisting of a window and linked list
  */
 
-char *ucpcal_readline(FILE *f);
+void ucpcal_gui_search(void *state);
 
 /**
- * @brief Loads calendar data from a file into a linked list of events.
- * @param list the linked list of calendar events
- * @param filename the filename to look for input data in
+ * @brief GUI: switches between showing the whole calendar and one page.
+ * @param state the ucpcal_state consisting of a window and linked list
  */
 
-void ucpcal_load(ucpcal_list *list, const char *filename);
+void ucpcal_gui_paging(void *state);
 
 /**
- * @brief Saves calendar data to a file from a linked list of events.
- * @param list the linked list of calendar events
- * @param filename the filename to output calendar data to
+ * @brief GUI: shows the next page of the calendar, if there is one.
+ * Switches to the paged view, at the first page, if it is not already shown.
+ * @param state the ucpcal_state consisting of a window and linked list
+ */
+
+void ucpcal_gui_next_page(void *state);
+
+/**
+ * @brief GUI: shows the previous page of the calendar, if there is one.
+ * Switches to the paged view, at the first page, if it is not already shown.
+ * @param state the ucpcal_state consisting of a window and linked list
+ */
+
+void ucpcal_gui_previous_page(void *state);
+
+/**
+ * @brief GUI: shows the page starting with the first occurrence on or after
+ * a date, or the last page if there is no such occurrence.
+ * Switches to the paged view if it is not already shown. A date that
+ * ucpcal_date_parse() rejects is reported in a message box instead.
+ * @param state the ucpcal_state consisting of a window and linked list
+ */
+
+void ucpcal_gui_jump(void *state);
+
+/**
+ * @brief GUI: warns if an event overlaps any others in the current calendar.
+ * Shows a message box naming the first few overlapping events, if any.
+ * @param state the ucpcal_state consisting of a window and linked list
+ * @param event the event to check, which should already be in the list
  */
 
-void ucpcal_save(ucpcal_list *list, const char *filename);
+void ucpcal_gui_warn_overlaps(ucpcal_state *state, ucpcal_event *event);
 
 #endif
@@ -0,0 +1,232 @@
+/**
+ * @file writer.c
+ * @brief Data structures and algorithms for buffered, atomic file writing.
+ */
+
+#include "writer.h"
+#include "profile.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+ucpcal_writer *ucpcal_writer_new(const char *filename) {
+	ucpcal_writer *writer = NULL;
+	struct stat info;
+	mode_t mode = 0666;
+	int fd, attempt = 0;
+	/* Enough for a 64-bit process ID and the count, with two dots. */
+	char *temporary = (char *) malloc(
+		strlen(filename) + strlen(UCPCAL_WRITER_SUFFIX) + 48
+	);
+	/* A replacement should be as readable as the file it replaces. */
+	if (!stat(filename, &info))
+		mode = info.st_mode & 0777;
+	/*
+		The temporary file sits next to the file it replaces, as
+		rename() is only atomic within a single file system. A name
+		is only taken by a crashed save with a recycled process ID,
+		or by another save in this process, so try the next one.
+	*/
+	do {
+		sprintf(
+			temporary,
+			"%s%s.%ld.%d",
+			filename,
+			UCPCAL_WRITER_SUFFIX,
+			(long) getpid(),
+			attempt++
+		);
+		fd = open(temporary, O_WRONLY | O_CREAT | O_EXCL, mode);
+	} while (
+		fd == -1 &&
+		errno == EEXIST &&
+		attempt < UCPCAL_WRITER_ATTEMPTS
+	);
+	if (fd == -1) {
+		free(temporary);
+	} else {
+		writer = (ucpcal_writer *) malloc(sizeof(ucpcal_writer));
+		writer->fd = fd;
+		writer->filename = (char *) malloc(strlen(filename) + 1);
+		strcpy(writer->filename, filename);
+		writer->temporary = temporary;
+		/* Big enough that writes are few and far between. */
+		writer->size = 1048576;
+		writer->buffer = (char *) malloc(writer->size);
+		writer->length = 0;
+		writer->failed = 0;
+	}
+	return writer;
+}
+
+ucpcal_writer *ucpcal_writer_new_fd(int fd) {
+	ucpcal_writer *writer = (ucpcal_writer *) malloc(sizeof(ucpcal_writer));
+	writer->fd = fd;
+	writer->filename = NULL;
+	writer->temporary = NULL;
+	writer->size = 1048576;
+	writer->buffer = (char *) malloc(writer->size);
+	writer->length = 0;
+	writer->failed = 0;
+	return writer;
+}
+
+void ucpcal_writer_write(
+	ucpcal_writer *writer,
+	const char *data,
+	size_t length
+) {
+	if (writer->length + length > writer->size)
+		ucpcal_writer_flush(writer);
+	if (length >= writer->size) {
+		/* Copying would only split this into more writes. */
+		if (
+			!writer->failed &&
+			ucpcal_write_all(writer->fd, data, length)
+		)
+			writer->failed = 1;
+	} else if (length) {
+		memcpy(writer->buffer + writer->length, data, length);
+		writer->length += length;
+	}
+}
+
+char *ucpcal_format_number(char *buffer, long value, int width) {
+	const char *pairs =
+		"00010203040506070809"
+		"10111213141516171819"
+		"20212223242526272829"
+		"30313233343536373839"
+		"40414243444546474849"
+		"50515253545556575859"
+		"60616263646566676869"
+		"70717273747576777879"
+		"80818283848586878889"
+		"90919293949596979899";
+	/* Enough for the 20 digits of the largest 64-bit magnitude. */
+	char digits[24];
+	char *cur = digits + sizeof(digits);
+	/* Negating in unsigned arithmetic is defined even for LONG_MIN. */
+	unsigned long magnitude = value < 0 ?
+		0UL - (unsigned long) value : (unsigned long) value;
+	int count;
+	while (magnitude >= 100) {
+		cur -= 2;
+		memcpy(cur, pairs + magnitude % 100 * 2, 2);
+		magnitude /= 100;
+	}
+	if (magnitude >= 10) {
+		cur -= 2;
+		memcpy(cur, pairs + magnitude * 2, 2);
+	} else {
+		*--cur = (char) ('0' + magnitude);
+	}
+	count = digits + sizeof(digits) - cur;
+	if (value < 0)
+		*buffer++ = '-';
+	while (count < width) {
+		*buffer++ = '0';
+		width--;
+	}
+	memcpy(buffer, cur, count);
+	return buffer + count;
+}
+
+void ucpcal_writer_flush(ucpcal_writer *writer) {
+	if (
+		writer->length &&
+		!writer->failed &&
+		ucpcal_write_all(writer->fd, writer->buffer, writer->length)
+	)
+		writer->failed = 1;
+	writer->length = 0;
+}
+
+int ucpcal_writer_commit(ucpcal_writer *writer) {
+	int result;
+	ucpcal_writer_flush(writer);
+	if (writer->temporary) {
+		/*
+			The data has to be on disk before the rename, or a
+			crash could leave the new name pointing at a file with
+			holes in it.
+		*/
+		if (fsync(writer->fd))
+			writer->failed = 1;
+		if (close(writer->fd))
+			writer->failed = 1;
+		if (
+			!writer->failed &&
+			rename(writer->temporary, writer->filename)
+		)
+			writer->failed = 1;
+		if (writer->failed)
+			unlink(writer->temporary);
+		else
+			/* The file is safely written even if this fails. */
+			ucpcal_sync_directory(writer->filename);
+	}
+	result = writer->failed ? -1 : 0;
+	free(writer->filename);
+	free(writer->temporary);
+	free(writer->buffer);
+	free(writer);
+	return result;
+}
+
+void ucpcal_writer_abort(ucpcal_writer *writer) {
+	if (writer && writer->temporary) {
+		close(writer->fd);
+		unlink(writer->temporary);
+	}
+	if (writer) {
+		free(writer->filename);
+		free(writer->temporary);
+		free(writer->buffer);
+		free(writer);
+	}
+}
+
+int ucpcal_write_all(int fd, const char *data, size_t length) {
+	ssize_t written;
+	int result = 0;
+	while (length && !result) {
+		written = write(fd, data, length);
+		if (written > 0) {
+			UCPCAL_PROFILE_COUNT(
+				UCPCAL_PROFILE_BYTES_WRITTEN,
+				written
+			);
+			data += written;
+			length -= written;
+		} else if (!written || errno != EINTR) {
+			result = -1;
+		}
+	}
+	return result;
+}
+
+int ucpcal_sync_directory(const char *filename) {
+	const char *slash = strrchr(filename, '/');
+	char *directory;
+	size_t length;
+	int fd, result = -1;
+	if (!slash) {
+		directory = (char *) malloc(2);
+		strcpy(directory, ".");
+	} else {
+		/* Keep the slash of a file in the root directory. */
+		length = slash == filename ? 1 : slash - filename;
+		directory = (char *) malloc(length + 1);
+		memcpy(directory, filename, length);
+		directory[length] = 0;
+	}
+	fd = open(directory, O_RDONLY);
+	if (fd != -1) {
+		result = fsync(fd) ? -1 : 0;
+		close(fd);
+	}
+	free(directory);
+	return result;
+}
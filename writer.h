@@ -0,0 +1,167 @@
+/**
+ * @file writer.h
+ * @brief Data structures and algorithms for buffered, atomic file writing.
+ */
+
+#ifndef UCPCAL_WRITER_H
+#define UCPCAL_WRITER_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @brief The suffix added to a file's name to name its temporary file,
+ * before the process ID and a count of the names already taken.
+ */
+
+#define UCPCAL_WRITER_SUFFIX ".tmp"
+
+/**
+ * @brief How many temporary file names are tried before giving up.
+ */
+
+#define UCPCAL_WRITER_ATTEMPTS 16
+
+/**
+ * @brief A data structure representing a buffered, atomic file writer.
+ * Output is gathered in a large buffer and written with a few big calls to
+ * write(), rather than a stdio call per field. It goes to a temporary file
+ * next to the destination, which is synced and then renamed over the
+ * destination only once everything has been written, so a crash at any
+ * point leaves either the old file or the new one, never a mix of the two.
+ * Any failure is remembered, and makes committing fail.
+ */
+
+typedef struct ucpcal_writer {
+	int fd;
+	/**
+	 * The file being written, or NULL if writing to a descriptor that
+	 * was already open.
+	 */
+	char *filename;
+	/**
+	 * The temporary file the output goes to until it is committed, or
+	 * NULL if writing to a descriptor that was already open.
+	 */
+	char *temporary;
+	char *buffer;
+	/**
+	 * The number of bytes allocated for the buffer.
+	 */
+	size_t size;
+	/**
+	 * The number of bytes in the buffer not yet written.
+	 */
+	size_t length;
+	/**
+	 * Non-zero once anything has gone wrong.
+	 */
+	int failed;
+} ucpcal_writer;
+
+/**
+ * @brief Creates a new writer for a file, and its temporary file.
+ * The temporary file is given the permissions of the file it will replace,
+ * if there is one. It is created afresh under a name of its own, never
+ * opening a file that is already there, so two processes saving the same
+ * file do not write into each other's temporary files.
+ * Be sure to use ucpcal_writer_commit() or ucpcal_writer_abort() when
+ * finished.
+ * @param filename the file to write
+ * @return pointer to new ucpcal_writer struct, or NULL if the temporary
+ * file could not be created
+ */
+
+ucpcal_writer *ucpcal_writer_new(const char *filename);
+
+/**
+ * @brief Creates a new writer for a file descriptor that is already open.
+ * Output is buffered as usual, but goes straight to the descriptor, which
+ * may be a pipe or terminal, and committing only flushes it; the descriptor
+ * is left open.
+ * Be sure to use ucpcal_writer_commit() or ucpcal_writer_abort() when
+ * finished.
+ * @param fd the file descriptor to write to
+ * @return pointer to new ucpcal_writer struct
+ */
+
+ucpcal_writer *ucpcal_writer_new_fd(int fd);
+
+/**
+ * @brief Writes bytes through a writer.
+ * Runs too big for the buffer are written straight from where they are.
+ * @param writer the writer to write through
+ * @param data the bytes to write
+ * @param length the number of bytes to write
+ */
+
+void ucpcal_writer_write(
+	ucpcal_writer *writer,
+	const char *data,
+	size_t length
+);
+
+/**
+ * @brief Writes a decimal integer into a buffer, without printf().
+ * The digits are worked out from the end, two at a time from a table.
+ * @param buffer where to write, with room for a sign and at least 20
+ * digits, or the width if that is greater
+ * @param value the integer to write
+ * @param width the minimum number of digits, padded with leading zeros
+ * @return just past the last byte written; nothing is null terminated
+ */
+
+char *ucpcal_format_number(char *buffer, long value, int width);
+
+/**
+ * @brief Writes out whatever is in a writer's buffer.
+ * @param writer the writer to flush
+ */
+
+void ucpcal_writer_flush(ucpcal_writer *writer);
+
+/**
+ * @brief Finishes writing, replacing the file with what was written.
+ * The temporary file is flushed, synced and renamed over the file, and the
+ * directory is synced so that the rename itself is durable. On failure the
+ * temporary file is removed and the file is left as it was. A writer made
+ * with ucpcal_writer_new_fd() is only flushed. Either way, the writer is
+ * freed.
+ * @param writer the writer to commit
+ * @return 0 on success, or -1 if anything failed
+ */
+
+int ucpcal_writer_commit(ucpcal_writer *writer);
+
+/**
+ * @brief Abandons writing, leaving the file as it was.
+ * The temporary file is removed and the writer is freed.
+ * @param writer the writer to abort, or NULL to do nothing
+ */
+
+void ucpcal_writer_abort(ucpcal_writer *writer);
+
+/**
+ * @brief Writes every byte of a buffer to a file descriptor.
+ * Short writes and interrupted calls are retried until everything is
+ * written or a real error occurs.
+ * @param fd the file descriptor to write to
+ * @param data the bytes to write
+ * @param length the number of bytes to write
+ * @return 0 on success, or -1 on error
+ */
+
+int ucpcal_write_all(int fd, const char *data, size_t length);
+
+/**
+ * @brief Syncs the directory containing a file.
+ * Renaming a file only changes its directory, which has to be synced too
+ * for the rename to survive a crash.
+ * @param filename the file whose directory should be synced
+ * @return 0 on success, or -1 on error
+ */
+
+int ucpcal_sync_directory(const char *filename);
+
+#endif